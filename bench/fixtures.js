@@ -0,0 +1,44 @@
+// Benchmark images, generated from examples/files so that every machine
+// benchmarks the same pixels. They are rebuilt on every run into
+// bench/fixtures/, which is not checked in.
+var fs = require('fs')
+  , path = require('path')
+  , cv = require('../lib/opencv');
+
+var SOURCES = ['mona.png', 'car1.jpg'];
+
+var RESOLUTIONS = [
+  [320, 240],
+  [1280, 720],
+  [1920, 1080]
+];
+
+var DIR = path.join(__dirname, 'fixtures');
+var FILES = path.join(__dirname, '..', 'examples', 'files');
+
+// Resolves with [{ name, source, width, height, path }, ...]
+exports.prepare = function() {
+  if (!fs.existsSync(DIR)) {
+    fs.mkdirSync(DIR);
+  }
+
+  return Promise.all(SOURCES.map(function(source) {
+    return cv.readImage(path.join(FILES, source));
+  })).then(function(images) {
+    var fixtures = [];
+    images.forEach(function(image, i) {
+      var base = path.basename(SOURCES[i], path.extname(SOURCES[i]));
+      RESOLUTIONS.forEach(function(res) {
+        var name = base + '-' + res[0] + 'x' + res[1];
+        var file = path.join(DIR, name + '.png');
+        // INTER_AREA: no randomness and no dependency on the upscaling filter
+        image.resize({ width: res[0], height: res[1] }, 0, 0, cv.Constants.INTER_AREA).save(file);
+        fixtures.push({ name: name, source: SOURCES[i], width: res[0], height: res[1], path: file });
+      });
+    });
+    return fixtures;
+  });
+};
+
+exports.video = path.join(FILES, 'motion.mov');
+exports.cascade = path.join(__dirname, '..', 'data', 'haarcascade_frontalface_alt.xml');
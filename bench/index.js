@@ -0,0 +1,321 @@
+// Throughput benchmarks for the bindings.
+//
+//   npm run bench                                  # all benchmarks
+//   npm run bench -- --filter resize --time 2      # only matching ones, 2s each
+//   npm run bench -- --out results.json
+//
+// Prints a table to stderr and JSON to stdout (or --out). For every
+// benchmark and fixture it reports ops/s, p50/p99 latency in microseconds,
+// heap and external memory allocated per op, the add-on's own timings from
+// cv.stats(), and, when bench_native was built, the same OpenCV call timed
+// in C++ without the binding.
+var fs = require('fs')
+  , os = require('os')
+  , cv = require('../lib/opencv')
+  , fixtures = require('./fixtures');
+
+var native = null;
+try {
+  native = require('../build/' + (process.env.NODE_OPENCV_DEBUG ? 'Debug' : 'Release') + '/bench_native.node');
+} catch (e) {}
+
+var options = { filter: null, time: 1, out: null };
+for (var i = 2; i < process.argv.length; i++) {
+  var arg = process.argv[i];
+  if (arg === '--filter') options.filter = new RegExp(process.argv[++i]);
+  else if (arg === '--time') options.time = parseFloat(process.argv[++i]);
+  else if (arg === '--out') options.out = process.argv[++i];
+  else {
+    console.error('Unknown option ' + arg);
+    process.exit(1);
+  }
+}
+
+var WARMUP = 3;
+var MIN_SAMPLES = 5;
+var MAX_SAMPLES = 10000;
+var MAX_NATIVE_SAMPLES = 200;
+
+// Each benchmark prepares its inputs from an image and returns the function
+// to time. That function may return a Promise. `binding` is the cv.stats()
+// name of the method being measured, `native` the bench_native baseline.
+var BENCHMARKS = [
+  {
+    name: 'readImage',
+    binding: 'readImage',
+    native: 'readImage',
+    setup: function(image, fixture) {
+      var buf = fs.readFileSync(fixture.path);
+      return function() { return cv.readImage(buf); };
+    }
+  },
+  {
+    name: 'toBuffer',
+    binding: 'Matrix#toBuffer',
+    native: 'toBuffer',
+    setup: function(image) {
+      return function() { return image.toBuffer(); };
+    }
+  },
+  {
+    name: 'resize',
+    binding: 'Matrix#resize',
+    native: 'resize',
+    setup: function(image) {
+      var size = { width: image.width() >> 1, height: image.height() >> 1 };
+      return function() { return image.resize(size); };
+    }
+  },
+  {
+    name: 'cvtColor',
+    binding: 'Matrix#cvtColor',
+    native: 'cvtColor',
+    setup: function(image) {
+      var gray = new cv.Matrix();
+      return function() { return image.cvtColor('CV_BGR2GRAY', gray); };
+    }
+  },
+  {
+    name: 'findContours',
+    binding: 'Matrix#findContours',
+    native: 'findContours',
+    setup: function(image) {
+      var edges = image.copy();
+      edges.cvtColor('CV_BGR2GRAY');
+      edges.canny(50, 150);
+      return function() { return edges.findContours(); };
+    }
+  },
+  {
+    name: 'matchTemplate',
+    binding: 'Matrix#matchTemplate',
+    native: 'matchTemplate',
+    setup: function(image) {
+      var w = image.width(), h = image.height();
+      var templ = image.crop(Math.floor(w * 7 / 16), Math.floor(h * 7 / 16), Math.floor(w / 8), Math.floor(h / 8)).clone();
+      return function() { return image.matchTemplate(templ, cv.Constants.TM_CCORR_NORMED); };
+    }
+  },
+  {
+    name: 'detectMultiScale',
+    binding: 'CascadeClassifier#detectMultiScale',
+    native: 'detectMultiScale',
+    setup: function(image) {
+      var cascade = new cv.CascadeClassifier(fixtures.cascade);
+      return function() {
+        return new Promise(function(resolve, reject) {
+          cascade.detectMultiScale(image, function(err, faces) {
+            if (err) reject(err); else resolve(faces);
+          });
+        });
+      };
+    }
+  },
+  {
+    name: 'VideoCapture.read',
+    binding: 'VideoCapture#read',
+    once: true,
+    setup: function() {
+      var cap = new cv.VideoCapture(fixtures.video);
+      return function() {
+        return new Promise(function(resolve, reject) {
+          cap.read(function(err, frame) {
+            if (err) return reject(err);
+            // Loop the clip
+            if (frame.empty()) cap.setPosition(0);
+            resolve(frame);
+          });
+        });
+      };
+    }
+  },
+  {
+    name: 'FaceRecognizer.predict',
+    binding: 'FaceRecognizer#predictSync',
+    once: true,
+    available: function() { return !!cv.FaceRecognizer; },
+    setup: function(image) {
+      var gray = image.copy();
+      gray.cvtColor('CV_BGR2GRAY');
+      // Four "people": the quadrants of the image, at the training size
+      var w = gray.width() >> 1, h = gray.height() >> 1;
+      var samples = [[0, 0], [w, 0], [0, h], [w, h]].map(function(p, id) {
+        return [id, gray.crop(p[0], p[1], w, h).resize({ width: 100, height: 100 })];
+      });
+      var recognizer = cv.FaceRecognizer.createLBPHFaceRecognizer();
+      recognizer.trainSync(samples);
+      var probe = samples[2][1];
+      return function() { return recognizer.predictSync(probe); };
+    }
+  },
+  {
+    name: 'StereoBM.compute',
+    binding: 'StereoBM#compute',
+    available: function() { return !!cv.StereoBM; },
+    setup: function(image) {
+      var gray = image.copy();
+      gray.cvtColor('CV_BGR2GRAY');
+      // A right view 8 pixels to the side of the left one
+      var w = gray.width() - 8, h = gray.height();
+      var left = gray.crop(8, 0, w, h).clone();
+      var right = gray.crop(0, 0, w, h).clone();
+      var bm = new cv.StereoBM();
+      return function() { return bm.compute(left, right); };
+    }
+  }
+];
+
+function now() {
+  var t = process.hrtime();
+  return t[0] * 1e6 + t[1] / 1e3;
+}
+
+function gc() {
+  if (global.gc) global.gc();
+}
+
+// Calls fn until `seconds` have passed, resolves with per-call microseconds.
+function sample(fn, seconds) {
+  var samples = [];
+  var deadline;
+
+  function next(warmup) {
+    if (warmup === 0) {
+      deadline = now() + seconds * 1e6;
+    }
+    if (warmup <= 0 && samples.length >= MAX_SAMPLES ||
+        warmup <= 0 && samples.length >= MIN_SAMPLES && now() >= deadline) {
+      return Promise.resolve(samples);
+    }
+
+    var start = now();
+    return Promise.resolve(fn()).then(function() {
+      if (warmup <= 0) samples.push(now() - start);
+      return next(warmup - 1);
+    });
+  }
+
+  return next(WARMUP);
+}
+
+function percentile(sorted, p) {
+  return sorted[Math.min(sorted.length - 1, Math.ceil(p * sorted.length) - 1)];
+}
+
+function summarize(samples) {
+  var sorted = Array.prototype.slice.call(samples).sort(function(a, b) { return a - b; });
+  var total = sorted.reduce(function(sum, t) { return sum + t; }, 0);
+  return {
+    iterations: sorted.length,
+    opsPerSec: sorted.length / (total / 1e6),
+    mean: total / sorted.length,
+    p50: percentile(sorted, 0.5),
+    p99: percentile(sorted, 0.99)
+  };
+}
+
+function runCase(bench, fixture, image) {
+  var fn = bench.setup(image, fixture);
+
+  gc();
+  cv.resetStats();
+  var before = process.memoryUsage();
+
+  return sample(fn, options.time).then(function(samples) {
+    var after = process.memoryUsage();
+    var result = summarize(samples);
+    result.name = bench.name;
+    result.fixture = bench.once ? null : fixture.name;
+    result.width = bench.once ? null : fixture.width;
+    result.height = bench.once ? null : fixture.height;
+
+    // Without --expose-gc these include garbage not yet collected
+    result.allocations = {
+      heapUsed: (after.heapUsed - before.heapUsed) / (samples.length + WARMUP),
+      external: (after.external - before.external) / (samples.length + WARMUP)
+    };
+    result.binding = cv.stats()[bench.binding] || null;
+
+    result.native = null;
+    if (native && bench.native) {
+      var n = Math.min(samples.length, MAX_NATIVE_SAMPLES);
+      result.native = summarize(native.run(bench.native, fixture.path, n, fixtures.cascade));
+    }
+    return result;
+  });
+}
+
+function format(result) {
+  function us(t) { return t < 1000 ? t.toFixed(1) + 'us' : (t / 1000).toFixed(2) + 'ms'; }
+  var line = [
+    (result.name + '          ').slice(0, 24),
+    ((result.fixture || '') + '                ').slice(0, 16),
+    (result.opsPerSec.toFixed(1) + ' ops/s            ').slice(0, 18),
+    'p50 ' + us(result.p50),
+    'p99 ' + us(result.p99)
+  ].join(' ');
+  if (result.native) {
+    line += '  (native p50 ' + us(result.native.p50) + ')';
+  }
+  return line;
+}
+
+function main() {
+  cv.enableStats(true);
+
+  return fixtures.prepare().then(function(list) {
+    var results = [];
+    var chain = Promise.resolve();
+
+    BENCHMARKS.forEach(function(bench) {
+      if (options.filter && !options.filter.test(bench.name)) return;
+      if (bench.available && !bench.available()) {
+        console.error(bench.name + ': not available in this OpenCV build, skipped');
+        return;
+      }
+
+      // Benchmarks that don't depend on the resolution run once
+      var cases = bench.once ? list.slice(0, 1) : list;
+      cases.forEach(function(fixture) {
+        chain = chain.then(function() {
+          return cv.readImage(fixture.path);
+        }).then(function(image) {
+          return runCase(bench, fixture, image);
+        }).then(function(result) {
+          console.error(format(result));
+          results.push(result);
+        });
+      });
+    });
+
+    return chain.then(function() {
+      return results;
+    });
+  }).then(function(results) {
+    var report = {
+      opencv: cv.version,
+      node: process.version,
+      platform: process.platform,
+      arch: process.arch,
+      cpus: os.cpus().length,
+      cpu: os.cpus()[0] && os.cpus()[0].model,
+      date: new Date().toISOString(),
+      secondsPerCase: options.time,
+      exposeGc: !!global.gc,
+      native: !!native,
+      results: results
+    };
+
+    var json = JSON.stringify(report, null, 2);
+    if (options.out) {
+      fs.writeFileSync(options.out, json + '\n');
+    } else {
+      console.log(json);
+    }
+  });
+}
+
+main().catch(function(err) {
+  console.error(err.stack || err);
+  process.exit(1);
+});
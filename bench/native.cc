@@ -0,0 +1,141 @@
+// Native baselines for bench/index.js: the same OpenCV calls the bindings
+// make, timed in a tight C++ loop. The difference to the JS numbers is what
+// the binding layer costs.
+//
+//   var native = require('../build/Release/bench_native.node');
+//   native.run('resize', 'bench/fixtures/mona-1280x720.png', 200);
+//   // Float64Array of per-iteration times in microseconds
+#include <nan.h>
+#include <opencv/cv.h>
+#include <opencv/highgui.h>
+#if CV_MAJOR_VERSION >= 3
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/objdetect.hpp>
+#else
+#include <opencv2/objdetect/objdetect.hpp>
+#endif
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+typedef void (*Body)(const cv::Mat &image, const std::vector<uchar> &file, void *state);
+
+static void Decode(const cv::Mat &image, const std::vector<uchar> &file, void *state) {
+  cv::Mat out = cv::imdecode(file, CV_LOAD_IMAGE_COLOR);
+}
+
+static void Encode(const cv::Mat &image, const std::vector<uchar> &file, void *state) {
+  std::vector<uchar> out;
+  cv::imencode(".jpg", image, out);
+}
+
+static void Resize(const cv::Mat &image, const std::vector<uchar> &file, void *state) {
+  cv::Mat out;
+  cv::resize(image, out, cv::Size(image.cols / 2, image.rows / 2));
+}
+
+static void CvtColor(const cv::Mat &image, const std::vector<uchar> &file, void *state) {
+  cv::Mat out;
+  cv::cvtColor(image, out, CV_BGR2GRAY);
+}
+
+static void FindContours(const cv::Mat &image, const std::vector<uchar> &file, void *state) {
+#if CV_MAJOR_VERSION < 3 || (CV_MAJOR_VERSION == 3 && CV_MINOR_VERSION < 2)
+  // It draws over its source up to OpenCV 3.2; the binding copies the edges
+  // first, so every iteration sees the same image there too
+  cv::Mat edges = static_cast<cv::Mat *>(state)->clone();
+#else
+  const cv::Mat &edges = *static_cast<cv::Mat *>(state);
+#endif
+  std::vector<std::vector<cv::Point> > contours;
+  std::vector<cv::Vec4i> hierarchy;
+  cv::findContours(edges, contours, hierarchy, CV_RETR_LIST, CV_CHAIN_APPROX_SIMPLE);
+}
+
+static void MatchTemplate(const cv::Mat &image, const std::vector<uchar> &file, void *state) {
+  const cv::Mat &templ = *static_cast<cv::Mat *>(state);
+  cv::Mat out;
+  cv::matchTemplate(image, templ, out, CV_TM_CCORR_NORMED);
+}
+
+static void DetectMultiScale(const cv::Mat &image, const std::vector<uchar> &file, void *state) {
+  cv::CascadeClassifier &cascade = *static_cast<cv::CascadeClassifier *>(state);
+  cv::Mat gray;
+  cv::cvtColor(image, gray, CV_BGR2GRAY);
+  cv::equalizeHist(gray, gray);
+  std::vector<cv::Rect> objects;
+  cascade.detectMultiScale(gray, objects, 1.1, 2, 0, cv::Size(30, 30));
+}
+
+// native.run(name, fixturePath, iterations[, cascadePath])
+NAN_METHOD(Run) {
+  if (info.Length() < 3 || !info[0]->IsString() || !info[1]->IsString() || !info[2]->IsNumber()) {
+    return Nan::ThrowTypeError("run takes a benchmark name, a fixture path and an iteration count");
+  }
+
+  std::string name = *Nan::Utf8String(info[0]);
+  std::string path = *Nan::Utf8String(info[1]);
+  int iterations = info[2]->Int32Value();
+
+  std::ifstream in(path.c_str(), std::ios::binary);
+  std::vector<uchar> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  cv::Mat image = cv::imdecode(file, CV_LOAD_IMAGE_COLOR);
+  if (image.empty()) {
+    return Nan::ThrowError(("Could not read " + path).c_str());
+  }
+
+  cv::Mat extra;
+  cv::CascadeClassifier cascade;
+  void *state = NULL;
+  Body body;
+
+  if (name == "readImage") {
+    body = Decode;
+  } else if (name == "toBuffer") {
+    body = Encode;
+  } else if (name == "resize") {
+    body = Resize;
+  } else if (name == "cvtColor") {
+    body = CvtColor;
+  } else if (name == "findContours") {
+    cv::cvtColor(image, extra, CV_BGR2GRAY);
+    cv::Canny(extra, extra, 50, 150);
+    state = &extra;
+    body = FindContours;
+  } else if (name == "matchTemplate") {
+    // Same template as the JS benchmark: the middle eighth of the image
+    extra = image(cv::Rect(image.cols * 7 / 16, image.rows * 7 / 16, image.cols / 8, image.rows / 8)).clone();
+    state = &extra;
+    body = MatchTemplate;
+  } else if (name == "detectMultiScale") {
+    if (info.Length() < 4 || !cascade.load(*Nan::Utf8String(info[3]))) {
+      return Nan::ThrowError("detectMultiScale needs a cascade file");
+    }
+    state = &cascade;
+    body = DetectMultiScale;
+  } else {
+    return Nan::ThrowTypeError(("No native benchmark named " + name).c_str());
+  }
+
+  v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(),
+      iterations * sizeof(double));
+  double *times = static_cast<double *>(buffer->GetContents().Data());
+
+  for (int i = 0; i < iterations; i++) {
+    int64 start = cv::getTickCount();
+    body(image, file, state);
+    times[i] = (cv::getTickCount() - start) * 1e6 / cv::getTickFrequency();
+  }
+
+  info.GetReturnValue().Set(v8::Float64Array::New(buffer, 0, iterations));
+}
+
+void Init(v8::Local<v8::Object> exports) {
+  exports->Set(Nan::New("run").ToLocalChecked(),
+               Nan::New<v8::FunctionTemplate>(Run)->GetFunction());
+}
+
+NODE_MODULE(bench_native, Init)
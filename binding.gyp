@@ -6,7 +6,16 @@
       "sources": [
         "src/init.cc",
         "src/Matrix.cc",
+        "src/MatrixFile.cc",
+        "src/MatrixOps.cc",
+        "src/Encoder.cc",
+        "src/Pipeline.cc",
+        "src/Tiles.cc",
         "src/OpenCV.cc",
+        "src/ImageHeader.cc",
+        "src/ImagePages.cc",
+        "src/ImageDecoder.cc",
+        "src/DecodeCache.cc",
         "src/CascadeClassifierWrap.cc",
         "src/Contours.cc",
         "src/Point.cc",
@@ -23,7 +32,10 @@
         "src/Calib3D.cc",
         "src/ImgProc.cc",
         "src/Stereo.cc",
-        "src/LDAWrap.cc"
+        "src/LDAWrap.cc",
+        "src/MatPool.cc",
+        "src/WorkerPool.cc",
+        "src/Stats.cc"
       ],
 
       "libraries": [
@@ -156,6 +168,62 @@
         }]
     ]
   },
+  {
+      "target_name": "bench_native",
+
+      "sources": [
+        "bench/native.cc",
+      ],
+
+      "libraries": [
+        "<!@(node utils/find-opencv.js --libs)",
+      ],
+      # For windows
+
+      "include_dirs": [
+        "<!@(node utils/find-opencv.js --cflags)",
+        "<!(node -e \"require('nan')\")"
+      ],
+
+      "cflags!" : [ "-fno-exceptions"],
+      "cflags_cc!": [ "-fno-rtti",  "-fno-exceptions"],
+
+      "conditions": [
+        [ "OS==\"linux\"", {
+            "cflags": [
+              "<!@(node utils/find-opencv.js --cflags)",
+              "-Wall"
+            ]
+        }],
+        [ "OS==\"win\"", {
+            "cflags": [
+              "-Wall"
+            ],
+            "defines": [
+                "WIN"
+            ],
+            "msvs_settings": {
+              "VCCLCompilerTool": {
+                "ExceptionHandling": "2",
+                "DisableSpecificWarnings": [ "4530", "4506", "4244" ],
+              },
+            }
+        }],
+        [ # cflags on OS X are stupid and have to be defined like this
+          "OS==\"mac\"", {
+            "xcode_settings": {
+            "OTHER_CFLAGS": [
+              "-mmacosx-version-min=10.7",
+              "-std=c++11",
+              "-stdlib=libc++",
+              "<!@(node utils/find-opencv.js --cflags)",
+            ],
+            "GCC_ENABLE_CPP_RTTI": "YES",
+            "GCC_ENABLE_CPP_EXCEPTIONS": "YES"
+          }
+        }]
+    ]
+  },
     {
       "target_name": "action_after_build",
       "type": "none",
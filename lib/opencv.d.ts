@@ -24,6 +24,8 @@ declare module 'opencv' {
     }
     
     export type RectLike = Point2F & SizeLike;
+    // Element type follows the matrix depth.
+    export type PixelArray = Uint8Array | Int8Array | Uint16Array | Int16Array | Int32Array | Float32Array | Float64Array;
 
     export type ScalarLike = [number, number, number, number];
 
@@ -145,6 +147,66 @@ declare module 'opencv' {
     export function readImage(filename: string): Promise<Matrix>;
     export function readImage(buffer: Buffer, callback: (err: Error, image: Matrix) => void): void;
     export function readImage(filename: string, callback: (err: Error, image: Matrix) => void): void;
+    // mode also takes cv.Constants.IMREAD_* flags. maxSize scales images down to fit.
+    export type ReadImageOptions = { mode?: "color" | "grayscale" | "unchanged" | number, maxSize?: number };
+    export function readImage(input: string | Buffer, options: ReadImageOptions): Promise<Matrix>;
+    export function readImage(input: string | Buffer, options: ReadImageOptions, callback: (err: Error, image: Matrix) => void): void;
+    // One Matrix, or an Error for inputs that failed to decode, per input, in order.
+    export type ReadImagesOptions = ReadImageOptions & { concurrency?: number, onImage?: (err: Error, image: Matrix, index: number) => void };
+    export function readImages(inputs: (string | Buffer)[], options?: ReadImagesOptions): Promise<(Matrix | Error)[]>;
+    export function readImages(inputs: (string | Buffer)[], callback: (err: Error, images: (Matrix | Error)[]) => void): void;
+    export function readImages(inputs: (string | Buffer)[], options: ReadImagesOptions, callback: (err: Error, images: (Matrix | Error)[]) => void): void;
+    export function readImageMulti(filename: string, callback: (err: Error, images: Matrix[]) => void): void;
+    // Also async iterable where Symbol.asyncIterator exists.
+    export class ImagePages {
+        constructor(filename: string, options?: { mode?: "color" | "grayscale" | "unchanged" | number, prefetch?: number });
+        next(): Promise<{ done: boolean, value: Matrix }>;
+        next(callback: (err: Error, result: { done: boolean, value: Matrix }) => void): void;
+        return(): Promise<{ done: boolean, value: undefined }>;
+        close(): void;
+    }
+    export function readImagePages(filename: string, options?: { mode?: "color" | "grayscale" | "unchanged" | number, prefetch?: number }): ImagePages;
+    export type ImageHeader = { format: "jpeg" | "png" | "bmp" | "tiff" | "webp", width: number, height: number, channels: number, depth: number, pages: number };
+    export function probeImage(input: string | Buffer): Promise<ImageHeader>;
+    export function probeImage(input: string | Buffer, callback: (err: Error, header: ImageHeader) => void): void;
+    export class ImageDecoder {
+        constructor(options?: ReadImageOptions);
+        push(chunk: Buffer): void;
+        header(): ImageHeader | null;
+        decode(): Promise<Matrix>;
+        decode(callback: (err: Error, image: Matrix) => void): void;
+    }
+    export function setDecodeCache(options: { enabled?: boolean, maxBytes?: number }): void;
+    export function decodeCacheStats(): { enabled: boolean, maxBytes: number, bytes: number, hits: number, misses: number, evictions: number, copies: number };
+    export function setMatPool(options: { enabled?: boolean, maxBytes?: number, hugePages?: boolean }): void;
+    export function matPoolStats(): { enabled: boolean, hugePages: boolean, maxBytes: number, retainedBytes: number, hits: number, misses: number };
+
+    type WorkerLane = "interactive" | "batch";
+    export function setWorkerPool(options: { threads?: number, pin?: boolean, opencvThreads?: number }): void;
+    export function workerPoolStats(): { threads: number, pin: boolean, opencvThreads: number, pending: number, running: number, completed: number, queued: { interactive: number, batch: number } };
+    export function withLane<T>(lane: WorkerLane, fn: () => T): T;
+
+    // Microseconds. buckets holds [upper bound, count] pairs when asked for.
+    export type LatencyHistogram = { count: number, mean?: number, p50?: number, p90?: number, p99?: number, max?: number, buckets?: [number, number][] };
+    export type BindingStats = {
+        calls: number;
+        bytesIn: number;
+        bytesOut: number;
+        sync: LatencyHistogram;
+        async?: { wait: LatencyHistogram, execute: LatencyHistogram };
+    };
+    export function enableStats(on?: boolean): void;
+    export function stats(options?: { buckets?: boolean }): { [binding: string]: BindingStats };
+    export function resetStats(): void;
+
+    export type MatrixMemory = {
+        live: number;
+        bytes: number;
+        peakBytes: number;
+        sites: { [binding: string]: { live: number, bytes: number } };
+    };
+    export function matrixMemory(options?: { resetPeak?: boolean }): MatrixMemory;
+    export function sampleMatrixMemory(ms: number, callback: (memory: MatrixMemory) => void): () => void;
 
     export class Point {
         x: number;
@@ -196,6 +258,9 @@ declare module 'opencv' {
         export function Ones(width: number, height: number, type?: MatrixType): Matrix;
         export function Eye(width: number, height: number, type?: MatrixType): Matrix;
         export function getRotationMatrix2D(angle: number, x: number, y: number, scale?: number): Matrix;
+        export function fromBuffer(buf: Buffer, rows: number, cols: number, type: MatrixType, step?: number): Matrix;
+        export function loadRaw(path: string, options?: { mmap?: boolean, shared?: boolean }): Matrix;
+        export function createRaw(path: string, rows: number, cols: number, type: MatrixType): Matrix;
     }
 
     export class Matrix {
@@ -207,12 +272,27 @@ declare module 'opencv' {
         col(): number;
         pixelRow(y: number): number[];
         pixelCol(x: number): number[];
+        rowData(y: number): PixelArray;
+        colData(x: number): PixelArray;
+        regionData(rect: RectLike): PixelArray;
+        channelData(channel: number): PixelArray;
         empty(): boolean;
-        get(x: number, y: number): number;
-        set(x: number, y: number, value: number, channel?: number): void;
+        // A number for single channel matrices, channel values otherwise.
+        get(x: number, y: number): number | number[];
+        set(x: number, y: number, value: number | number[], channel?: number): void;
         put(buf: Buffer): void;
+        saveRaw(path: string): void;
+        saveRaw(path: string, callback: (err: Error) => void): void;
+        setData(data: Buffer | PixelArray, stride?: number): void;
+        putRegion(data: Buffer | PixelArray, rect: RectLike, options?: { channel?: number, stride?: number }): void;
         brightness(diff: number): void;
         brightness(alpha: number, beta: number): void;
+        brightness(alpha: number, beta: number, dst: Matrix): Matrix;
+        lut(table: number[] | Uint8Array | Matrix): void;
+        lut(table: number[] | Uint8Array | Matrix, dst: Matrix): Matrix;
+        gamma(gamma: number): void;
+        gamma(gamma: number, dst: Matrix): Matrix;
+        levels(inBlack: number, inWhite: number, gamma?: number, outBlack?: number, outWhite?: number): void;
         normalize(min: number, max: number, type?: NormalizationType, dtype?: number): void;
         norm(src2: Matrix): number;
         norm(type: NormalizationType): number;
@@ -220,6 +300,7 @@ declare module 'opencv' {
         norm(type: NormalizationType, mask: Matrix): number;
         norm(src2: Matrix, type: NormalizationType, mask: Matrix): number;
         getData(): Buffer;
+        data(): Buffer;
         pixel(x: number, y: number): ArrayColor | number;
         pixel(x: number, y: number, color?: ArrayColor | [number]): ArrayColor | [number];
         width(): number;
@@ -239,16 +320,23 @@ declare module 'opencv' {
         save(filename: string, callback: (err: Error, result: number) => void): void;
         saveAsync(filename: string, callback: (err: Error, result: number) => void): void;
         resize(size: SizeLike, fx?: number, fy?: number, interpolation?: InterpolationMode): Matrix;
+        resize(size: SizeLike, dst: Matrix): Matrix;
+        resize(size: SizeLike, fx: number, fy: number, interpolation: InterpolationMode, dst: Matrix): Matrix;
         rotate(angle: number, x: number, y: number): void;
         warpAffine(rotation: Matrix, dstRows: number, dstCols: number): void;
+        warpAffine(rotation: Matrix, dst: Matrix): Matrix;
+        warpAffine(rotation: Matrix, dstRows: number, dstCols: number, dst: Matrix): Matrix;
         copyTo(dst: Matrix, dstX: number, dstY: number): void;
         convertTo(dst: Matrix, type: MatrixType, scale?: number, delta?: number): void;
         pyrDown(): void;
+        pyrDown(dst: Matrix): Matrix;
         pyrUp(): void;
         channels(): number;
         convertGrayscale(): void;
         convertHSVscale(): void;
         gaussianBlur(ksize: ArraySize): void;
+        gaussianBlur(ksize: ArraySize, dst: Matrix): Matrix;
+        gaussianBlur(ksize: ArraySize, sigma: number, dst: Matrix): Matrix;
         medianBlur(ksize: number): void;
         bilateralFilter(): void;
         bilateralFilter(diameter: number, maxSigmaColor: number, sigmaSpace: number, borderType?: BorderType): void;
@@ -268,6 +356,7 @@ declare module 'opencv' {
         countNonZero(): number;
         moments(): Moments;
         canny(low: number, high: number): void;
+        canny(low: number, high: number, dst: Matrix): Matrix;
         dilate(iterations: number, kernel?: Matrix): void;
         erode(iterations: number, kernel?: Matrix): void;
         findContours(mode?: number, chain?: number): Contours;
@@ -277,12 +366,17 @@ declare module 'opencv' {
         houghLinesP(rho?: number, theta?: number, threshold?: number, minLineLength?: number, maxLineGap?: number): HoughLine[];
         houghCircles(dp?: number, minDist?: number, higherThreshold?: number, accumulatorThreshold?: number, minRadius?: number, maxRadius?: number): HoughCircle[];
         inRange(low: ArrayColor, high: ArrayColor): void;
+        inRange(low: ArrayColor, high: ArrayColor, dst: Matrix): Matrix;
         adjustROI(dtop: number, dbottom: number, dleft: number, dright: number): number;
         locateROI(): ArrayRect;
-        threshold(threshold: number, maxVal: number, type?: "Binary" | "Binary Inverted" | "Threshold Truncated" | "Threshold to Zero" | "Threshold to Zero Inverted", algorithm?: "Simple" | "Otsu"): Matrix;
+        threshold(threshold: number, maxVal: number, type?: "Binary" | "Binary Inverted" | "Threshold Truncated" | "Threshold to Zero" | "Threshold to Zero Inverted", algorithm?: "Simple" | "Otsu" | "Triangle"): Matrix;
+        threshold(threshold: number, maxVal: number, dst: Matrix): Matrix;
+        threshold(threshold: number, maxVal: number, type: "Binary" | "Binary Inverted" | "Threshold Truncated" | "Threshold to Zero" | "Threshold to Zero Inverted", dst: Matrix): Matrix;
+        threshold(threshold: number, maxVal: number, type: "Binary" | "Binary Inverted" | "Threshold Truncated" | "Threshold to Zero" | "Threshold to Zero Inverted", algorithm: "Simple" | "Otsu" | "Triangle", dst: Matrix): Matrix;
         adaptiveThreshold(maxVal: number, adaptiveMethod: AdaptiveThresholdMethod, thresholdType: ThresholdType, blockSize: number, C: number);
         meanStdDev(): { mean: Matrix, stddev: Matrix };
         cvtColor(code: "CV_BGR2GRAY" | "CV_GRAY2BGR" | "CV_BGR2XYZ" | "CV_XYZ2BGR" | "CV_BGR2YCrCb" | "CV_YCrCb2BGR" | "CV_BGR2HSV" | "CV_HSV2BGR" | "CV_BGR2HLS" | "CV_HLS2BGR" | "CV_BGR2Lab" | "CV_Lab2BGR" | "CV_BGR2Luv" | "CV_Luv2BGR" | "CV_BayerBG2BGR" | "CV_BayerGB2BGR" | "CV_BayerRG2BGR" | "CV_BayerGR2BGR" | "CV_BGR2RGB"): void;
+        cvtColor(code: string, dst: Matrix): Matrix;
         split(): Matrix[];
         merge(channels: Matrix[]): void;
         equalizeHist(): void;
@@ -294,6 +388,8 @@ declare module 'opencv' {
         putText(text: string, x: number, y: number, font?: "HERSEY_SIMPLEX" | "HERSEY_PLAIN" | "HERSEY_DUPLEX" | "HERSEY_COMPLEX" | "HERSEY_TRIPLEX" | "HERSEY_COMPLEX_SMALL" | "HERSEY_SCRIPT_SIMPLEX" | "HERSEY_SCRIPT_COMPLEX" | "HERSEY_SCRIPT_SIMPLEX", color?: ArrayColor, scale?: number, thickness?: number);
         getPerspectiveTransform(srcCorners: Point2F[], targetCorners: Point2F[]): Matrix;
         warpPerspective(M: Matrix, width: number, height: number, color?: ArrayColor): void;
+        warpPerspective(M: Matrix, width: number, height: number, dst: Matrix): Matrix;
+        warpPerspective(M: Matrix, width: number, height: number, color: ArrayColor, dst: Matrix): Matrix;
         copyWithMask(dst: Matrix, mask: Matrix): void;
         setWithMask(value: ArrayColor, mask: Matrix): void;
         meanWithMask(mask: Matrix): Scalar;
@@ -303,7 +399,72 @@ declare module 'opencv' {
         release(): void;
         subtract(src2: Matrix): void;
 
+        // Same arguments as the synchronous methods, run on the worker pool.
+        // Pass a callback as last argument instead to get (err, result).
+        resizeAsync(size: SizeLike, fx?: number, fy?: number, interpolation?: InterpolationMode, dst?: Matrix): Promise<Matrix>;
+        cvtColorAsync(code: string, dst?: Matrix): Promise<Matrix>;
+        convertGrayscaleAsync(): Promise<Matrix>;
+        gaussianBlurAsync(ksize?: ArraySize, sigma?: number, dst?: Matrix): Promise<Matrix>;
+        medianBlurAsync(ksize: number, dst?: Matrix): Promise<Matrix>;
+        bilateralFilterAsync(diameter?: number, maxSigmaColor?: number, sigmaSpace?: number, borderType?: BorderType, dst?: Matrix): Promise<Matrix>;
+        cannyAsync(low: number, high: number, dst?: Matrix): Promise<Matrix>;
+        dilateAsync(iterations: number, kernel?: Matrix, dst?: Matrix): Promise<Matrix>;
+        erodeAsync(iterations: number, kernel?: Matrix, dst?: Matrix): Promise<Matrix>;
+        thresholdAsync(threshold: number, maxVal: number, type?: string, algorithm?: "Simple" | "Otsu", dst?: Matrix): Promise<Matrix>;
+        adaptiveThresholdAsync(maxVal: number, adaptiveMethod: AdaptiveThresholdMethod, thresholdType: ThresholdType, blockSize: number, C: number, dst?: Matrix): Promise<Matrix>;
+        warpAffineAsync(rotation: Matrix, dstRows?: number, dstCols?: number, dst?: Matrix): Promise<Matrix>;
+        warpPerspectiveAsync(M: Matrix, width: number, height: number, color?: ArrayColor, dst?: Matrix): Promise<Matrix>;
+        pyrDownAsync(dst?: Matrix): Promise<Matrix>;
+        pyrUpAsync(dst?: Matrix): Promise<Matrix>;
+        inRangeAsync(low: ArrayColor, high: ArrayColor, dst?: Matrix): Promise<Matrix>;
+        equalizeHistAsync(dst?: Matrix): Promise<Matrix>;
+        brightnessAsync(alpha: number, beta: number, dst?: Matrix): Promise<Matrix>;
+        lutAsync(table: number[] | Uint8Array | Matrix, dst?: Matrix): Promise<Matrix>;
+        gammaAsync(gamma: number, dst?: Matrix): Promise<Matrix>;
+        levelsAsync(inBlack: number, inWhite: number, gamma?: number, outBlack?: number, outWhite?: number): Promise<Matrix>;
+        houghLinesPAsync(rho?: number, theta?: number, threshold?: number, minLineLength?: number, maxLineGap?: number): Promise<HoughLine[]>;
+        houghCirclesAsync(dp?: number, minDist?: number, higherThreshold?: number, accumulatorThreshold?: number, minRadius?: number, maxRadius?: number): Promise<HoughCircle[]>;
+        findContoursAsync(mode?: number, chain?: number): Promise<Contours>;
+        matchTemplateAsync(templ: Matrix, method: TemplateMatchMode, mask?: Matrix): Promise<Matrix>;
+        floodFillAsync(opt: { seedPoint: ArrayPoint, newColor: ArrayColor, rect: [ArrayPoint, ArraySize], loDiff: ArrayColor, upDiff: ArrayColor }): Promise<number>;
+
         detectObject(classifier: string, opts: CascadeClassifierOptions, callback: (err: Error, objects: RectLike[]) => void);
+
+        pipeline(steps: PipelineStep[] | Pipeline): Promise<any>;
+        pipeline(steps: PipelineStep[] | Pipeline, callback: (err: Error, result: any) => void): void;
+
+        tiles(options?: TileOptions): Tile[];
+        processTiles(steps: PipelineStep[] | Pipeline, options?: TileOptions): Promise<Matrix>;
+        processTiles(steps: PipelineStep[] | Pipeline, options: TileOptions, callback: (err: Error, result: Matrix) => void): void;
+        processTiles(steps: PipelineStep[] | Pipeline, callback: (err: Error, result: Matrix) => void): void;
+    }
+
+    interface TileOptions {
+        tile?: number | ArraySize;
+        overlap?: number;
+    }
+
+    interface Tile {
+        rect: RectLike;
+        halo: RectLike;
+        matrix: Matrix;
+    }
+
+    type PipelineStep = string | any[];
+
+    export class Encoder {
+        constructor(options?: Partial<MatrixToBufferOptions>);
+        encode(image: Matrix): Buffer;
+        encodeAsync(image: Matrix): Promise<Buffer>;
+        encodeAsync(image: Matrix, callback: (err: Error, buf: Buffer) => void): void;
+    }
+
+    export class Pipeline {
+        constructor(steps: PipelineStep[]);
+        run(image: Matrix): any;
+        runAsync(image: Matrix): Promise<any>;
+        runAsync(image: Matrix, callback: (err: Error, result: any) => void): void;
+        length(): number;
     }
 
     export class CascadeClassifier {
@@ -315,17 +476,43 @@ declare module 'opencv' {
         constructor(device: number);
         constructor(filename: string);
         read(callback: (err: Error, image: Matrix) => void): void;
+        // Reads into `frame`, a Matrix from an earlier read, and passes it back.
+        read(frame: Matrix, callback: (err: Error, image: Matrix) => void): void;
         setWidth(width: number): void;
         setHeight(height: number): void;
         setPosition(position: number): void;
         getFrameAt(position: number): void;
         getFrameCount(): number;
         release(): void;
-        ReadSync(): Matrix;
+        ReadSync(frame?: Matrix): Matrix;
         grab(callback: (err: Error, image: Matrix) => void): void;
         retrieve(callback: (err: Error, image: Matrix) => void, channel: number): void;
         toStream(): VideoStream;
-    }
+
+        // While capturing, read() takes frames from the ring, and returns a
+        // Promise without a callback.
+        read(): Promise<Matrix>;
+        read(frame: Matrix): Promise<Matrix>;
+        startCapture(options?: { policy?: "latest" | "fifo", size?: number, bufferSize?: number, fourcc?: string }): void;
+        stopCapture(callback: (err: Error) => void): void;
+        stopCapture(): Promise<void>;
+        captureStats(): CaptureStats | null;
+        setFramePool(options: { size: number }): void;
+        framePoolStats(): { size: number, lent: number, reused: number, allocated: number };
+    }
+
+    export type CaptureStats = {
+        policy: "latest" | "fifo";
+        size: number;
+        captured: number;
+        delivered: number;
+        dropped: number;
+        ready: number;
+        waiting: number;
+        ended: boolean;
+        bufferSize: number;
+        fourcc: string;
+    };
 
     export class Contours {
         point(pos: number, index: number): Point2F;
@@ -437,6 +624,19 @@ declare module 'opencv' {
         const TM_CCORR_NORMED: TemplateMatchMode;
         const TM_CCOEFF: TemplateMatchMode;
         const TM_CCOEFF_NORMED: TemplateMatchMode;
+
+        const IMREAD_UNCHANGED: number;
+        const IMREAD_GRAYSCALE: number;
+        const IMREAD_COLOR: number;
+        const IMREAD_ANYDEPTH: number;
+        const IMREAD_ANYCOLOR: number;
+        // OpenCV 3.2 and later
+        const IMREAD_REDUCED_GRAYSCALE_2: number;
+        const IMREAD_REDUCED_COLOR_2: number;
+        const IMREAD_REDUCED_GRAYSCALE_4: number;
+        const IMREAD_REDUCED_COLOR_4: number;
+        const IMREAD_REDUCED_GRAYSCALE_8: number;
+        const IMREAD_REDUCED_COLOR_8: number;
     }
 
     export namespace calib3d {
@@ -524,11 +724,14 @@ declare module 'opencv' {
     }
 
     export class ImageDataStream extends Stream {
+        constructor(options?: ReadImageOptions);
         writable: boolean;
+        header: ImageHeader | null;
         write(buf: Buffer): void;
         end(buf?: Buffer): void;
 
         on(event: "error", listener: (err: Error) => void): this;
+        on(event: "header", listener: (header: ImageHeader) => void): this;
         on(event: "load", listener: (image: Matrix) => void): this;
     }
 
@@ -1,5 +1,4 @@
 var Stream = require('stream').Stream
-  , Buffers = require('buffers')
   , util = require('util')
   , path = require('path');
 
@@ -7,6 +6,7 @@ var cv = module.exports = require('./bindings');
 
 var Matrix = cv.Matrix
   , Size = cv.Size
+  , Pipeline = cv.Pipeline
   , VideoCapture = cv.VideoCapture
   , ImageStream
   , ImageDataStream
@@ -28,6 +28,46 @@ Matrix.prototype.detectObject = function(classifier, opts, cb) {
 };
 
 
+// Runs a list of steps, or a compiled cv.Pipeline, off the main thread.
+// Compile once with `new cv.Pipeline(steps)` when running it on every frame.
+Matrix.prototype.pipeline = function(steps, cb) {
+  var pipeline = steps instanceof Pipeline ? steps : new Pipeline(steps);
+  return pipeline.runAsync(this, cb);
+};
+
+
+// Reads a multi-page image one page at a time, see cv.ImagePages. Works with
+// `for await` where async iterators exist.
+cv.readImagePages = function(path, opts) {
+  return new cv.ImagePages(path, opts);
+};
+
+if (typeof Symbol !== 'undefined' && Symbol.asyncIterator) {
+  cv.ImagePages.prototype[Symbol.asyncIterator] = function() {
+    return this;
+  };
+  cv.ImagePages.prototype.return = function() {
+    this.close();
+    return Promise.resolve({ done: true, value: undefined });
+  };
+}
+
+
+// Calls cb with cv.matrixMemory() every `ms` milliseconds, e.g. to log it or
+// to stop taking work above a limit. Returns a function that stops sampling.
+// The timer doesn't keep the process alive.
+cv.sampleMatrixMemory = function(ms, cb) {
+  var timer = setInterval(function() {
+    cb(cv.matrixMemory());
+  }, ms);
+  if (timer.unref) timer.unref();
+
+  return function() {
+    clearInterval(timer);
+  };
+};
+
+
 Matrix.prototype.inspect = function() {
   return '[ Matrix ' + this.size() + ' ]';
 };
@@ -52,25 +92,31 @@ ImageStream.prototype.write = function(buf){
 }
 
 
-ImageDataStream = cv.ImageDataStream = function(){
-  this.data = Buffers([]);
+// Collects the chunks of one image in a native cv.ImageDecoder. Emits
+// 'header' as soon as the size of the image is known, and 'load' with the
+// image. `opts` are those of cv.ImageDecoder.
+ImageDataStream = cv.ImageDataStream = function(opts){
+  this.decoder = new cv.ImageDecoder(opts);
+  this.header = null;
   this.writable = true;
 }
 util.inherits(ImageDataStream, Stream);
 
 
 ImageDataStream.prototype.write = function(buf){
-  this.data.push(buf);
+  this.decoder.push(buf);
+  if (!this.header && (this.header = this.decoder.header())) {
+    this.emit('header', this.header);
+  }
   return true;
 }
 
 
 ImageDataStream.prototype.end = function(b){
   var self = this;
-  if (b) ImageStream.prototype.write.call(this, b);
+  if (b) this.write(b);
 
-  var buf = this.data.toBuffer();
-  cv.readImage(buf, function(err, im){
+  this.decoder.decode(function(err, im){
     if (err) return self.emit('error', err);
     self.emit('load', im);
   });
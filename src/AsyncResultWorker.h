@@ -0,0 +1,124 @@
+#ifndef __NODE_ASYNCRESULTWORKER_H
+#define __NODE_ASYNCRESULTWORKER_H
+
+#include "OpenCV.h"
+
+#include <utility>
+
+/**
+ * Worker that settles with a single JS value, either through a node style
+ * callback or a Promise. Subclasses do their work in Execute() and turn it
+ * into a value in Result(); CallbackWorker and PromiseWorker decide how that
+ * value is delivered. Use NewAsyncResultWorker to pick one from the arguments.
+ */
+class AsyncResultWorker : public Nan::AsyncWorker {
+public:
+  AsyncResultWorker(): Nan::AsyncWorker(nullptr) {}
+
+protected:
+  // Main thread, only called when Execute() succeeded.
+  virtual Local<Value> Result() = 0;
+
+  // Main thread. Passed to callbacks after the error, for the methods that
+  // always called back with a value; nothing by default.
+  virtual Local<Value> FailureResult() {
+    return Local<Value>();
+  }
+
+  virtual void OnSuccess(Local<Value> value) = 0;
+  virtual void OnFailure(Local<Value> error) = 0;
+
+  void HandleOKCallback() override {
+    Nan::HandleScope scope;
+
+    OnSuccess(Result());
+  }
+
+  void HandleErrorCallback() override {
+    Nan::HandleScope scope;
+
+    OnFailure(Nan::Error(ErrorMessage()));
+  }
+};
+
+// Calls the function stored in persistent slot 0 with (err) or (undefined, value).
+template <class Worker>
+class CallbackWorker : public Worker {
+public:
+  template <typename... Args>
+  CallbackWorker(Args&&... args): Worker(std::forward<Args>(args)...) {}
+
+protected:
+  void OnSuccess(Local<Value> value) override {
+    Nan::HandleScope scope;
+
+    Local<Value> argv[2] = {Nan::Undefined(), value};
+    ExecuteCallback(2, argv);
+  }
+
+  void OnFailure(Local<Value> error) override {
+    Nan::HandleScope scope;
+
+    Local<Value> argv[2] = {error, this->FailureResult()};
+    ExecuteCallback(argv[1].IsEmpty() ? 1 : 2, argv);
+  }
+
+private:
+  void ExecuteCallback(const int &argc, Local<Value> argv[]) {
+    Nan::HandleScope scope;
+
+    Local<Function> callback = Local<Function>::Cast(this->GetFromPersistent(0u));
+
+    Nan::TryCatch try_catch;
+    callback->Call(Nan::GetCurrentContext()->Global(), argc, argv);
+    if (try_catch.HasCaught()) {
+      Nan::FatalException(try_catch);
+    }
+  }
+};
+
+// Settles the Promise::Resolver stored in persistent slot 0.
+template <class Worker>
+class PromiseWorker : public Worker {
+public:
+  template <typename... Args>
+  PromiseWorker(Args&&... args): Worker(std::forward<Args>(args)...) {}
+
+protected:
+  void OnSuccess(Local<Value> value) override {
+    GetPromise()->Resolve(Nan::GetCurrentContext(), value);
+    Isolate::GetCurrent()->RunMicrotasks();
+  }
+
+  void OnFailure(Local<Value> error) override {
+    GetPromise()->Reject(Nan::GetCurrentContext(), error);
+    Isolate::GetCurrent()->RunMicrotasks();
+  }
+
+private:
+  Local<Promise::Resolver> GetPromise() {
+    return Local<Promise::Resolver>::Cast(this->GetFromPersistent(0u));
+  }
+};
+
+// Creates a Worker that calls back info[callbackIndex], or, when
+// callbackIndex is negative, returns a Promise from the current method.
+// The caller still has to queue it.
+template <class Worker, typename... Args>
+Worker* NewAsyncResultWorker(Nan::NAN_METHOD_ARGS_TYPE info, int callbackIndex, Args&&... args) {
+  Worker *worker;
+
+  if (callbackIndex >= 0) {
+    worker = new CallbackWorker<Worker>(std::forward<Args>(args)...);
+    worker->SaveToPersistent(0u, info[callbackIndex]);
+  } else {
+    Local<Promise::Resolver> resolver = Promise::Resolver::New(Nan::GetCurrentContext()).ToLocalChecked();
+    worker = new PromiseWorker<Worker>(std::forward<Args>(args)...);
+    worker->SaveToPersistent(0u, resolver);
+    info.GetReturnValue().Set(resolver->GetPromise());
+  }
+
+  return worker;
+}
+
+#endif
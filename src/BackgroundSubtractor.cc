@@ -1,4 +1,5 @@
 #include "BackgroundSubtractor.h"
+#include "Stats.h"
 #include "Matrix.h"
 #include <iostream>
 #include <nan.h>
@@ -24,8 +25,8 @@ void BackgroundSubtractorWrap::Init(Local<Object> target) {
   ctor->InstanceTemplate()->SetInternalFieldCount(1);
   ctor->SetClassName(Nan::New("BackgroundSubtractor").ToLocalChecked());
 
-  Nan::SetMethod(ctor, "createMOG", CreateMOG);
-  Nan::SetPrototypeMethod(ctor, "applyMOG", ApplyMOG);
+  Stats::SetMethod(ctor, "createMOG", CreateMOG);
+  Stats::SetPrototypeMethod(ctor, "applyMOG", ApplyMOG);
 
   target->Set(Nan::New("BackgroundSubtractor").ToLocalChecked(), ctor->GetFunction());
 }
@@ -91,9 +92,9 @@ NAN_METHOD(BackgroundSubtractorWrap::ApplyMOG) {
     if (Buffer::HasInstance(info[0])) {
       uint8_t *buf = (uint8_t *) Buffer::Data(info[0]->ToObject());
       unsigned len = Buffer::Length(info[0]->ToObject());
-      cv::Mat *mbuf = new cv::Mat(len, 1, CV_64FC1, buf);
-      mat = cv::imdecode(*mbuf, -1);
-      //mbuf->release();
+      // A header over the Buffer's bytes, nothing to free
+      cv::Mat mbuf(1, len, CV_8UC1, buf);
+      mat = cv::imdecode(mbuf, -1);
     } else {
       Matrix *_img = Nan::ObjectWrap::Unwrap<Matrix>(info[0]->ToObject());
       mat = (_img->mat).clone();
@@ -107,6 +108,7 @@ NAN_METHOD(BackgroundSubtractorWrap::ApplyMOG) {
     self->subtractor->operator()(mat, _fgMask);
 
     img->mat = _fgMask;
+    img->UpdateExternalMemory();
     mat.release();
 
     argv[0] = Nan::Null();
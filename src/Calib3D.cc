@@ -1,13 +1,9 @@
 #include "Calib3D.h"
+#include "Stats.h"
 #include "Matrix.h"
 
 inline Local<Object> matrixFromMat(cv::Mat &input) {
-  Local<Object> matrixWrap =
-      Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *matrix = Nan::ObjectWrap::Unwrap<Matrix>(matrixWrap);
-  matrix->mat = input;
-
-  return matrixWrap;
+  return Matrix::NewInstance(input);
 }
 
 inline cv::Mat matFromMatrix(Local<Value> matrix) {
@@ -110,15 +106,15 @@ void Calib3D::Init(Local<Object> target) {
   Local<Object> obj = Nan::New<Object>();
   inner.Reset(obj);
 
-  Nan::SetMethod(obj, "findChessboardCorners", FindChessboardCorners);
-  Nan::SetMethod(obj, "drawChessboardCorners", DrawChessboardCorners);
-  Nan::SetMethod(obj, "calibrateCamera", CalibrateCamera);
-  Nan::SetMethod(obj, "solvePnP", SolvePnP);
-  Nan::SetMethod(obj, "getOptimalNewCameraMatrix", GetOptimalNewCameraMatrix);
-  Nan::SetMethod(obj, "stereoCalibrate", StereoCalibrate);
-  Nan::SetMethod(obj, "stereoRectify", StereoRectify);
-  Nan::SetMethod(obj, "computeCorrespondEpilines", ComputeCorrespondEpilines);
-  Nan::SetMethod(obj, "reprojectImageTo3d", ReprojectImageTo3D);
+  Stats::SetMethod(obj, "findChessboardCorners", FindChessboardCorners);
+  Stats::SetMethod(obj, "drawChessboardCorners", DrawChessboardCorners);
+  Stats::SetMethod(obj, "calibrateCamera", CalibrateCamera);
+  Stats::SetMethod(obj, "solvePnP", SolvePnP);
+  Stats::SetMethod(obj, "getOptimalNewCameraMatrix", GetOptimalNewCameraMatrix);
+  Stats::SetMethod(obj, "stereoCalibrate", StereoCalibrate);
+  Stats::SetMethod(obj, "stereoRectify", StereoRectify);
+  Stats::SetMethod(obj, "computeCorrespondEpilines", ComputeCorrespondEpilines);
+  Stats::SetMethod(obj, "reprojectImageTo3d", ReprojectImageTo3D);
 
   target->Set(Nan::New("calib3d").ToLocalChecked(), obj);
 }
@@ -173,7 +169,8 @@ NAN_METHOD(Calib3D::DrawChessboardCorners) {
   try {
     // Get the arguments
 
-    // Arg 0 is the image
+    // Arg 0 is the image, drawn on in place
+    Nan::ObjectWrap::Unwrap<Matrix>(info[0]->ToObject())->MakeWritable();
     cv::Mat mat = matFromMatrix(info[0]);
 
     // Arg 1 is the pattern size
@@ -1,4 +1,5 @@
 #include "CamShift.h"
+#include "Stats.h"
 #include "OpenCV.h"
 #include "Matrix.h"
 
@@ -25,7 +26,7 @@ void TrackedObject::Init(Local<Object> target) {
   // Prototype
   // Local<ObjectTemplate> proto = constructor->PrototypeTemplate();
 
-  Nan::SetPrototypeMethod(ctor, "track", Track);
+  Stats::SetPrototypeMethod(ctor, "track", Track);
 
   target->Set(Nan::New("TrackedObject").ToLocalChecked(), ctor->GetFunction());
 }
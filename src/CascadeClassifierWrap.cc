@@ -1,6 +1,8 @@
 #include "CascadeClassifierWrap.h"
+#include "Stats.h"
 #include "OpenCV.h"
 #include "Matrix.h"
+#include "WorkerPool.h"
 #include <nan.h>
 
 Nan::Persistent<FunctionTemplate> CascadeClassifierWrap::constructor;
@@ -16,7 +18,7 @@ void CascadeClassifierWrap::Init(Local<Object> target) {
   // Prototype
   // Local<ObjectTemplate> proto = constructor->PrototypeTemplate();
 
-  Nan::SetPrototypeMethod(ctor, "detectMultiScale", DetectMultiScale);
+  Stats::SetPrototypeMethod(ctor, "detectMultiScale", DetectMultiScale);
 
   target->Set(Nan::New("CascadeClassifier").ToLocalChecked(), ctor->GetFunction());
 }
@@ -145,7 +147,7 @@ NAN_METHOD(CascadeClassifierWrap::DetectMultiScale) {
 
   Nan::Callback *callback = new Nan::Callback(cb.As<Function>());
 
-  Nan::AsyncQueueWorker( new AsyncDetectMultiScale(callback, self, im, scale,
+  WorkerPool::Queue( new AsyncDetectMultiScale(callback, self, im, scale,
           neighbors, minw, minh));
   return;
 }
@@ -108,6 +108,20 @@ void Constants::Init(Local<Object> target) {
   CONST_INT(CV_DIST_MASK_5);
   CONST_INT(CV_DIST_MASK_PRECISE);
 
+  CONST_ENUM(IMREAD_UNCHANGED);
+  CONST_ENUM(IMREAD_GRAYSCALE);
+  CONST_ENUM(IMREAD_COLOR);
+  CONST_ENUM(IMREAD_ANYDEPTH);
+  CONST_ENUM(IMREAD_ANYCOLOR);
+#if CV_MAJOR_VERSION > 3 || (CV_MAJOR_VERSION == 3 && CV_MINOR_VERSION >= 2)
+  CONST_ENUM(IMREAD_REDUCED_GRAYSCALE_2);
+  CONST_ENUM(IMREAD_REDUCED_COLOR_2);
+  CONST_ENUM(IMREAD_REDUCED_GRAYSCALE_4);
+  CONST_ENUM(IMREAD_REDUCED_COLOR_4);
+  CONST_ENUM(IMREAD_REDUCED_GRAYSCALE_8);
+  CONST_ENUM(IMREAD_REDUCED_COLOR_8);
+#endif
+
   target->Set(Nan::New("TERM_CRITERIA_EPS").ToLocalChecked(), Nan::New<Integer>((int)cv::TermCriteria::EPS));
   target->Set(Nan::New("TERM_CRITERIA_COUNT").ToLocalChecked(), Nan::New<Integer>((int)cv::TermCriteria::COUNT));
 
@@ -1,4 +1,5 @@
 #include "Contours.h"
+#include "Stats.h"
 #include "OpenCV.h"
 #include <nan.h>
 
@@ -17,22 +18,22 @@ void Contour::Init(Local<Object> target) {
 
   // Prototype
   // Local<ObjectTemplate> proto = constructor->PrototypeTemplate();
-  Nan::SetPrototypeMethod(ctor, "point", Point);
-  Nan::SetPrototypeMethod(ctor, "points", Points);
-  Nan::SetPrototypeMethod(ctor, "size", Size);
-  Nan::SetPrototypeMethod(ctor, "cornerCount", CornerCount);
-  Nan::SetPrototypeMethod(ctor, "area", Area);
-  Nan::SetPrototypeMethod(ctor, "arcLength", ArcLength);
-  Nan::SetPrototypeMethod(ctor, "approxPolyDP", ApproxPolyDP);
-  Nan::SetPrototypeMethod(ctor, "convexHull", ConvexHull);
-  Nan::SetPrototypeMethod(ctor, "boundingRect", BoundingRect);
-  Nan::SetPrototypeMethod(ctor, "minAreaRect", MinAreaRect);
-  Nan::SetPrototypeMethod(ctor, "fitEllipse", FitEllipse);
-  Nan::SetPrototypeMethod(ctor, "isConvex", IsConvex);
-  Nan::SetPrototypeMethod(ctor, "moments", Moments);
-  Nan::SetPrototypeMethod(ctor, "hierarchy", Hierarchy);
-  Nan::SetPrototypeMethod(ctor, "serialize", Serialize);
-  Nan::SetPrototypeMethod(ctor, "deserialize", Deserialize);
+  Stats::SetPrototypeMethod(ctor, "point", Point);
+  Stats::SetPrototypeMethod(ctor, "points", Points);
+  Stats::SetPrototypeMethod(ctor, "size", Size);
+  Stats::SetPrototypeMethod(ctor, "cornerCount", CornerCount);
+  Stats::SetPrototypeMethod(ctor, "area", Area);
+  Stats::SetPrototypeMethod(ctor, "arcLength", ArcLength);
+  Stats::SetPrototypeMethod(ctor, "approxPolyDP", ApproxPolyDP);
+  Stats::SetPrototypeMethod(ctor, "convexHull", ConvexHull);
+  Stats::SetPrototypeMethod(ctor, "boundingRect", BoundingRect);
+  Stats::SetPrototypeMethod(ctor, "minAreaRect", MinAreaRect);
+  Stats::SetPrototypeMethod(ctor, "fitEllipse", FitEllipse);
+  Stats::SetPrototypeMethod(ctor, "isConvex", IsConvex);
+  Stats::SetPrototypeMethod(ctor, "moments", Moments);
+  Stats::SetPrototypeMethod(ctor, "hierarchy", Hierarchy);
+  Stats::SetPrototypeMethod(ctor, "serialize", Serialize);
+  Stats::SetPrototypeMethod(ctor, "deserialize", Deserialize);
   target->Set(Nan::New("Contours").ToLocalChecked(), ctor->GetFunction());
 };
 
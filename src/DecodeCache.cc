@@ -0,0 +1,220 @@
+#include "DecodeCache.h"
+#include "Stats.h"
+
+#include <sys/stat.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+void DecodeCache::Init(Local<Object> target) {
+  Nan::HandleScope scope;
+
+  Stats::SetMethod(target, "setDecodeCache", SetDecodeCache);
+  Stats::SetMethod(target, "decodeCacheStats", DecodeCacheStats);
+}
+
+class Cache {
+public:
+  Cache(): enabled(false), maxBytes(64 << 20), bytes(0),
+    hits(0), misses(0), evictions(0), copies(0) {}
+
+  bool Get(const std::string &key, cv::Mat &mat) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unordered_map<std::string, EntryList::iterator>::iterator it = index.find(key);
+    if (it == index.end()) {
+      misses++;
+      return false;
+    }
+    // Most recently used first
+    entries.splice(entries.begin(), entries, it->second);
+    mat = it->second->mat;
+    hits++;
+    return true;
+  }
+
+  void Put(const std::string &key, const cv::Mat &mat) {
+    size_t size = mat.total() * mat.elemSize();
+    // Released outside the lock
+    EntryList dropped;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (size > maxBytes || index.count(key)) {
+        return;
+      }
+      entries.push_front(Entry(key, mat, size));
+      index[key] = entries.begin();
+      bytes += size;
+      Trim(maxBytes, dropped);
+    }
+  }
+
+  void Configure(bool enabled, size_t maxBytes) {
+    EntryList dropped;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      this->enabled = enabled;
+      this->maxBytes = maxBytes;
+      Trim(enabled ? maxBytes : 0, dropped);
+    }
+  }
+
+  std::atomic<bool> enabled;
+  size_t maxBytes;
+  size_t bytes;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  std::atomic<uint64_t> copies;
+  std::mutex mutex;
+
+private:
+  struct Entry {
+    Entry(const std::string &key, const cv::Mat &mat, size_t size): key(key), mat(mat), size(size) {}
+
+    std::string key;
+    cv::Mat mat;
+    size_t size;
+  };
+  typedef std::list<Entry> EntryList;
+
+  // Moves least recently used entries to `dropped` until at most `limit`
+  // bytes are left. Called with the mutex held.
+  void Trim(size_t limit, EntryList &dropped) {
+    while (bytes > limit && !entries.empty()) {
+      bytes -= entries.back().size;
+      index.erase(entries.back().key);
+      dropped.splice(dropped.begin(), entries, --entries.end());
+      evictions++;
+    }
+  }
+
+  EntryList entries;
+  std::unordered_map<std::string, EntryList::iterator> index;
+};
+
+// Outlives static destructors, like the MatPool.
+static Cache &cache = *new Cache();
+
+std::string DecodeCache::PathKey(const std::string &path, const std::string &options) {
+  struct stat st;
+  if (!cache.enabled || stat(path.c_str(), &st) != 0) {
+    return "";
+  }
+
+  long long nsec = 0;
+#if defined(__linux__)
+  nsec = st.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+  nsec = st.st_mtimespec.tv_nsec;
+#endif
+  char stamp[64];
+  snprintf(stamp, sizeof(stamp), "%lld.%09lld:%lld:", (long long) st.st_mtime, nsec,
+      (long long) st.st_size);
+  return "p:" + options + ":" + stamp + path;
+}
+
+// Two independent 64 bit lanes over 8 byte words, each finished with the
+// MurmurHash3 mixer.
+static uint64_t Mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+std::string DecodeCache::BufferKey(const uint8_t *data, size_t length, const std::string &options) {
+  if (!cache.enabled) {
+    return "";
+  }
+
+  uint64_t a = 0x9E3779B97F4A7C15ULL ^ length;
+  uint64_t b = 0xC2B2AE3D27D4EB4FULL + length;
+  size_t i = 0;
+  for (; i + 8 <= length; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, 8);
+    a = (a ^ word) * 0x87C37B91114253D5ULL;
+    a = (a << 31) | (a >> 33);
+    b = (b + word) * 0x4CF5AD432745937FULL;
+    b = (b << 27) | (b >> 37);
+  }
+  uint64_t tail = 0;
+  if (i < length) {
+    memcpy(&tail, data + i, length - i);
+  }
+  a = Mix(a ^ tail);
+  b = Mix(b + tail);
+
+  char hash[40];
+  snprintf(hash, sizeof(hash), "%016llx%016llx", (unsigned long long) a, (unsigned long long) b);
+  return "b:" + options + ":" + hash;
+}
+
+bool DecodeCache::Get(const std::string &key, cv::Mat &mat) {
+  return !key.empty() && cache.enabled && cache.Get(key, mat);
+}
+
+void DecodeCache::Put(const std::string &key, const cv::Mat &mat) {
+  if (!key.empty() && cache.enabled && !mat.empty()) {
+    cache.Put(key, mat);
+  }
+}
+
+void DecodeCache::RecordCopy() {
+  cache.copies++;
+}
+
+// cv.setDecodeCache({ enabled: true, maxBytes: 64 << 20 }). Disabling it
+// empties it.
+NAN_METHOD(DecodeCache::SetDecodeCache) {
+  Nan::HandleScope scope;
+
+  if (info.Length() < 1 || !info[0]->IsObject()) {
+    return Nan::ThrowTypeError("Argument 1 must be an object");
+  }
+
+  Local<Object> options = info[0]->ToObject();
+  bool enabled;
+  size_t maxBytes;
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    enabled = cache.enabled;
+    maxBytes = cache.maxBytes;
+  }
+
+  if (options->Has(Nan::New<String>("enabled").ToLocalChecked())) {
+    enabled = options->Get(Nan::New<String>("enabled").ToLocalChecked())->BooleanValue();
+  }
+  if (options->Has(Nan::New<String>("maxBytes").ToLocalChecked())) {
+    double value = options->Get(Nan::New<String>("maxBytes").ToLocalChecked())->NumberValue();
+    if (!(value >= 0)) {
+      return Nan::ThrowRangeError("maxBytes must be >= 0");
+    }
+    maxBytes = (size_t) value;
+  }
+
+  cache.Configure(enabled, maxBytes);
+}
+
+NAN_METHOD(DecodeCache::DecodeCacheStats) {
+  Nan::HandleScope scope;
+
+  Local<Object> stats = Nan::New<Object>();
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    stats->Set(Nan::New<String>("enabled").ToLocalChecked(), Nan::New<Boolean>(cache.enabled.load()));
+    stats->Set(Nan::New<String>("maxBytes").ToLocalChecked(), Nan::New<Number>(cache.maxBytes));
+    stats->Set(Nan::New<String>("bytes").ToLocalChecked(), Nan::New<Number>(cache.bytes));
+    stats->Set(Nan::New<String>("hits").ToLocalChecked(), Nan::New<Number>(cache.hits));
+    stats->Set(Nan::New<String>("misses").ToLocalChecked(), Nan::New<Number>(cache.misses));
+    stats->Set(Nan::New<String>("evictions").ToLocalChecked(), Nan::New<Number>(cache.evictions));
+    stats->Set(Nan::New<String>("copies").ToLocalChecked(), Nan::New<Number>(cache.copies.load()));
+  }
+
+  info.GetReturnValue().Set(stats);
+}
@@ -0,0 +1,45 @@
+#ifndef __NODE_DECODECACHE_H
+#define __NODE_DECODECACHE_H
+
+#include "OpenCV.h"
+
+#include <stdint.h>
+#include <string>
+
+/**
+ * Opt-in cache of decoded images behind readImage and readImages, for
+ * servers that decode the same watermarks and templates again and again:
+ *
+ *   cv.setDecodeCache({ enabled: true, maxBytes: 64 << 20 });
+ *   cv.decodeCacheStats(); // { hits, misses, evictions, copies, bytes, ... }
+ *
+ * Files are keyed by path, modification time and size, Buffers by a 128 bit
+ * hash of their bytes, both together with the decode options. The hash is
+ * fast rather than cryptographic. The least recently used images are
+ * dropped once the cache holds more than maxBytes of pixels.
+ *
+ * Every Matrix read through the cache shares its pixels with the cache and
+ * is copy-on-write: the first method that writes into it gives it its own
+ * copy first (counted in `copies`), so cached images never change.
+ */
+class DecodeCache {
+public:
+  static void Init(Local<Object> target);
+
+  // Worker safe. Keys for a file, "" when it can't be stat'ed, and for the
+  // bytes of an encoded image. `options` tells decodes of the same input apart.
+  static std::string PathKey(const std::string &path, const std::string &options);
+  static std::string BufferKey(const uint8_t *data, size_t length, const std::string &options);
+
+  // Worker safe. Both do nothing while the cache is disabled or `key` is "".
+  static bool Get(const std::string &key, cv::Mat &mat);
+  static void Put(const std::string &key, const cv::Mat &mat);
+
+  // Worker safe. Counts a copy-on-write copy.
+  static void RecordCopy();
+
+  static NAN_METHOD(SetDecodeCache);
+  static NAN_METHOD(DecodeCacheStats);
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include "Encoder.h"
+#include "Stats.h"
+#include "Matrix.h"
+#include "AsyncResultWorker.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <memory>
+
+// Room past the pixels themselves that a format may need.
+static const size_t kHeaderBytes = 4096;
+
+Nan::Persistent<FunctionTemplate> Encoder::constructor;
+
+void Encoder::Init(Local<Object> target) {
+  Nan::HandleScope scope;
+
+  Local<FunctionTemplate> ctor = Nan::New<FunctionTemplate>(Encoder::New);
+  constructor.Reset(ctor);
+  ctor->InstanceTemplate()->SetInternalFieldCount(1);
+  ctor->SetClassName(Nan::New("Encoder").ToLocalChecked());
+
+  Stats::SetPrototypeMethod(ctor, "encode", EncodeSync);
+  Stats::SetPrototypeMethod(ctor, "encodeAsync", EncodeAsync);
+
+  target->Set(Nan::New("Encoder").ToLocalChecked(), ctor->GetFunction());
+}
+
+bool Encoder::HasInstance(Local<Value> object) {
+  return Nan::New(constructor)->HasInstance(object);
+}
+
+NAN_METHOD(Encoder::New) {
+  Nan::HandleScope scope;
+
+  if (!info.IsConstructCall()) {
+    return Nan::ThrowTypeError("Cannot Instantiate without new");
+  }
+
+  Encoder *encoder = new Encoder();
+  try {
+    encoder->Parse(info[0]);
+  } catch (const char *msg) {
+    delete encoder;
+    return Nan::ThrowTypeError(msg);
+  }
+
+  encoder->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+void Encoder::Parse(Local<Value> arg) {
+  ext = ".jpg";
+  params.clear();
+
+  if (arg->IsUndefined()) {
+    return;
+  }
+  if (!arg->IsObject() || arg->IsFunction()) {
+    throw "Encoder options must be an object";
+  }
+
+  Local<Object> options = arg->ToObject();
+  Local<Value> extValue = options->Get(Nan::New<String>("ext").ToLocalChecked());
+  Local<Value> jpegQuality = options->Get(Nan::New<String>("jpegQuality").ToLocalChecked());
+  Local<Value> pngCompression = options->Get(Nan::New<String>("pngCompression").ToLocalChecked());
+
+  if (!extValue->IsUndefined()) {
+    ext = *Nan::Utf8String(extValue);
+  }
+  if (!jpegQuality->IsUndefined()) {
+    params.push_back(CV_IMWRITE_JPEG_QUALITY);
+    params.push_back(jpegQuality->Int32Value());
+  }
+  if (!pngCompression->IsUndefined()) {
+    params.push_back(CV_IMWRITE_PNG_COMPRESSION);
+    params.push_back(pngCompression->Int32Value());
+  }
+}
+
+std::vector<uchar> *Encoder::Encode(const cv::Mat &mat) {
+  std::unique_ptr<std::vector<uchar> > bytes(new std::vector<uchar>());
+  // A small image after a large one needs no more than its own pixels and
+  // some room for headers
+  size_t worstCase = mat.total() * mat.elemSize() + kHeaderBytes;
+  bytes->reserve(std::min(sizeHint.load(), worstCase));
+
+  if (!cv::imencode(ext, mat, *bytes, params)) {
+    CV_Error(CV_StsError, "Could not encode image as " + ext);
+  }
+
+  if (bytes->size() > sizeHint.load()) {
+    sizeHint.store(bytes->size());
+  }
+  // The Buffer keeps all of it alive, so don't hand over mostly slack
+  if (bytes->capacity() > bytes->size() * 2) {
+    bytes->shrink_to_fit();
+  }
+  return bytes.release();
+}
+
+static void FreeBytes(char *data, void *hint) {
+  delete static_cast<std::vector<uchar> *>(hint);
+}
+
+Local<Object> Encoder::NewBuffer(std::vector<uchar> *bytes) {
+  if (bytes->empty()) {
+    delete bytes;
+    return Nan::NewBuffer(0).ToLocalChecked();
+  }
+  return Nan::NewBuffer((char *) bytes->data(), bytes->size(), FreeBytes, bytes).ToLocalChecked();
+}
+
+// encoder.encode(matrix)
+NAN_METHOD(Encoder::EncodeSync) {
+  SETUP_FUNCTION(Encoder)
+
+  if (info.Length() < 1 || !Matrix::HasInstance(info[0])) {
+    return Nan::ThrowTypeError("Argument 1 must be a Matrix");
+  }
+
+  std::vector<uchar> *bytes;
+  try {
+    bytes = self->Encode(UNWRAP_ARG(Matrix, 0)->mat);
+  } catch (cv::Exception &e) {
+    return Nan::ThrowError(e.what());
+  }
+
+  info.GetReturnValue().Set(NewBuffer(bytes));
+}
+
+class EncodeWorker : public AsyncResultWorker {
+public:
+  EncodeWorker(Encoder *encoder, const cv::Mat &mat): encoder(encoder), mat(mat) {}
+
+  ~EncodeWorker() {
+    // Only set when the Buffer was never made
+    delete bytes;
+  }
+
+  void Execute() override {
+    try {
+      bytes = encoder->Encode(mat);
+    } catch (cv::Exception &e) {
+      SetErrorMessage(e.what());
+    }
+  }
+
+protected:
+  Local<Value> Result() override {
+    std::vector<uchar> *result = bytes;
+    bytes = NULL;
+    return Encoder::NewBuffer(result);
+  }
+
+private:
+  Encoder *encoder;
+  cv::Mat mat;
+  std::vector<uchar> *bytes = NULL;
+};
+
+void Encoder::Queue(Nan::NAN_METHOD_ARGS_TYPE info, int callbackIndex,
+    Local<Object> encoder, Local<Value> matrix) {
+  EncodeWorker *worker = NewAsyncResultWorker<EncodeWorker>(info, callbackIndex,
+      UNWRAP_OBJ(Encoder, encoder), UNWRAP_OBJ(Matrix, matrix->ToObject())->mat);
+  worker->SaveToPersistent("encoder", encoder);
+  worker->SaveToPersistent("source", matrix);
+
+  WorkerPool::Queue(worker);
+}
+
+// encoder.encodeAsync(matrix[, callback])
+NAN_METHOD(Encoder::EncodeAsync) {
+  SETUP_FUNCTION(Encoder)
+
+  if (info.Length() < 1 || !Matrix::HasInstance(info[0])) {
+    return Nan::ThrowTypeError("Argument 1 must be a Matrix");
+  }
+
+  int callbackIndex = -1;
+  if (info.Length() > 1 && info[1]->IsFunction()) {
+    callbackIndex = 1;
+  }
+
+  Queue(info, callbackIndex, info.This(), info[0]);
+}
@@ -0,0 +1,58 @@
+#ifndef __NODE_ENCODER_H
+#define __NODE_ENCODER_H
+
+#include "OpenCV.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+/**
+ * Image encoding options parsed once, for encoding many images the same way:
+ *
+ *   var thumbs = new cv.Encoder({ ext: '.jpg', jpegQuality: 80 });
+ *   var buf = thumbs.encode(small);
+ *   thumbs.encodeAsync(small).then(function(buf) { ... });
+ *
+ * The encoded bytes are handed to the returned Buffer as they are, without a
+ * copy. Matrix#toBuffer goes through the same code.
+ */
+class Encoder: public Nan::ObjectWrap {
+public:
+  static Nan::Persistent<FunctionTemplate> constructor;
+  static void Init(Local<Object> target);
+  static NAN_METHOD(New);
+
+  static bool HasInstance(Local<Value> object);
+
+  // Parses { ext, jpegQuality, pngCompression }; undefined gives the
+  // defaults, ".jpg" at OpenCV's default quality. Throws a const char* on
+  // bad input.
+  void Parse(Local<Value> options);
+
+  // Encodes `mat` into a new vector. Worker safe. Throws cv::Exception.
+  std::vector<uchar> *Encode(const cv::Mat &mat);
+
+  // Buffer over `bytes` that takes ownership of them.
+  static Local<Object> NewBuffer(std::vector<uchar> *bytes);
+
+  // Encodes `matrix` with the Encoder `encoder` on the WorkerPool, settling
+  // like NewAsyncResultWorker. Both are kept alive until it is done.
+  static void Queue(Nan::NAN_METHOD_ARGS_TYPE info, int callbackIndex,
+      Local<Object> encoder, Local<Value> matrix);
+
+  JSFUNC(EncodeSync)
+  JSFUNC(EncodeAsync)
+
+  Encoder(): sizeHint(0) {}
+
+private:
+  std::string ext;
+  std::vector<int> params;
+
+  // Largest image encoded so far, reserved up front, up to the size of the
+  // image being encoded, so the output doesn't get copied while it grows.
+  std::atomic<size_t> sizeHint;
+};
+
+#endif
@@ -1,8 +1,10 @@
 #include "OpenCV.h"
+#include "Stats.h"
 
 #ifdef HAVE_OPENCV_FACE
 #include "FaceRecognizer.h"
 #include "Matrix.h"
+#include "WorkerPool.h"
 #include <nan.h>
 
 #if CV_MAJOR_VERSION >= 3
@@ -43,19 +45,19 @@ void FaceRecognizerWrap::Init(Local<Object> target) {
   ctor->InstanceTemplate()->SetInternalFieldCount(1);
   ctor->SetClassName(Nan::New("FaceRecognizer").ToLocalChecked());
 
-  Nan::SetMethod(ctor, "createLBPHFaceRecognizer", CreateLBPH);
-  Nan::SetMethod(ctor, "createEigenFaceRecognizer", CreateEigen);
-  Nan::SetMethod(ctor, "createFisherFaceRecognizer", CreateFisher);
+  Stats::SetMethod(ctor, "createLBPHFaceRecognizer", CreateLBPH);
+  Stats::SetMethod(ctor, "createEigenFaceRecognizer", CreateEigen);
+  Stats::SetMethod(ctor, "createFisherFaceRecognizer", CreateFisher);
 
-  Nan::SetPrototypeMethod(ctor, "trainSync", TrainSync);
-  Nan::SetPrototypeMethod(ctor, "train", Train);
-  Nan::SetPrototypeMethod(ctor, "updateSync", UpdateSync);
-  Nan::SetPrototypeMethod(ctor, "predictSync", PredictSync);
-  Nan::SetPrototypeMethod(ctor, "predict", Predict);
-  Nan::SetPrototypeMethod(ctor, "saveSync", SaveSync);
-  Nan::SetPrototypeMethod(ctor, "loadSync", LoadSync);
+  Stats::SetPrototypeMethod(ctor, "trainSync", TrainSync);
+  Stats::SetPrototypeMethod(ctor, "train", Train);
+  Stats::SetPrototypeMethod(ctor, "updateSync", UpdateSync);
+  Stats::SetPrototypeMethod(ctor, "predictSync", PredictSync);
+  Stats::SetPrototypeMethod(ctor, "predict", Predict);
+  Stats::SetPrototypeMethod(ctor, "saveSync", SaveSync);
+  Stats::SetPrototypeMethod(ctor, "loadSync", LoadSync);
 
-  Nan::SetPrototypeMethod(ctor, "getMat", GetMat);
+  Stats::SetPrototypeMethod(ctor, "getMat", GetMat);
 
   target->Set(Nan::New("FaceRecognizer").ToLocalChecked(), ctor->GetFunction());
 };
@@ -238,7 +240,7 @@ NAN_METHOD(FaceRecognizerWrap::Train) {
   }
 
   Nan::Callback *callback = new Nan::Callback(cb.As<Function>());
-  Nan::AsyncQueueWorker(new TrainASyncWorker(callback, self->rec, images, labels));
+  WorkerPool::Queue(new TrainASyncWorker(callback, self->rec, images, labels));
 
   return;
 }
@@ -367,7 +369,7 @@ NAN_METHOD(FaceRecognizerWrap::Predict) {
   }
 
   Nan::Callback *callback = new Nan::Callback(cb.As<Function>());
-  Nan::AsyncQueueWorker(new PredictASyncWorker(callback, self->rec, im));
+  WorkerPool::Queue(new PredictASyncWorker(callback, self->rec, im));
 
   return;
 }
@@ -420,9 +422,7 @@ NAN_METHOD(FaceRecognizerWrap::GetMat) {
   m = self->rec->getMat(key);
 #endif
 
-  Local<Object> im = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(im);
-  img->mat = m;
+  Local<Object> im = Matrix::NewInstance(m);
 
   info.GetReturnValue().Set(im);
 }
@@ -1,15 +1,17 @@
 #include "OpenCV.h"
+#include "Stats.h"
 
 #if ((CV_MAJOR_VERSION == 2) && (CV_MINOR_VERSION >=4))
 #include "Features2d.h"
 #include "Matrix.h"
+#include "WorkerPool.h"
 #include <nan.h>
 #include <stdio.h>
 
 void Features::Init(Local<Object> target) {
   Nan::HandleScope scope;
 
-  Nan::SetMethod(target, "ImageSimilarity", Similarity);
+  Stats::SetMethod(target, "ImageSimilarity", Similarity);
 }
 
 class AsyncDetectSimilarity: public Nan::AsyncWorker {
@@ -107,7 +109,7 @@ NAN_METHOD(Features::Similarity) {
 
   Nan::Callback *callback = new Nan::Callback(cb.As<Function>());
 
-  Nan::AsyncQueueWorker( new AsyncDetectSimilarity(callback, image1, image2) );
+  WorkerPool::Queue( new AsyncDetectSimilarity(callback, image1, image2) );
   return;
 }
 
@@ -1,4 +1,5 @@
 #include "HighGUI.h"
+#include "Stats.h"
 #include "OpenCV.h"
 #include "Matrix.h"
 
@@ -14,9 +15,9 @@ void NamedWindow::Init(Local<Object> target) {
   ctor->SetClassName(Nan::New("NamedWindow").ToLocalChecked());
 
   // Prototype
-  Nan::SetPrototypeMethod(ctor, "show", Show);
-  Nan::SetPrototypeMethod(ctor, "destroy", Destroy);
-  Nan::SetPrototypeMethod(ctor, "blockingWaitKey", BlockingWaitKey);
+  Stats::SetPrototypeMethod(ctor, "show", Show);
+  Stats::SetPrototypeMethod(ctor, "destroy", Destroy);
+  Stats::SetPrototypeMethod(ctor, "blockingWaitKey", BlockingWaitKey);
 
   target->Set(Nan::New("NamedWindow").ToLocalChecked(), ctor->GetFunction());
 };
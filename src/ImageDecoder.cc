@@ -0,0 +1,191 @@
+#include "ImageDecoder.h"
+#include "Stats.h"
+#include "Matrix.h"
+#include "AsyncResultWorker.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+// Headers end well before this; past it the parse is given up on, so that
+// unknown formats aren't parsed again on every chunk.
+static const size_t kMaxProbeBytes = 256 << 10;
+
+Nan::Persistent<FunctionTemplate> ImageDecoder::constructor;
+
+void ImageDecoder::Init(Local<Object> target) {
+  Nan::HandleScope scope;
+
+  Local<FunctionTemplate> ctor = Nan::New<FunctionTemplate>(ImageDecoder::New);
+  constructor.Reset(ctor);
+  ctor->InstanceTemplate()->SetInternalFieldCount(1);
+  ctor->SetClassName(Nan::New("ImageDecoder").ToLocalChecked());
+
+  Stats::SetPrototypeMethod(ctor, "push", Push);
+  Stats::SetPrototypeMethod(ctor, "header", Header);
+  Stats::SetPrototypeMethod(ctor, "decode", Decode);
+
+  target->Set(Nan::New("ImageDecoder").ToLocalChecked(), ctor->GetFunction());
+}
+
+// new cv.ImageDecoder([{ mode, maxSize }])
+NAN_METHOD(ImageDecoder::New) {
+  Nan::HandleScope scope;
+
+  if (!info.IsConstructCall()) {
+    return Nan::ThrowTypeError("Cannot Instantiate without new");
+  }
+
+  OpenCV::ReadOptions options;
+  if (info.Length() > 0 && !info[0]->IsUndefined()) {
+    if (!info[0]->IsObject() || info[0]->IsFunction()) {
+      return Nan::ThrowTypeError("Options must be an object");
+    }
+    Local<Object> obj = info[0]->ToObject();
+    try {
+      OpenCV::ParseReadOptions(obj, options);
+    } catch (const char *msg) {
+      return Nan::ThrowTypeError(msg);
+    }
+  }
+
+  ImageDecoder *decoder = new ImageDecoder(options);
+  decoder->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+ImageDecoder::ImageDecoder(const OpenCV::ReadOptions &options):
+  options(options), length(0), probed(false), known(false), finished(false) {
+  chunks.Reset(Nan::New<Array>());
+}
+
+ImageDecoder::~ImageDecoder() {
+  chunks.Reset();
+}
+
+// decoder.push(chunk): appends the next bytes of the image. The chunk is
+// held on to until decode() is done with it.
+NAN_METHOD(ImageDecoder::Push) {
+  SETUP_FUNCTION(ImageDecoder)
+
+  if (info.Length() < 1 || !Buffer::HasInstance(info[0])) {
+    return Nan::ThrowTypeError("Argument 1 must be a Buffer");
+  }
+  if (self->finished) {
+    return Nan::ThrowError("push() after decode()");
+  }
+
+  Local<Object> buffer = info[0]->ToObject();
+  const uint8_t *chunk = (const uint8_t *) Buffer::Data(buffer);
+  size_t length = Buffer::Length(buffer);
+  if (length == 0) {
+    return;
+  }
+  Local<Array> chunks = Nan::New(self->chunks);
+  chunks->Set(chunks->Length(), buffer);
+  self->spans.push_back(Span(chunk, length));
+  self->length += length;
+
+  if (!self->probed) {
+    if (self->spans.size() == 1) {
+      self->known = self->header.Probe(chunk, length);
+    } else {
+      // Only the first few hundred KB are ever copied, and only this once
+      if (self->start.empty()) {
+        const Span &first = self->spans.front();
+        self->start.assign(first.first, first.first + std::min(first.second, kMaxProbeBytes));
+      }
+      size_t room = kMaxProbeBytes - std::min(self->start.size(), kMaxProbeBytes);
+      self->start.insert(self->start.end(), chunk, chunk + std::min(length, room));
+      self->known = self->header.Probe(self->start.data(), self->start.size());
+    }
+    self->probed = self->known || self->length >= kMaxProbeBytes;
+    if (self->probed) {
+      self->start = std::vector<uint8_t>();
+    }
+  }
+}
+
+// decoder.header(): what cv.probeImage() would say about the image, or null
+// while the header is incomplete or in an unknown format.
+NAN_METHOD(ImageDecoder::Header) {
+  SETUP_FUNCTION(ImageDecoder)
+
+  if (self->known) {
+    info.GetReturnValue().Set(self->header.ToObject());
+  } else {
+    info.GetReturnValue().Set(Nan::Null());
+  }
+}
+
+class ImageDecodeWorker : public AsyncResultWorker {
+public:
+  // The Buffers the spans point into are saved as "chunks".
+  ImageDecodeWorker(std::vector<ImageDecoder::Span> &&spans, size_t length,
+      const OpenCV::ReadOptions &options):
+    spans(std::move(spans)), length(length), options(options) {}
+
+  void Execute() override {
+    if (spans.empty()) {
+      return SetErrorMessage("No image data");
+    }
+
+    // One chunk is decoded where it is; more are concatenated, once
+    const uint8_t *data = spans[0].first;
+    std::vector<uint8_t> joined;
+    if (spans.size() > 1) {
+      joined.reserve(length);
+      for (size_t i = 0; i < spans.size(); i++) {
+        joined.insert(joined.end(), spans[i].first, spans[i].first + spans[i].second);
+      }
+      data = joined.data();
+    }
+
+    try {
+      mat = OpenCV::DecodeImage("", data, length, options, cached);
+    } catch (cv::Exception& e) {
+      return SetErrorMessage(e.what());
+    }
+
+    if (mat.empty()) {
+      SetErrorMessage("Could not open or find the image");
+    }
+  }
+
+protected:
+  Local<Value> Result() override {
+    return OpenCV::NewImage(mat, cached);
+  }
+
+private:
+  std::vector<ImageDecoder::Span> spans;
+  size_t length;
+  OpenCV::ReadOptions options;
+
+  cv::Mat mat;
+  bool cached = false;
+};
+
+// decoder.decode([callback]): decodes what was pushed. Can be called once.
+NAN_METHOD(ImageDecoder::Decode) {
+  SETUP_FUNCTION(ImageDecoder)
+
+  int callbackIndex = -1;
+  if (info.Length() > 0) {
+    if (!info[0]->IsFunction()) {
+      return Nan::ThrowTypeError("Argument 1 must be a Function");
+    }
+    callbackIndex = 0;
+  }
+  if (self->finished) {
+    return Nan::ThrowError("decode() was already called");
+  }
+  self->finished = true;
+
+  ImageDecodeWorker *worker = NewAsyncResultWorker<ImageDecodeWorker>(info, callbackIndex,
+      std::move(self->spans), self->length, self->options);
+  worker->SaveToPersistent("chunks", Nan::New(self->chunks));
+  self->chunks.Reset(Nan::New<Array>());
+  self->spans.clear();
+  self->length = 0;
+  WorkerPool::Queue(worker);
+}
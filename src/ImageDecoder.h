@@ -0,0 +1,62 @@
+#ifndef __NODE_IMAGEDECODER_H
+#define __NODE_IMAGEDECODER_H
+
+#include "OpenCV.h"
+#include "ImageHeader.h"
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/**
+ * Decodes an image that arrives in chunks, e.g. an upload, behind
+ * cv.ImageDataStream:
+ *
+ *   var decoder = new cv.ImageDecoder({ mode: 'color' });
+ *   decoder.push(chunk);   // as the chunks arrive
+ *   decoder.header();      // cv.probeImage() result once enough has arrived
+ *   decoder.decode().then(function(image) { ... });
+ *
+ * The chunks pushed are held on to, not copied, and must not be changed
+ * afterwards. OpenCV only decodes whole images, so decode() concatenates
+ * them once, on the WorkerPool, or decodes the only chunk where it is; it
+ * takes the options of cv.readImage and goes through the DecodeCache. The
+ * header is parsed as soon as it's complete, so oversized images can be
+ * turned down while they're still being sent.
+ */
+class ImageDecoder: public Nan::ObjectWrap {
+public:
+  static Nan::Persistent<FunctionTemplate> constructor;
+  static void Init(Local<Object> target);
+  static NAN_METHOD(New);
+
+  JSFUNC(Push)
+  JSFUNC(Header)
+  JSFUNC(Decode)
+
+  // The bytes of one chunk, kept alive by `chunks`.
+  typedef std::pair<const uint8_t *, size_t> Span;
+
+  ImageDecoder(const OpenCV::ReadOptions &options);
+  ~ImageDecoder();
+
+private:
+  OpenCV::ReadOptions options;
+
+  // The Buffers pushed, and their bytes in order.
+  Nan::Persistent<Array> chunks;
+  std::vector<Span> spans;
+  size_t length;
+
+  // The header parsed, or was given up on after the first few hundred KB.
+  bool probed;
+  bool known;
+  ImageHeader header;
+  // The start of the image, while the header spans more than one chunk.
+  std::vector<uint8_t> start;
+
+  // decode() was called; the chunks belong to its worker.
+  bool finished;
+};
+
+#endif
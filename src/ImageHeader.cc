@@ -0,0 +1,363 @@
+#include "ImageHeader.h"
+#include "Stats.h"
+#include "AsyncResultWorker.h"
+#include "WorkerPool.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Upper bounds on the walks, so that a corrupt file can't loop forever.
+static const int kMaxJpegSegments = 1024;
+static const int kMaxTiffPages = 65536;
+
+void ImageHeader::Init(Local<Object> target) {
+  Nan::HandleScope scope;
+
+  Stats::SetMethod(target, "probeImage", ProbeImage);
+}
+
+// Random access to the encoded bytes.
+class ByteSource {
+public:
+  virtual ~ByteSource() {}
+
+  // Copies `n` bytes at `offset` into `out`. False past the end.
+  virtual bool Read(size_t offset, uint8_t *out, size_t n) = 0;
+};
+
+class MemorySource : public ByteSource {
+public:
+  MemorySource(const uint8_t *data, size_t length): data(data), length(length) {}
+
+  bool Read(size_t offset, uint8_t *out, size_t n) override {
+    if (offset > length || n > length - offset) {
+      return false;
+    }
+    memcpy(out, data + offset, n);
+    return true;
+  }
+
+private:
+  const uint8_t *data;
+  size_t length;
+};
+
+class FileSource : public ByteSource {
+public:
+  explicit FileSource(FILE *file): file(file) {}
+
+  bool Read(size_t offset, uint8_t *out, size_t n) override {
+    return fseek(file, offset, SEEK_SET) == 0 && fread(out, 1, n, file) == n;
+  }
+
+private:
+  FILE *file;
+};
+
+static unsigned BE16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+static unsigned LE16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint32_t BE32(const uint8_t *p) { return ((uint32_t)BE16(p) << 16) | BE16(p + 2); }
+static uint32_t LE32(const uint8_t *p) { return LE16(p) | ((uint32_t)LE16(p + 2) << 16); }
+static uint32_t LE24(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16); }
+
+static bool ProbePng(ByteSource &src, ImageHeader &header) {
+  // Signature, then IHDR: length, type, width, height, bit depth, color type
+  uint8_t b[26];
+  if (!src.Read(0, b, sizeof(b)) || memcmp(b, "\x89PNG\r\n\x1a\n", 8) != 0 ||
+      memcmp(b + 12, "IHDR", 4) != 0) {
+    return false;
+  }
+
+  static const int kChannels[] = {1, 0, 3, 3, 2, 0, 4};
+  if (b[25] >= sizeof(kChannels) / sizeof(kChannels[0]) || kChannels[b[25]] == 0) {
+    return false;
+  }
+
+  header.format = "png";
+  header.width = BE32(b + 16);
+  header.height = BE32(b + 20);
+  header.channels = kChannels[b[25]];
+  header.depth = b[25] == 3 ? 8 : b[24];
+  return true;
+}
+
+static bool ProbeJpeg(ByteSource &src, ImageHeader &header) {
+  uint8_t b[10];
+  if (!src.Read(0, b, 2) || b[0] != 0xFF || b[1] != 0xD8) {
+    return false;
+  }
+
+  // Skip from segment to segment until the start of frame
+  size_t offset = 2;
+  for (int i = 0; i < kMaxJpegSegments; i++) {
+    if (!src.Read(offset, b, 4) || b[0] != 0xFF) {
+      return false;
+    }
+    uint8_t marker = b[1];
+    if (marker == 0xFF) {
+      // Fill byte
+      offset++;
+      continue;
+    }
+    if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+      // Markers without a length
+      offset += 2;
+      continue;
+    }
+    if (marker == 0xD9 || marker == 0xDA) {
+      // End of image or start of scan before any frame header
+      return false;
+    }
+
+    bool frame = marker >= 0xC0 && marker <= 0xCF &&
+        marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+    if (frame) {
+      // Length, precision, height, width, components
+      if (!src.Read(offset + 2, b, 8)) {
+        return false;
+      }
+      header.format = "jpeg";
+      header.depth = b[2];
+      header.height = BE16(b + 3);
+      header.width = BE16(b + 5);
+      header.channels = b[7];
+      return true;
+    }
+    offset += 2 + BE16(b + 2);
+  }
+  return false;
+}
+
+static bool ProbeBmp(ByteSource &src, ImageHeader &header) {
+  // File header, then the size of the info header that follows it
+  uint8_t b[30];
+  if (!src.Read(0, b, 18) || b[0] != 'B' || b[1] != 'M') {
+    return false;
+  }
+
+  int bits;
+  if (LE32(b + 14) == 12) {
+    // OS/2 BITMAPCOREHEADER: 16 bit sizes
+    if (!src.Read(0, b, 26)) {
+      return false;
+    }
+    header.width = LE16(b + 18);
+    header.height = LE16(b + 20);
+    bits = LE16(b + 24);
+  } else {
+    if (!src.Read(0, b, 30)) {
+      return false;
+    }
+    // A negative height means the rows are stored top down
+    int32_t height = (int32_t)LE32(b + 22);
+    header.width = (int32_t)LE32(b + 18);
+    header.height = height < 0 ? -height : height;
+    bits = LE16(b + 28);
+  }
+
+  header.format = "bmp";
+  header.channels = bits == 32 ? 4 : 3;
+  header.depth = 8;
+  return true;
+}
+
+static bool ProbeWebp(ByteSource &src, ImageHeader &header) {
+  // RIFF container, then the first chunk and its payload
+  uint8_t b[30];
+  if (!src.Read(0, b, sizeof(b)) || memcmp(b, "RIFF", 4) != 0 || memcmp(b + 8, "WEBP", 4) != 0) {
+    return false;
+  }
+
+  if (memcmp(b + 12, "VP8 ", 4) == 0) {
+    // Lossy: frame tag, start code, 14 bit sizes
+    if (b[23] != 0x9D || b[24] != 0x01 || b[25] != 0x2A) {
+      return false;
+    }
+    header.width = LE16(b + 26) & 0x3FFF;
+    header.height = LE16(b + 28) & 0x3FFF;
+    header.channels = 3;
+  } else if (memcmp(b + 12, "VP8L", 4) == 0) {
+    // Lossless: signature, then sizes minus one and the alpha hint in 32 bits
+    if (b[20] != 0x2F) {
+      return false;
+    }
+    uint32_t bits = LE32(b + 21);
+    header.width = (bits & 0x3FFF) + 1;
+    header.height = ((bits >> 14) & 0x3FFF) + 1;
+    header.channels = (bits >> 28) & 1 ? 4 : 3;
+  } else if (memcmp(b + 12, "VP8X", 4) == 0) {
+    // Extended: flags, then canvas sizes minus one in 24 bits
+    header.width = LE24(b + 24) + 1;
+    header.height = LE24(b + 27) + 1;
+    header.channels = b[20] & 0x10 ? 4 : 3;
+  } else {
+    return false;
+  }
+
+  header.format = "webp";
+  header.depth = 8;
+  return true;
+}
+
+static bool ProbeTiff(ByteSource &src, ImageHeader &header) {
+  uint8_t b[12];
+  if (!src.Read(0, b, 8)) {
+    return false;
+  }
+
+  bool little;
+  if (memcmp(b, "II*\0", 4) == 0) {
+    little = true;
+  } else if (memcmp(b, "MM\0*", 4) == 0) {
+    little = false;
+  } else {
+    return false;
+  }
+  unsigned (*u16)(const uint8_t *) = little ? LE16 : BE16;
+  uint32_t (*u32)(const uint8_t *) = little ? LE32 : BE32;
+
+  // The first directory describes the first page
+  uint32_t ifd = u32(b + 4);
+  if (!src.Read(ifd, b, 2)) {
+    return false;
+  }
+  unsigned entries = u16(b);
+
+  header.width = header.height = 0;
+  header.channels = 1;
+  header.depth = 1;
+  for (unsigned i = 0; i < entries; i++) {
+    // Tag, type, count, then the value itself when it fits in 4 bytes
+    if (!src.Read(ifd + 2 + i * 12, b, 12)) {
+      return false;
+    }
+    unsigned tag = u16(b);
+    unsigned type = u16(b + 2);
+    uint32_t count = u32(b + 4);
+    uint32_t value = type == 3 ? u16(b + 8) : u32(b + 8);
+
+    if (tag == 256) {
+      header.width = value;
+    } else if (tag == 257) {
+      header.height = value;
+    } else if (tag == 277) {
+      header.channels = value;
+    } else if (tag == 258) {
+      // One entry per channel; they're out of line past two shorts
+      if (type == 3 && count > 2) {
+        uint8_t first[2];
+        if (!src.Read(u32(b + 8), first, 2)) {
+          return false;
+        }
+        value = u16(first);
+      }
+      header.depth = value;
+    }
+  }
+  if (header.width <= 0 || header.height <= 0) {
+    return false;
+  }
+
+  // Count the pages by following the chain of directories
+  header.pages = 0;
+  while (ifd != 0 && header.pages < kMaxTiffPages) {
+    header.pages++;
+    if (!src.Read(ifd, b, 2) || !src.Read(ifd + 2 + u16(b) * 12, b, 4)) {
+      break;
+    }
+    uint32_t next = u32(b);
+    // Directories only point forward in well formed files
+    ifd = next > ifd ? next : 0;
+  }
+
+  header.format = "tiff";
+  return true;
+}
+
+static bool Probe(ByteSource &src, ImageHeader &header) {
+  header.pages = 1;
+  return ProbeJpeg(src, header) || ProbePng(src, header) || ProbeWebp(src, header) ||
+      ProbeBmp(src, header) || ProbeTiff(src, header);
+}
+
+bool ImageHeader::Probe(const uint8_t *data, size_t length) {
+  MemorySource src(data, length);
+  return ::Probe(src, *this);
+}
+
+bool ImageHeader::Probe(const std::string &path) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == NULL) {
+    return false;
+  }
+  FileSource src(file);
+  bool known = ::Probe(src, *this);
+  fclose(file);
+  return known;
+}
+
+Local<Object> ImageHeader::ToObject() const {
+  Nan::EscapableHandleScope scope;
+
+  Local<Object> obj = Nan::New<Object>();
+  obj->Set(Nan::New<String>("format").ToLocalChecked(), Nan::New<String>(format).ToLocalChecked());
+  obj->Set(Nan::New<String>("width").ToLocalChecked(), Nan::New<Number>(width));
+  obj->Set(Nan::New<String>("height").ToLocalChecked(), Nan::New<Number>(height));
+  obj->Set(Nan::New<String>("channels").ToLocalChecked(), Nan::New<Number>(channels));
+  obj->Set(Nan::New<String>("depth").ToLocalChecked(), Nan::New<Number>(depth));
+  obj->Set(Nan::New<String>("pages").ToLocalChecked(), Nan::New<Number>(pages));
+  return scope.Escape(obj);
+}
+
+class ProbeImageWorker : public AsyncResultWorker {
+public:
+  ProbeImageWorker(const std::string &path): path(path), data(nullptr), length(0) {}
+  ProbeImageWorker(const uint8_t *data, size_t length): data(data), length(length) {}
+
+  void Execute() override {
+    bool known = data == nullptr ? header.Probe(path) : header.Probe(data, length);
+    if (!known) {
+      SetErrorMessage("Could not read an image header");
+    }
+  }
+
+protected:
+  Local<Value> Result() override {
+    return header.ToObject();
+  }
+
+private:
+  const std::string path;
+  const uint8_t *data;
+  size_t length;
+
+  ImageHeader header;
+};
+
+// cv.probeImage(pathOrBuffer[, callback])
+NAN_METHOD(ImageHeader::ProbeImage) {
+  Nan::HandleScope scope;
+
+  int callbackIndex = -1;
+  if (info.Length() > 1) {
+    if (!info[1]->IsFunction()) {
+      return Nan::ThrowTypeError("Argument 2 must be a Function");
+    }
+    callbackIndex = 1;
+  }
+
+  ProbeImageWorker *worker;
+  if (info.Length() > 0 && info[0]->IsString()) {
+    std::string path = *Nan::Utf8String(info[0]);
+    worker = NewAsyncResultWorker<ProbeImageWorker>(info, callbackIndex, path);
+  } else if (info.Length() > 0 && Buffer::HasInstance(info[0])) {
+    const uint8_t *data = (const uint8_t *)Buffer::Data(info[0]->ToObject());
+    size_t length = Buffer::Length(info[0]->ToObject());
+    worker = NewAsyncResultWorker<ProbeImageWorker>(info, callbackIndex, data, length);
+    worker->SaveToPersistent("buffer", info[0]);
+  } else {
+    return Nan::ThrowTypeError("Argument 1 must be a string or a Buffer");
+  }
+
+  WorkerPool::Queue(worker);
+}
@@ -0,0 +1,45 @@
+#ifndef __NODE_IMAGEHEADER_H
+#define __NODE_IMAGEHEADER_H
+
+#include "OpenCV.h"
+
+#include <string>
+
+/**
+ * Reads the size and layout of an encoded image from its header, without
+ * decoding any pixels:
+ *
+ *   cv.probeImage('photo.jpg').then(function(header) {
+ *     // { format: 'jpeg', width: 6000, height: 4000, channels: 3, depth: 8, pages: 1 }
+ *   });
+ *
+ * Knows JPEG, PNG, BMP, TIFF and WebP. Files are read a few bytes at a time,
+ * only as far as the header goes. Width and height are as stored, before
+ * any EXIF rotation readImage applies.
+ */
+class ImageHeader {
+public:
+  const char *format;
+  int width;
+  int height;
+  // As stored in the file: palette images count as color.
+  int channels;
+  // Bits per channel.
+  int depth;
+  // Images in the file; only TIFFs have more than one.
+  int pages;
+
+  ImageHeader(): format(NULL), width(0), height(0), channels(0), depth(0), pages(0) {}
+
+  static void Init(Local<Object> target);
+
+  // Worker safe. False when the data is not a known format or is truncated.
+  bool Probe(const uint8_t *data, size_t length);
+  bool Probe(const std::string &path);
+
+  Local<Object> ToObject() const;
+
+  static NAN_METHOD(ProbeImage);
+};
+
+#endif
@@ -0,0 +1,222 @@
+#include "ImagePages.h"
+#include "Stats.h"
+#include "Matrix.h"
+#include "ImageHeader.h"
+#include "AsyncResultWorker.h"
+#include "WorkerPool.h"
+
+#if CV_MAJOR_VERSION > 4 || (CV_MAJOR_VERSION == 4 && (CV_MINOR_VERSION > 5 || \
+    (CV_MINOR_VERSION == 5 && CV_SUBMINOR_VERSION >= 2)))
+#define HAVE_IMREADMULTI_RANGE
+#endif
+
+static const size_t kDefaultPrefetch = 2;
+
+Nan::Persistent<FunctionTemplate> ImagePages::constructor;
+
+void ImagePages::Init(Local<Object> target) {
+  Nan::HandleScope scope;
+
+  Local<FunctionTemplate> ctor = Nan::New<FunctionTemplate>(ImagePages::New);
+  constructor.Reset(ctor);
+  ctor->InstanceTemplate()->SetInternalFieldCount(1);
+  ctor->SetClassName(Nan::New("ImagePages").ToLocalChecked());
+
+  Stats::SetPrototypeMethod(ctor, "next", Next);
+  Stats::SetPrototypeMethod(ctor, "close", Close);
+
+  target->Set(Nan::New("ImagePages").ToLocalChecked(), ctor->GetFunction());
+}
+
+// new cv.ImagePages(path[, { mode, prefetch }])
+NAN_METHOD(ImagePages::New) {
+  Nan::HandleScope scope;
+
+  if (!info.IsConstructCall()) {
+    return Nan::ThrowTypeError("Cannot Instantiate without new");
+  }
+  if (info.Length() < 1 || !info[0]->IsString()) {
+    return Nan::ThrowTypeError("Argument 1 must be a path");
+  }
+
+  int mode = cv::IMREAD_COLOR;
+  size_t prefetch = kDefaultPrefetch;
+  if (info.Length() > 1 && !info[1]->IsUndefined()) {
+    if (!info[1]->IsObject() || info[1]->IsFunction()) {
+      return Nan::ThrowTypeError("Options must be an object");
+    }
+    Local<Object> options = info[1]->ToObject();
+    Local<Value> modeValue = options->Get(Nan::New<String>("mode").ToLocalChecked());
+    Local<Value> prefetchValue = options->Get(Nan::New<String>("prefetch").ToLocalChecked());
+
+    try {
+      if (!modeValue->IsUndefined()) {
+        mode = OpenCV::ImreadMode(modeValue);
+      }
+    } catch (const char *msg) {
+      return Nan::ThrowTypeError(msg);
+    }
+    if (!prefetchValue->IsUndefined()) {
+      if (!prefetchValue->IsNumber() || prefetchValue->Int32Value() < 1) {
+        return Nan::ThrowTypeError("prefetch must be a number >= 1");
+      }
+      prefetch = prefetchValue->Int32Value();
+    }
+  }
+
+  ImagePages *pages = new ImagePages(*Nan::Utf8String(info[0]), mode, prefetch);
+  pages->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+ImagePages::ImagePages(const std::string &path, int mode, size_t prefetch):
+  path(path), mode(mode), prefetch(prefetch), lane(WorkerPool::CurrentLane()),
+  pageCount(-1), nextPage(0), decoding(false), closed(false) {}
+
+ImagePages::~ImagePages() {
+  // Never queued, so still ours
+  for (size_t i = 0; i < waiting.size(); i++) {
+    delete waiting[i];
+  }
+}
+
+// Settles one next() call with { done, value }, or its error.
+class PageResultWorker : public AsyncResultWorker {
+public:
+  PageResultWorker(): done(false) {}
+
+  void Execute() override {
+    if (!error.empty()) {
+      SetErrorMessage(error.c_str());
+    }
+  }
+
+  cv::Mat page;
+  bool done;
+  std::string error;
+
+protected:
+  Local<Value> Result() override {
+    Local<Object> result = Nan::New<Object>();
+    result->Set(Nan::New("done").ToLocalChecked(), Nan::New<Boolean>(done));
+    result->Set(Nan::New("value").ToLocalChecked(),
+        done ? Local<Value>(Nan::Undefined()) : Local<Value>(Matrix::NewInstance(page)));
+    return result;
+  }
+};
+
+// Decodes the next page, counting the pages first if nobody did yet.
+class PageWorker : public Nan::AsyncWorker {
+public:
+  PageWorker(ImagePages *pages):
+    Nan::AsyncWorker(nullptr), pages(pages), path(pages->path), mode(pages->mode),
+    page(pages->nextPage), pageCount(pages->pageCount) {}
+
+  void Execute() override {
+    try {
+      if (pageCount < 0) {
+        // Formats the header parser doesn't know are left to OpenCV
+        ImageHeader header;
+        pageCount = header.Probe(path) ? header.pages : 1;
+#if CV_MAJOR_VERSION < 3
+        // No imreadmulti: only the first page can be read
+        pageCount = 1;
+#endif
+      }
+
+      if (pageCount == 1) {
+        mats.push_back(cv::imread(path, mode));
+      } else {
+#if defined(HAVE_IMREADMULTI_RANGE)
+        cv::imreadmulti(path, mats, page, 1, mode);
+#elif CV_MAJOR_VERSION >= 3
+        cv::imreadmulti(path, mats, mode);
+        pageCount = mats.size();
+#endif
+      }
+    } catch (cv::Exception &e) {
+      return SetErrorMessage(e.what());
+    }
+
+    if (mats.empty() || mats[0].empty()) {
+      SetErrorMessage("Could not open or find the image");
+    }
+  }
+
+protected:
+  void HandleOKCallback() override {
+    pages->decoding = false;
+    pages->pageCount = pageCount;
+    pages->nextPage += mats.size();
+    if (!pages->closed) {
+      pages->ready.insert(pages->ready.end(), mats.begin(), mats.end());
+    }
+    pages->Pump();
+  }
+
+  void HandleErrorCallback() override {
+    pages->decoding = false;
+    pages->error = ErrorMessage();
+    pages->Pump();
+  }
+
+private:
+  ImagePages *pages;
+  std::string path;
+  int mode;
+  int page;
+  int pageCount;
+  std::vector<cv::Mat> mats;
+};
+
+void ImagePages::Pump() {
+  bool finished = closed || !error.empty() || (pageCount >= 0 && nextPage >= pageCount);
+
+  while (!waiting.empty() && (!ready.empty() || (finished && !decoding))) {
+    PageResultWorker *worker = waiting.front();
+    waiting.pop_front();
+
+    if (!ready.empty()) {
+      worker->page = ready.front();
+      ready.pop_front();
+    } else if (!error.empty() && !closed) {
+      worker->error = error;
+    } else {
+      worker->done = true;
+    }
+    WorkerPool::Queue(worker, lane);
+  }
+
+  if (!finished && !decoding && ready.size() < prefetch) {
+    decoding = true;
+    PageWorker *worker = new PageWorker(this);
+    worker->SaveToPersistent("pages", handle());
+    WorkerPool::Queue(worker, lane);
+  }
+}
+
+// pages.next([callback]): { done, value } with the next page as value.
+NAN_METHOD(ImagePages::Next) {
+  SETUP_FUNCTION(ImagePages)
+
+  int callbackIndex = -1;
+  if (info.Length() > 0 && info[0]->IsFunction()) {
+    callbackIndex = 0;
+  }
+
+  PageResultWorker *worker = NewAsyncResultWorker<PageResultWorker>(info, callbackIndex);
+  // Keeps the pages alive while next() calls are waiting
+  worker->SaveToPersistent("pages", info.This());
+  self->waiting.push_back(worker);
+  self->Pump();
+}
+
+// pages.close(): drops the decoded pages. Waiting and later next() calls
+// get { done: true }.
+NAN_METHOD(ImagePages::Close) {
+  SETUP_FUNCTION(ImagePages)
+
+  self->closed = true;
+  self->ready.clear();
+  self->Pump();
+}
@@ -0,0 +1,63 @@
+#ifndef __NODE_IMAGEPAGES_H
+#define __NODE_IMAGEPAGES_H
+
+#include "OpenCV.h"
+#include "WorkerPool.h"
+
+#include <deque>
+#include <string>
+
+class PageResultWorker;
+
+/**
+ * Reads the pages of a multi-page image, e.g. a TIFF, one at a time on the
+ * WorkerPool:
+ *
+ *   var pages = cv.readImagePages('scan.tif', { mode: 'grayscale', prefetch: 2 });
+ *   for await (const page of pages) { ... }
+ *   // or pages.next().then(function(result) { result.done, result.value })
+ *
+ * At most `prefetch` decoded pages wait to be picked up, and one page is
+ * decoded at a time, so memory stays at a few pages whatever the length of
+ * the file. Paging needs OpenCV 4.5.2's imreadmulti(start, count); with
+ * older versions the first next() decodes every page at once, and OpenCV 2
+ * only reads the first page.
+ */
+class ImagePages: public Nan::ObjectWrap {
+public:
+  static Nan::Persistent<FunctionTemplate> constructor;
+  static void Init(Local<Object> target);
+  static NAN_METHOD(New);
+
+  JSFUNC(Next)
+  JSFUNC(Close)
+
+  ImagePages(const std::string &path, int mode, size_t prefetch);
+  ~ImagePages();
+
+private:
+  friend class PageWorker;
+
+  // Main thread. Hands decoded pages to waiting next() calls and starts the
+  // next decode when there is room for it.
+  void Pump();
+
+  std::string path;
+  int mode;
+  size_t prefetch;
+  // Where the pages are decoded: the lane they were asked for in.
+  WorkerPool::Lane lane;
+
+  // Main thread only. pageCount is -1 until the first decode counted them.
+  int pageCount;
+  int nextPage;
+  bool decoding;
+  bool closed;
+  std::string error;
+
+  std::deque<cv::Mat> ready;
+  // next() calls waiting for a page, queued to settle once they have one.
+  std::deque<PageResultWorker *> waiting;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "ImgProc.h"
+#include "Stats.h"
 #include "Matrix.h"
 
 void ImgProc::Init(Local<Object> target) {
@@ -6,11 +7,11 @@ void ImgProc::Init(Local<Object> target) {
   Local<Object> obj = Nan::New<Object>();
   inner.Reset(obj);
 
-  Nan::SetMethod(obj, "undistort", Undistort);
-  Nan::SetMethod(obj, "initUndistortRectifyMap", InitUndistortRectifyMap);
-  Nan::SetMethod(obj, "remap", Remap);
-  Nan::SetMethod(obj, "distanceTransform", DistanceTransform);
-  Nan::SetMethod(obj, "getStructuringElement", GetStructuringElement);
+  Stats::SetMethod(obj, "undistort", Undistort);
+  Stats::SetMethod(obj, "initUndistortRectifyMap", InitUndistortRectifyMap);
+  Stats::SetMethod(obj, "remap", Remap);
+  Stats::SetMethod(obj, "distanceTransform", DistanceTransform);
+  Stats::SetMethod(obj, "getStructuringElement", GetStructuringElement);
 
   target->Set(Nan::New("imgproc").ToLocalChecked(), obj);
 }
@@ -34,9 +35,7 @@ NAN_METHOD(ImgProc::DistanceTransform) {
     cv::distanceTransform(inputImage, outputImage, distType, 0);
 
     // Wrap the output image
-    Local<Object> outMatrixWrap = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-    Matrix *outMatrix = Nan::ObjectWrap::Unwrap<Matrix>(outMatrixWrap);
-    outMatrix->mat = outputImage;
+    Local<Object> outMatrixWrap = Matrix::NewInstance(outputImage);
 
     // Return the output image
     info.GetReturnValue().Set(outMatrixWrap);
@@ -73,9 +72,7 @@ NAN_METHOD(ImgProc::Undistort) {
     cv::undistort(inputImage, outputImage, K, dist);
 
     // Wrap the output image
-    Local<Object> outMatrixWrap = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-    Matrix *outMatrix = Nan::ObjectWrap::Unwrap<Matrix>(outMatrixWrap);
-    outMatrix->mat = outputImage;
+    Local<Object> outMatrixWrap = Matrix::NewInstance(outputImage);
 
     // Return the output image
     info.GetReturnValue().Set(outMatrixWrap);
@@ -126,13 +123,8 @@ NAN_METHOD(ImgProc::InitUndistortRectifyMap) {
     cv::initUndistortRectifyMap(K, dist, R, newK, imageSize, m1type, map1, map2);
 
     // Wrap the output maps
-    Local<Object> map1Wrap = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-    Matrix *map1Matrix = Nan::ObjectWrap::Unwrap<Matrix>(map1Wrap);
-    map1Matrix->mat = map1;
-
-    Local<Object> map2Wrap = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-    Matrix *map2Matrix = Nan::ObjectWrap::Unwrap<Matrix>(map2Wrap);
-    map2Matrix->mat = map2;
+    Local<Object> map1Wrap = Matrix::NewInstance(map1);
+    Local<Object> map2Wrap = Matrix::NewInstance(map2);
 
     // Make a return object with the two maps
     Local<Object> ret = Nan::New<Object>();
@@ -179,9 +171,7 @@ NAN_METHOD(ImgProc::Remap) {
     cv::remap(inputImage, outputImage, map1, map2, interpolation);
 
     // Wrap the output image
-    Local<Object> outMatrixWrap = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-    Matrix *outMatrix = Nan::ObjectWrap::Unwrap<Matrix>(outMatrixWrap);
-    outMatrix->mat = outputImage;
+    Local<Object> outMatrixWrap = Matrix::NewInstance(outputImage);
 
     // Return the image
     info.GetReturnValue().Set(outMatrixWrap);
@@ -221,9 +211,7 @@ NAN_METHOD(ImgProc::GetStructuringElement) {
     cv::Mat mat = cv::getStructuringElement(shape, ksize);
 
     // Wrap the output image
-    Local<Object> outMatrixWrap = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-    Matrix *outMatrix = ObjectWrap::Unwrap<Matrix>(outMatrixWrap);
-    outMatrix->mat = mat;
+    Local<Object> outMatrixWrap = Matrix::NewInstance(mat);
 
     // Return the image
     info.GetReturnValue().Set(outMatrixWrap);
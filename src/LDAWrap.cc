@@ -1,4 +1,5 @@
 #include "OpenCV.h"
+#include "Stats.h"
 
 #if CV_MAJOR_VERSION >= 3
 #ifdef __GNUC__
@@ -24,8 +25,8 @@ void LDAWrap::Init(Local<Object> target) {
   ctor->InstanceTemplate()->SetInternalFieldCount(1);
   ctor->SetClassName(Nan::New("LDA").ToLocalChecked());
 
-  Nan::SetMethod(ctor, "subspaceProject", SubspaceProject);
-  Nan::SetMethod(ctor, "subspaceReconstruct", SubspaceReconstruct);
+  Stats::SetMethod(ctor, "subspaceProject", SubspaceProject);
+  Stats::SetMethod(ctor, "subspaceReconstruct", SubspaceReconstruct);
 
   target->Set(Nan::New("LDA").ToLocalChecked(), ctor->GetFunction());
 };
@@ -65,9 +66,7 @@ NAN_METHOD(LDAWrap::SubspaceProject) {
 
   cv::Mat m = cv::subspaceProject(w->mat, mean->mat, src->mat);
 
-  Local<Object> im = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(im);
-  img->mat = m;
+  Local<Object> im = Matrix::NewInstance(m);
 
   info.GetReturnValue().Set(im);
 }
@@ -91,9 +90,7 @@ NAN_METHOD(LDAWrap::SubspaceReconstruct) {
 
   cv::Mat m = cv::subspaceReconstruct(w->mat, mean->mat, src->mat);
 
-  Local<Object> im = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(im);
-  img->mat = m;
+  Local<Object> im = Matrix::NewInstance(m);
 
   info.GetReturnValue().Set(im);
 }
@@ -0,0 +1,97 @@
+#ifndef __NODE_MATACCESS_H
+#define __NODE_MATACCESS_H
+
+#include "OpenCV.h"
+
+/**
+ * Element access for any cv::Mat type. The element type and channel count are
+ * template parameters, so the per-element code has no type switch; the switch
+ * happens once, when MatAccessor::For picks the instantiation for a matrix.
+ *
+ *   MatAccessor access = MatAccessor::For(mat.type());
+ *   double bgr[4];
+ *   access.get(mat, y, x, bgr);
+ *
+ * Values go through double, which holds every element type exactly. Writes
+ * saturate to the element type like cv::saturate_cast.
+ */
+template <typename T, int CN>
+struct MatElement {
+  // CN is 0 for channel counts above 4, which are read from the matrix.
+  static int Channels(const cv::Mat &mat) {
+    return CN > 0 ? CN : mat.channels();
+  }
+
+  static void Get(const cv::Mat &mat, int i, int j, double *values) {
+    const int cn = Channels(mat);
+    const T *p = mat.ptr<T>(i) + j * cn;
+    for (int c = 0; c < cn; c++) {
+      values[c] = p[c];
+    }
+  }
+
+  static void Set(cv::Mat &mat, int i, int j, int channel, double value) {
+    mat.ptr<T>(i)[j * Channels(mat) + channel] = cv::saturate_cast<T>(value);
+  }
+
+  // Elements [from, to) of row i, channels interleaved.
+  static void GetRow(const cv::Mat &mat, int i, int from, int to, double *values) {
+    const int cn = Channels(mat);
+    const T *p = mat.ptr<T>(i);
+    for (int k = from * cn; k < to * cn; k++) {
+      *values++ = p[k];
+    }
+  }
+};
+
+struct MatAccessor {
+  void (*get)(const cv::Mat &mat, int i, int j, double *values);
+  void (*set)(cv::Mat &mat, int i, int j, int channel, double value);
+  void (*getRow)(const cv::Mat &mat, int i, int from, int to, double *values);
+
+  static MatAccessor For(int type) {
+    switch (CV_MAT_DEPTH(type)) {
+      case CV_8S:
+        return ForChannels<schar>(CV_MAT_CN(type));
+      case CV_16U:
+        return ForChannels<ushort>(CV_MAT_CN(type));
+      case CV_16S:
+        return ForChannels<short>(CV_MAT_CN(type));
+      case CV_32S:
+        return ForChannels<int>(CV_MAT_CN(type));
+      case CV_32F:
+        return ForChannels<float>(CV_MAT_CN(type));
+      case CV_64F:
+        return ForChannels<double>(CV_MAT_CN(type));
+      default:
+        return ForChannels<uchar>(CV_MAT_CN(type));
+    }
+  }
+
+private:
+  template <typename T, int CN>
+  static MatAccessor Make() {
+    MatAccessor access = {
+      MatElement<T, CN>::Get, MatElement<T, CN>::Set, MatElement<T, CN>::GetRow
+    };
+    return access;
+  }
+
+  template <typename T>
+  static MatAccessor ForChannels(int cn) {
+    switch (cn) {
+      case 1:
+        return Make<T, 1>();
+      case 2:
+        return Make<T, 2>();
+      case 3:
+        return Make<T, 3>();
+      case 4:
+        return Make<T, 4>();
+      default:
+        return Make<T, 0>();
+    }
+  }
+};
+
+#endif
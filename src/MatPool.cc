@@ -0,0 +1,321 @@
+#include "MatPool.h"
+#include "Stats.h"
+
+#if CV_MAJOR_VERSION >= 3
+#include <stdlib.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+#endif
+
+void MatPool::Init(Local<Object> target) {
+  Nan::HandleScope scope;
+
+  Stats::SetMethod(target, "setMatPool", SetMatPool);
+  Stats::SetMethod(target, "matPoolStats", MatPoolStats);
+
+#if CV_MAJOR_VERSION >= 3
+  cv::Mat::setDefaultAllocator(Allocator());
+#endif
+}
+
+#if CV_MAJOR_VERSION >= 3
+
+// Smaller buffers are cheap to malloc and not worth holding on to.
+static const size_t kMinPooledSize = 64 * 1024;
+static const size_t kHugePageSize = 2 * 1024 * 1024;
+
+// Stored in UMatData::userdata to remember how the pixels were allocated.
+// Buffers without a tag were sized exactly and are never recycled.
+static char kPooledTag, kHugePageTag;
+
+// Four classes per power of two, so a recycled buffer wastes at most a quarter
+// of its size.
+static size_t SizeClass(size_t size) {
+  size_t base = kMinPooledSize;
+  while (base * 2 <= size) {
+    base *= 2;
+  }
+  size_t quarter = base / 4;
+  return (size + quarter - 1) / quarter * quarter;
+}
+
+// Huge page buffers are rounded up to whole pages.
+static size_t HugeSize(size_t size) {
+  return (size + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+}
+
+struct Block {
+  uchar *data;
+  // The size class, which the buffer is handed out for.
+  size_t size;
+  bool huge;
+  // What was really allocated, which retainedBytes and maxBytes count.
+  size_t bytes;
+
+  Block() {}
+  Block(uchar *data, size_t size, bool huge):
+    data(data), size(size), huge(huge), bytes(huge ? HugeSize(size) : size) {}
+};
+
+static void FreeBlock(const Block &block) {
+  if (block.huge) {
+    free(block.data);
+  } else {
+    cv::fastFree(block.data);
+  }
+}
+
+static bool AllocateHuge(Block &block) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  void *data = NULL;
+  size_t size = HugeSize(block.size);
+  if (posix_memalign(&data, kHugePageSize, size) != 0) {
+    return false;
+  }
+  madvise(data, size, MADV_HUGEPAGE);
+  block = Block((uchar *) data, block.size, true);
+  return true;
+#else
+  return false;
+#endif
+}
+
+class Pool {
+public:
+  Pool(): enabled(false), hugePages(false), maxBytes(256 << 20),
+    retainedBytes(0), hits(0), misses(0) {}
+
+  // Finds a retained buffer for `size` bytes or allocates a new one of the
+  // matching class. Returns false when the size is not pooled.
+  bool Acquire(size_t size, Block &block) {
+    if (!enabled || size < kMinPooledSize) {
+      return false;
+    }
+
+    block.size = SizeClass(size);
+    bool huge;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::vector<Block> &list = lists[block.size];
+      if (!list.empty()) {
+        block = list.back();
+        list.pop_back();
+        retainedBytes -= block.bytes;
+        hits++;
+        return true;
+      }
+      misses++;
+      huge = hugePages;
+    }
+
+    if (!(huge && block.size >= kHugePageSize && AllocateHuge(block))) {
+      block = Block((uchar *) cv::fastMalloc(block.size), block.size, false);
+    }
+    return true;
+  }
+
+  // Takes the buffer back unless the pool is off or over its cap.
+  bool Release(const Block &block) {
+    if (!enabled) {
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (retainedBytes + block.bytes > maxBytes) {
+      return false;
+    }
+    lists[block.size].push_back(block);
+    retainedBytes += block.bytes;
+    return true;
+  }
+
+  void Configure(bool enabled, bool hugePages, size_t maxBytes) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      this->enabled = enabled;
+      this->hugePages = hugePages;
+      this->maxBytes = maxBytes;
+    }
+    if (!enabled) {
+      Trim(0);
+    } else {
+      Trim(maxBytes);
+    }
+  }
+
+  // Frees retained buffers until at most `limit` bytes are left.
+  void Trim(size_t limit) {
+    std::vector<Block> dropped;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::map<size_t, std::vector<Block> >::reverse_iterator it;
+      for (it = lists.rbegin(); it != lists.rend() && retainedBytes > limit; ++it) {
+        while (!it->second.empty() && retainedBytes > limit) {
+          dropped.push_back(it->second.back());
+          it->second.pop_back();
+          retainedBytes -= dropped.back().bytes;
+        }
+      }
+    }
+    for (size_t i = 0; i < dropped.size(); i++) {
+      FreeBlock(dropped[i]);
+    }
+  }
+
+  std::atomic<bool> enabled;
+  // The fields from here to misses are guarded by the mutex.
+  bool hugePages;
+  size_t maxBytes;
+  size_t retainedBytes;
+  uint64_t hits;
+  uint64_t misses;
+  std::mutex mutex;
+
+private:
+  std::map<size_t, std::vector<Block> > lists;
+};
+
+// Outlives static destructors, matrices may still be released after them.
+static Pool &pool = *new Pool();
+
+// Same contract as OpenCV's StdMatAllocator, with the pixel buffer coming
+// from the pool when it is enabled.
+class PoolAllocator: public cv::MatAllocator {
+public:
+  cv::UMatData* allocate(int dims, const int* sizes, int type, void* data0,
+      size_t* step, int flags, cv::UMatUsageFlags usageFlags) const {
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+      if (step) {
+        if (data0 && step[i] != CV_AUTOSTEP) {
+          CV_Assert(total <= step[i]);
+          total = step[i];
+        } else {
+          step[i] = total;
+        }
+      }
+      total *= sizes[i];
+    }
+
+    cv::UMatData* u = new cv::UMatData(this);
+    u->size = total;
+
+    Block block;
+    if (data0) {
+      u->data = u->origdata = (uchar *) data0;
+      u->flags |= cv::UMatData::USER_ALLOCATED;
+    } else if (pool.Acquire(total, block)) {
+      u->data = u->origdata = block.data;
+      u->userdata = block.huge ? &kHugePageTag : &kPooledTag;
+    } else {
+      u->data = u->origdata = (uchar *) cv::fastMalloc(total);
+    }
+    return u;
+  }
+
+  bool allocate(cv::UMatData* u, int accessFlags, cv::UMatUsageFlags usageFlags) const {
+    return u != NULL;
+  }
+
+  void deallocate(cv::UMatData* u) const {
+    if (!u) {
+      return;
+    }
+
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+      if (u->userdata == NULL) {
+        cv::fastFree(u->origdata);
+      } else {
+        Block block(u->origdata, SizeClass(u->size), u->userdata == &kHugePageTag);
+        if (!pool.Release(block)) {
+          FreeBlock(block);
+        }
+      }
+      u->origdata = 0;
+    }
+    delete u;
+  }
+};
+
+cv::MatAllocator* MatPool::Allocator() {
+  // Never destroyed either: matrices remember the allocator that created them.
+  static PoolAllocator *allocator = new PoolAllocator();
+  return allocator;
+}
+
+// cv.setMatPool({ enabled: true, maxBytes: 256 << 20, hugePages: false })
+NAN_METHOD(MatPool::SetMatPool) {
+  Nan::HandleScope scope;
+
+  if (info.Length() < 1 || !info[0]->IsObject()) {
+    return Nan::ThrowTypeError("Argument 1 must be an object");
+  }
+
+  Local<Object> options = info[0]->ToObject();
+  bool enabled, hugePages;
+  size_t maxBytes;
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    enabled = pool.enabled;
+    hugePages = pool.hugePages;
+    maxBytes = pool.maxBytes;
+  }
+
+  if (options->Has(Nan::New<String>("enabled").ToLocalChecked())) {
+    enabled = options->Get(Nan::New<String>("enabled").ToLocalChecked())->BooleanValue();
+  }
+  if (options->Has(Nan::New<String>("hugePages").ToLocalChecked())) {
+    hugePages = options->Get(Nan::New<String>("hugePages").ToLocalChecked())->BooleanValue();
+  }
+  if (options->Has(Nan::New<String>("maxBytes").ToLocalChecked())) {
+    double value = options->Get(Nan::New<String>("maxBytes").ToLocalChecked())->NumberValue();
+    if (!(value >= 0)) {
+      return Nan::ThrowRangeError("maxBytes must be >= 0");
+    }
+    maxBytes = (size_t) value;
+  }
+
+  pool.Configure(enabled, hugePages, maxBytes);
+}
+
+NAN_METHOD(MatPool::MatPoolStats) {
+  Nan::HandleScope scope;
+
+  Local<Object> stats = Nan::New<Object>();
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    stats->Set(Nan::New<String>("enabled").ToLocalChecked(), Nan::New<Boolean>(pool.enabled.load()));
+    stats->Set(Nan::New<String>("hugePages").ToLocalChecked(), Nan::New<Boolean>(pool.hugePages));
+    stats->Set(Nan::New<String>("maxBytes").ToLocalChecked(), Nan::New<Number>(pool.maxBytes));
+    stats->Set(Nan::New<String>("retainedBytes").ToLocalChecked(), Nan::New<Number>(pool.retainedBytes));
+    stats->Set(Nan::New<String>("hits").ToLocalChecked(), Nan::New<Number>(pool.hits));
+    stats->Set(Nan::New<String>("misses").ToLocalChecked(), Nan::New<Number>(pool.misses));
+  }
+
+  info.GetReturnValue().Set(stats);
+}
+
+#else
+
+// OpenCV 2.x has no way to replace the default allocator.
+
+NAN_METHOD(MatPool::SetMatPool) {
+  Nan::ThrowError("setMatPool requires OpenCV 3");
+}
+
+NAN_METHOD(MatPool::MatPoolStats) {
+  Nan::HandleScope scope;
+
+  Local<Object> stats = Nan::New<Object>();
+  stats->Set(Nan::New<String>("enabled").ToLocalChecked(), Nan::New<Boolean>(false));
+  info.GetReturnValue().Set(stats);
+}
+
+#endif
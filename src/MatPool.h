@@ -0,0 +1,32 @@
+#ifndef __NODE_MATPOOL_H
+#define __NODE_MATPOOL_H
+
+#include "OpenCV.h"
+
+/**
+ * Opt-in recycling of cv::Mat pixel buffers.
+ *
+ * A video loop allocates and frees the same few frame-sized buffers over and
+ * over. When the pool is enabled, released buffers are kept in per size class
+ * free lists and handed back to the next cv::Mat of that class instead of going
+ * through malloc/free and first-touch page faults again.
+ *
+ * The allocator is installed as OpenCV's default at module init but passes
+ * straight through to cv::fastMalloc until enabled from JS:
+ *
+ *   cv.setMatPool({ enabled: true, maxBytes: 256 << 20, hugePages: true });
+ *   cv.matPoolStats(); // { hits, misses, retainedBytes, ... }
+ */
+class MatPool: public Nan::ObjectWrap {
+public:
+  static void Init(Local<Object> target);
+
+#if CV_MAJOR_VERSION >= 3
+  static cv::MatAllocator* Allocator();
+#endif
+
+  static NAN_METHOD(SetMatPool);
+  static NAN_METHOD(MatPoolStats);
+};
+
+#endif
@@ -1,11 +1,25 @@
 #include "Contours.h"
+#include "Stats.h"
 #include "Matrix.h"
+#include "MatrixOps.h"
+#include "MatAccess.h"
+#include "MatrixFile.h"
+#include "Encoder.h"
+#include "Tiles.h"
+#include "DecodeCache.h"
+#include "AsyncResultWorker.h"
+#include "WorkerPool.h"
 #include "Point.h"
 #include "Size.h"
 #include "Rect.h"
 #include "Scalar.h"
 #include "OpenCV.h"
 #include <string.h>
+#include <climits>
+#include <stdexcept>
+#include <cmath>
+#include <algorithm>
+#include <vector>
 #include <nan.h>
 
 Nan::Persistent<FunctionTemplate> Matrix::constructor;
@@ -24,103 +38,94 @@ void Matrix::Init(Local<Object> target) {
   ctor->SetClassName(Nan::New("Matrix").ToLocalChecked());
 
   // Prototype
-  Nan::SetPrototypeMethod(ctor, "setTo", SetTo);
-
-  Nan::SetPrototypeMethod(ctor, "row", Row);
-  Nan::SetPrototypeMethod(ctor, "col", Col);
-  Nan::SetPrototypeMethod(ctor, "pixelRow", PixelRow);
-  Nan::SetPrototypeMethod(ctor, "pixelCol", PixelCol);
-  Nan::SetPrototypeMethod(ctor, "empty", Empty);
-  Nan::SetPrototypeMethod(ctor, "get", Get);
-  Nan::SetPrototypeMethod(ctor, "set", Set);
-  Nan::SetPrototypeMethod(ctor, "put", Put);
-  Nan::SetPrototypeMethod(ctor, "brightness", Brightness);
-  Nan::SetPrototypeMethod(ctor, "normalize", Normalize);
-  Nan::SetPrototypeMethod(ctor, "norm", Norm);
-  Nan::SetPrototypeMethod(ctor, "getData", GetData);
-  Nan::SetPrototypeMethod(ctor, "pixel", Pixel);
-  Nan::SetPrototypeMethod(ctor, "width", Width);
-  Nan::SetPrototypeMethod(ctor, "height", Height);
-  Nan::SetPrototypeMethod(ctor, "type", Type);
-  Nan::SetPrototypeMethod(ctor, "size", Size);
-  Nan::SetPrototypeMethod(ctor, "clone", Clone);
-  Nan::SetPrototypeMethod(ctor, "crop", Crop);
-  Nan::SetPrototypeMethod(ctor, "toBuffer", ToBuffer);
-  Nan::SetPrototypeMethod(ctor, "toBufferAsync", ToBufferAsync);
-  Nan::SetPrototypeMethod(ctor, "ellipse", Ellipse);
-  Nan::SetPrototypeMethod(ctor, "rectangle", Rectangle);
-  Nan::SetPrototypeMethod(ctor, "line", Line);
-  Nan::SetPrototypeMethod(ctor, "fillPoly", FillPoly);
-  Nan::SetPrototypeMethod(ctor, "save", Save);
-  Nan::SetPrototypeMethod(ctor, "saveAsync", SaveAsync);
-  Nan::SetPrototypeMethod(ctor, "resize", Resize);
-  Nan::SetPrototypeMethod(ctor, "rotate", Rotate);
-  Nan::SetPrototypeMethod(ctor, "warpAffine", WarpAffine);
-  Nan::SetPrototypeMethod(ctor, "copyTo", CopyTo);
-  Nan::SetPrototypeMethod(ctor, "convertTo", ConvertTo);
-  Nan::SetPrototypeMethod(ctor, "pyrDown", PyrDown);
-  Nan::SetPrototypeMethod(ctor, "pyrUp", PyrUp);
-  Nan::SetPrototypeMethod(ctor, "channels", Channels);
-  Nan::SetPrototypeMethod(ctor, "convertGrayscale", ConvertGrayscale);
-  Nan::SetPrototypeMethod(ctor, "convertHSVscale", ConvertHSVscale);
-  Nan::SetPrototypeMethod(ctor, "gaussianBlur", GaussianBlur);
-  Nan::SetPrototypeMethod(ctor, "medianBlur", MedianBlur);
-  Nan::SetPrototypeMethod(ctor, "bilateralFilter", BilateralFilter);
-  Nan::SetPrototypeMethod(ctor, "sobel", Sobel);
-  Nan::SetPrototypeMethod(ctor, "copy", Copy);
-  Nan::SetPrototypeMethod(ctor, "flip", Flip);
-  Nan::SetPrototypeMethod(ctor, "roi", ROI);
-  Nan::SetPrototypeMethod(ctor, "ptr", Ptr);
-  Nan::SetPrototypeMethod(ctor, "absDiff", AbsDiff);
-  Nan::SetPrototypeMethod(ctor, "dct", Dct);
-  Nan::SetPrototypeMethod(ctor, "idct", Idct);
-  Nan::SetPrototypeMethod(ctor, "addWeighted", AddWeighted);
-  Nan::SetPrototypeMethod(ctor, "add", Add);  
-  Nan::SetPrototypeMethod(ctor, "bitwiseXor", BitwiseXor);
-  Nan::SetPrototypeMethod(ctor, "bitwiseNot", BitwiseNot);
-  Nan::SetPrototypeMethod(ctor, "bitwiseAnd", BitwiseAnd);
-  Nan::SetPrototypeMethod(ctor, "countNonZero", CountNonZero);
-  Nan::SetPrototypeMethod(ctor, "moments", Moments);
-  Nan::SetPrototypeMethod(ctor, "canny", Canny);
-  Nan::SetPrototypeMethod(ctor, "dilate", Dilate);
-  Nan::SetPrototypeMethod(ctor, "erode", Erode);
-  Nan::SetPrototypeMethod(ctor, "findContours", FindContours);
-  Nan::SetPrototypeMethod(ctor, "drawContour", DrawContour);
-  Nan::SetPrototypeMethod(ctor, "drawAllContours", DrawAllContours);
-  Nan::SetPrototypeMethod(ctor, "goodFeaturesToTrack", GoodFeaturesToTrack);
-  Nan::SetPrototypeMethod(ctor, "calcOpticalFlowPyrLK", CalcOpticalFlowPyrLK);
-  Nan::SetPrototypeMethod(ctor, "houghLinesP", HoughLinesP);
-  Nan::SetPrototypeMethod(ctor, "houghCircles", HoughCircles);
-  Nan::SetPrototypeMethod(ctor, "inRange", inRange);
-  Nan::SetPrototypeMethod(ctor, "adjustROI", AdjustROI);
-  Nan::SetPrototypeMethod(ctor, "locateROI", LocateROI);
-  Nan::SetPrototypeMethod(ctor, "threshold", Threshold);
-  Nan::SetPrototypeMethod(ctor, "adaptiveThreshold", AdaptiveThreshold);
-  Nan::SetPrototypeMethod(ctor, "meanStdDev", MeanStdDev);
-  Nan::SetPrototypeMethod(ctor, "cvtColor", CvtColor);
-  Nan::SetPrototypeMethod(ctor, "split", Split);
-  Nan::SetPrototypeMethod(ctor, "merge", Merge);
-  Nan::SetPrototypeMethod(ctor, "equalizeHist", EqualizeHist);
-  Nan::SetPrototypeMethod(ctor, "floodFill", FloodFill);
-  Nan::SetPrototypeMethod(ctor, "matchTemplate", MatchTemplate);
-  Nan::SetPrototypeMethod(ctor, "templateMatches", TemplateMatches);
-  Nan::SetPrototypeMethod(ctor, "minMaxLoc", MinMaxLoc);
-  Nan::SetPrototypeMethod(ctor, "pushBack", PushBack);
-  Nan::SetPrototypeMethod(ctor, "putText", PutText);
-  Nan::SetPrototypeMethod(ctor, "getPerspectiveTransform", GetPerspectiveTransform);
-  Nan::SetPrototypeMethod(ctor, "warpPerspective", WarpPerspective);
-  Nan::SetMethod(ctor, "Zeros", Zeros);
-  Nan::SetMethod(ctor, "Ones", Ones);
-  Nan::SetMethod(ctor, "Eye", Eye);
-  Nan::SetMethod(ctor, "getRotationMatrix2D", GetRotationMatrix2D);
-  Nan::SetPrototypeMethod(ctor, "copyWithMask", CopyWithMask);
-  Nan::SetPrototypeMethod(ctor, "mean", Mean);
-  Nan::SetPrototypeMethod(ctor, "shift", Shift);
-  Nan::SetPrototypeMethod(ctor, "reshape", Reshape);
-  Nan::SetPrototypeMethod(ctor, "release", Release);
-  Nan::SetPrototypeMethod(ctor, "subtract", Subtract);
-
-  Nan::SetPrototypeMethod(ctor, "toString", ToString);
+  Stats::SetPrototypeMethod(ctor, "setTo", SetTo);
+
+  Stats::SetPrototypeMethod(ctor, "row", Row);
+  Stats::SetPrototypeMethod(ctor, "col", Col);
+  Stats::SetPrototypeMethod(ctor, "pixelRow", PixelRow);
+  Stats::SetPrototypeMethod(ctor, "pixelCol", PixelCol);
+  Stats::SetPrototypeMethod(ctor, "rowData", RowData);
+  Stats::SetPrototypeMethod(ctor, "colData", ColData);
+  Stats::SetPrototypeMethod(ctor, "regionData", RegionData);
+  Stats::SetPrototypeMethod(ctor, "channelData", ChannelData);
+  Stats::SetPrototypeMethod(ctor, "empty", Empty);
+  Stats::SetPrototypeMethod(ctor, "get", Get);
+  Stats::SetPrototypeMethod(ctor, "set", Set);
+  Stats::SetPrototypeMethod(ctor, "put", Put);
+  Stats::SetPrototypeMethod(ctor, "setData", SetData);
+  Stats::SetPrototypeMethod(ctor, "putRegion", PutRegion);
+  Stats::SetPrototypeMethod(ctor, "normalize", Normalize);
+  Stats::SetPrototypeMethod(ctor, "norm", Norm);
+  Stats::SetPrototypeMethod(ctor, "getData", GetData);
+  Stats::SetPrototypeMethod(ctor, "data", Data);
+  Stats::SetPrototypeMethod(ctor, "pixel", Pixel);
+  Stats::SetPrototypeMethod(ctor, "width", Width);
+  Stats::SetPrototypeMethod(ctor, "height", Height);
+  Stats::SetPrototypeMethod(ctor, "type", Type);
+  Stats::SetPrototypeMethod(ctor, "size", Size);
+  Stats::SetPrototypeMethod(ctor, "clone", Clone);
+  Stats::SetPrototypeMethod(ctor, "crop", Crop);
+  Stats::SetPrototypeMethod(ctor, "toBuffer", ToBuffer);
+  Stats::SetPrototypeMethod(ctor, "toBufferAsync", ToBufferAsync);
+  Stats::SetPrototypeMethod(ctor, "ellipse", Ellipse);
+  Stats::SetPrototypeMethod(ctor, "rectangle", Rectangle);
+  Stats::SetPrototypeMethod(ctor, "line", Line);
+  Stats::SetPrototypeMethod(ctor, "fillPoly", FillPoly);
+  Stats::SetPrototypeMethod(ctor, "save", Save);
+  Stats::SetPrototypeMethod(ctor, "saveAsync", SaveAsync);
+  Stats::SetPrototypeMethod(ctor, "saveRaw", SaveRaw);
+  Stats::SetPrototypeMethod(ctor, "rotate", Rotate);
+  Stats::SetPrototypeMethod(ctor, "copyTo", CopyTo);
+  Stats::SetPrototypeMethod(ctor, "convertTo", ConvertTo);
+  Stats::SetPrototypeMethod(ctor, "channels", Channels);
+  Stats::SetPrototypeMethod(ctor, "convertHSVscale", ConvertHSVscale);
+  Stats::SetPrototypeMethod(ctor, "sobel", Sobel);
+  Stats::SetPrototypeMethod(ctor, "copy", Copy);
+  Stats::SetPrototypeMethod(ctor, "flip", Flip);
+  Stats::SetPrototypeMethod(ctor, "roi", ROI);
+  Stats::SetPrototypeMethod(ctor, "ptr", Ptr);
+  Stats::SetPrototypeMethod(ctor, "absDiff", AbsDiff);
+  Stats::SetPrototypeMethod(ctor, "dct", Dct);
+  Stats::SetPrototypeMethod(ctor, "idct", Idct);
+  Stats::SetPrototypeMethod(ctor, "addWeighted", AddWeighted);
+  Stats::SetPrototypeMethod(ctor, "add", Add);  
+  Stats::SetPrototypeMethod(ctor, "bitwiseXor", BitwiseXor);
+  Stats::SetPrototypeMethod(ctor, "bitwiseNot", BitwiseNot);
+  Stats::SetPrototypeMethod(ctor, "bitwiseAnd", BitwiseAnd);
+  Stats::SetPrototypeMethod(ctor, "countNonZero", CountNonZero);
+  Stats::SetPrototypeMethod(ctor, "moments", Moments);
+  Stats::SetPrototypeMethod(ctor, "drawContour", DrawContour);
+  Stats::SetPrototypeMethod(ctor, "drawAllContours", DrawAllContours);
+  Stats::SetPrototypeMethod(ctor, "goodFeaturesToTrack", GoodFeaturesToTrack);
+  Stats::SetPrototypeMethod(ctor, "calcOpticalFlowPyrLK", CalcOpticalFlowPyrLK);
+  Stats::SetPrototypeMethod(ctor, "adjustROI", AdjustROI);
+  Stats::SetPrototypeMethod(ctor, "locateROI", LocateROI);
+  Stats::SetPrototypeMethod(ctor, "meanStdDev", MeanStdDev);
+  Stats::SetPrototypeMethod(ctor, "split", Split);
+  Stats::SetPrototypeMethod(ctor, "merge", Merge);
+  Stats::SetPrototypeMethod(ctor, "templateMatches", TemplateMatches);
+  Stats::SetPrototypeMethod(ctor, "minMaxLoc", MinMaxLoc);
+  Stats::SetPrototypeMethod(ctor, "pushBack", PushBack);
+  Stats::SetPrototypeMethod(ctor, "putText", PutText);
+  Stats::SetPrototypeMethod(ctor, "getPerspectiveTransform", GetPerspectiveTransform);
+  Stats::SetMethod(ctor, "Zeros", Zeros);
+  Stats::SetMethod(ctor, "Ones", Ones);
+  Stats::SetMethod(ctor, "Eye", Eye);
+  Stats::SetMethod(ctor, "fromBuffer", FromBuffer);
+  Stats::SetMethod(ctor, "loadRaw", LoadRaw);
+  Stats::SetMethod(ctor, "createRaw", CreateRaw);
+  Stats::SetMethod(ctor, "getRotationMatrix2D", GetRotationMatrix2D);
+  Stats::SetPrototypeMethod(ctor, "copyWithMask", CopyWithMask);
+  Stats::SetPrototypeMethod(ctor, "mean", Mean);
+  Stats::SetPrototypeMethod(ctor, "shift", Shift);
+  Stats::SetPrototypeMethod(ctor, "reshape", Reshape);
+  Stats::SetPrototypeMethod(ctor, "release", Release);
+  Stats::SetPrototypeMethod(ctor, "subtract", Subtract);
+
+  Stats::SetPrototypeMethod(ctor, "toString", ToString);
+
+  MatrixOps::Init(ctor);
+  Tiles::Init(ctor);
 
   target->Set(Nan::New("Matrix").ToLocalChecked(), ctor->GetFunction());
 };
@@ -152,9 +157,11 @@ NAN_METHOD(Matrix::New) {
     int w = info[3]->IntegerValue();
     int h = info[4]->IntegerValue();
     mat = new Matrix(other->mat, cv::Rect(x, y, w, h));
+    mat->ShareBacking(other);
   }
 
   mat->Wrap(info.Holder());
+  mat->UpdateExternalMemory();
   info.GetReturnValue().Set(info.Holder());
 }
 
@@ -162,31 +169,46 @@ Local<Object> Matrix::NewInstance() {
   return Nan::NewInstance(Nan::GetFunction(Nan::New(constructor)).ToLocalChecked()).ToLocalChecked();
 }
 
+Local<Object> Matrix::NewInstance(const cv::Mat &mat) {
+  Local<Object> obj = NewInstance();
+  Matrix *m = UNWRAP_OBJ(Matrix, obj);
+  m->mat = mat;
+  m->UpdateExternalMemory();
+
+  return obj;
+}
+
 bool Matrix::HasInstance(Local<Value> object) {
   return Nan::New(constructor)->HasInstance(object);
 }
 
 Matrix::Matrix() :
-    node_opencv::Matrix() {
+    node_opencv::Matrix(), externalMemory(0), site(Stats::Current()), copyOnWrite(false) {
+  Stats::TrackMatrix(site, 1, 0);
   mat = cv::Mat();
 }
 
 Matrix::Matrix(int rows, int cols) :
-    node_opencv::Matrix() {
+    node_opencv::Matrix(), externalMemory(0), site(Stats::Current()), copyOnWrite(false) {
+  Stats::TrackMatrix(site, 1, 0);
   mat = cv::Mat(rows, cols, CV_32FC3);
 }
 
 Matrix::Matrix(int rows, int cols, int type) :
-    node_opencv::Matrix() {
+    node_opencv::Matrix(), externalMemory(0), site(Stats::Current()), copyOnWrite(false) {
+  Stats::TrackMatrix(site, 1, 0);
   mat = cv::Mat(rows, cols, type);
 }
 
 Matrix::Matrix(cv::Mat m, cv::Rect roi) :
-    node_opencv::Matrix() {
+    node_opencv::Matrix(), externalMemory(0), site(Stats::Current()), copyOnWrite(false) {
+  Stats::TrackMatrix(site, 1, 0);
   mat = cv::Mat(m, roi);
 }
 
-Matrix::Matrix(int rows, int cols, int type, Local<Object> scalarObj) {
+Matrix::Matrix(int rows, int cols, int type, Local<Object> scalarObj) :
+    node_opencv::Matrix(), externalMemory(0), site(Stats::Current()), copyOnWrite(false) {
+  Stats::TrackMatrix(site, 1, 0);
   mat = cv::Mat(rows, cols, type);
   if (mat.channels() == 3) {
     mat.setTo(cv::Scalar(scalarObj->Get(0)->IntegerValue(),
@@ -202,41 +224,139 @@ Matrix::Matrix(int rows, int cols, int type, Local<Object> scalarObj) {
   }
 }
 
+// Nan::AdjustExternalMemory takes an int, so big frames are reported in slices.
+static void AdjustExternalMemory(int64_t change) {
+  while (change > INT_MAX) {
+    Nan::AdjustExternalMemory(INT_MAX);
+    change -= INT_MAX;
+  }
+  while (change < -INT_MAX) {
+    Nan::AdjustExternalMemory(-INT_MAX);
+    change += INT_MAX;
+  }
+  Nan::AdjustExternalMemory((int) change);
+}
+
+Matrix::~Matrix() {
+  AdjustExternalMemory(-externalMemory);
+  Stats::TrackMatrix(site, -1, -externalMemory);
+  backing.Reset();
+}
+
+// Bytes of pixel data this matrix holds on to. Memory that OpenCV does not own
+// (user supplied data) is accounted for by whoever allocated it.
+static int64_t PixelBytes(const cv::Mat &mat) {
+#if CV_MAJOR_VERSION >= 3
+  // Mapped files (MatrixFile::Map) aren't heap either
+  if (mat.u == NULL || (mat.u->flags & cv::UMatData::USER_ALLOCATED)) {
+#else
+  if (mat.refcount == NULL) {
+#endif
+    return 0;
+  }
+
+  return (int64_t) mat.total() * mat.elemSize();
+}
+
+void Matrix::UpdateExternalMemory() {
+  int64_t bytes = PixelBytes(mat);
+  if (bytes != externalMemory) {
+    AdjustExternalMemory(bytes - externalMemory);
+    Stats::TrackMatrix(site, 0, bytes - externalMemory);
+    externalMemory = bytes;
+  }
+}
+
+void Matrix::SetBacking(Local<Object> owner) {
+  backing.Reset(owner);
+}
+
+Local<Value> Matrix::Backing() const {
+  if (backing.IsEmpty()) {
+    return Nan::Undefined();
+  }
+  return Nan::New(backing);
+}
+
+void Matrix::ShareBacking(const Matrix *owner) {
+  if (!owner->backing.IsEmpty()) {
+    backing.Reset(Nan::New(owner->backing));
+  }
+  // A view of read-only pixels is read-only too
+  copyOnWrite = owner->copyOnWrite;
+}
+
+void Matrix::SetCopyOnWrite() {
+  copyOnWrite = true;
+}
+
+bool Matrix::IsShared(const cv::Mat &mat) {
+#if CV_MAJOR_VERSION >= 3
+  return mat.u != NULL && CV_XADD(&mat.u->refcount, 0) > 1;
+#else
+  return mat.refcount != NULL && CV_XADD(mat.refcount, 0) > 1;
+#endif
+}
+
+void Matrix::MakeWritable() {
+  if (!copyOnWrite) {
+    return;
+  }
+  copyOnWrite = false;
+
+  // Pixels that were replaced since, or that the cache has let go of, are ours
+  if (IsShared(mat)) {
+    mat = mat.clone();
+    UpdateExternalMemory();
+    DecodeCache::RecordCopy();
+  }
+}
+
+void Matrix::MakeOverwritable() {
+  copyOnWrite = false;
+
+  // Views, data() Buffers, workers and the FramePool may hold on to them too
+  if (IsShared(mat)) {
+    mat = cv::Mat();
+    UpdateExternalMemory();
+  }
+}
+
 NAN_METHOD(Matrix::Empty) {
   SETUP_FUNCTION(Matrix)
   info.GetReturnValue().Set(Nan::New<Boolean>(self->mat.empty()));
 }
 
+// First channel of element (i, j), for any matrix type.
 double Matrix::DblGet(cv::Mat mat, int i, int j) {
+  double values[CV_CN_MAX];
+  MatAccessor::For(mat.type()).get(mat, i, j, values);
+  return values[0];
+}
 
-  double val = 0;
-  cv::Vec3b pix;
-  unsigned int pint = 0;
-
-  switch (mat.type()) {
-    case CV_32FC3:
-      pix = mat.at<cv::Vec3f>(i, j);
-      pint |= (uchar) pix.val[2];
-      pint |= ((uchar) pix.val[1]) << 8;
-      pint |= ((uchar) pix.val[0]) << 16;
-      val = (double) pint;
-      break;
-    case CV_64FC1:
-      val = mat.at<double>(i, j);
-      break;
-    case CV_32FC1:
-      val = mat.at<float>(i, j);
-      break;
-    default:
-      val = mat.at<double>(i, j);
-      break;
+// A number for single channel matrices, an array of channel values otherwise.
+static Local<Value> ElementValue(const cv::Mat &mat, int i, int j) {
+  double values[CV_CN_MAX];
+  MatAccessor::For(mat.type()).get(mat, i, j, values);
+
+  if (mat.channels() == 1) {
+    return Nan::New<Number>(values[0]);
+  }
+
+  Local<Array> arr = Nan::New<Array>(mat.channels());
+  for (int c = 0; c < mat.channels(); c++) {
+    arr->Set(c, Nan::New<Number>(values[c]));
   }
+  return arr;
+}
 
-  return val;
+static bool InBounds(const cv::Mat &mat, int i, int j) {
+  return i >= 0 && i < mat.rows && j >= 0 && j < mat.cols;
 }
 
 NAN_METHOD(Matrix::SetTo) {
   SETUP_FUNCTION(Matrix)
+  self->MakeWritable();
 
   if (info.Length() == 0) {
     return Nan::ThrowError("Matrix.setTo requires at least 1 argument");
@@ -260,40 +380,27 @@ NAN_METHOD(Matrix::Pixel) {
   int y = info[0]->IntegerValue();
   int x = info[1]->IntegerValue();
 
-  // cv::Scalar scal = self->mat.at<uchar>(y, x);
+  if (!InBounds(self->mat, y, x)) {
+    return Nan::ThrowRangeError("Pixel is outside the matrix");
+  }
 
   if (info.Length() == 3) {
-    Local < Object > objColor = info[2]->ToObject();
-
-    if (self->mat.channels() == 3) {
-      self->mat.at<cv::Vec3b>(y, x)[0] =
-          (uchar) objColor->Get(0)->IntegerValue();
-      self->mat.at<cv::Vec3b>(y, x)[1] =
-          (uchar) objColor->Get(1)->IntegerValue();
-      self->mat.at<cv::Vec3b>(y, x)[2] =
-          (uchar) objColor->Get(2)->IntegerValue();
-    } else if (self->mat.channels() == 1)
-      self->mat.at<uchar>(y, x) = (uchar) objColor->Get(0)->IntegerValue();
-
-    info.GetReturnValue().Set(info[2]->ToObject());
-  } else {
-    if (self->mat.channels() == 3) {
-      cv::Vec3b intensity = self->mat.at<cv::Vec3b>(y, x);
-
-      v8::Local < v8::Array > arr = Nan::New<v8::Array>(3);
-      arr->Set(0, Nan::New<Number>(intensity[0]));
-      arr->Set(1, Nan::New<Number>(intensity[1]));
-      arr->Set(2, Nan::New<Number>(intensity[2]));
-      info.GetReturnValue().Set(arr);
-    } else if (self->mat.channels() == 1) {
-      uchar intensity = self->mat.at<uchar>(y, x);
-      info.GetReturnValue().Set(Nan::New<Number>(intensity));
+    if (!info[2]->IsArray()) {
+      return Nan::ThrowTypeError("Color must be an array of channel values");
     }
-  }
 
-  return;
-  // double val = Matrix::DblGet(t, i, j);
-  // info.GetReturnValue().Set(Nan::New<Number>(val));
+    self->MakeWritable();
+    Local<Array> objColor = Local<Array>::Cast(info[2]);
+    MatAccessor access = MatAccessor::For(self->mat.type());
+    int channels = std::min((int) objColor->Length(), self->mat.channels());
+    for (int c = 0; c < channels; c++) {
+      access.set(self->mat, y, x, c, objColor->Get(c)->NumberValue());
+    }
+
+    info.GetReturnValue().Set(info[2]);
+  } else {
+    info.GetReturnValue().Set(ElementValue(self->mat, y, x));
+  }
 }
 
 NAN_METHOD(Matrix::Get) {
@@ -302,41 +409,46 @@ NAN_METHOD(Matrix::Get) {
   int i = info[0]->IntegerValue();
   int j = info[1]->IntegerValue();
 
-  double val = Matrix::DblGet(self->mat, i, j);
-  info.GetReturnValue().Set(Nan::New<Number>(val));
+  if (!InBounds(self->mat, i, j)) {
+    return Nan::ThrowRangeError("Element is outside the matrix");
+  }
+
+  info.GetReturnValue().Set(ElementValue(self->mat, i, j));
 }
 
+// mat.set(i, j, value[, channel]); mat.set(i, j, [c0, c1, ...]);
 NAN_METHOD(Matrix::Set) {
   SETUP_FUNCTION(Matrix)
+  self->MakeWritable();
+
+  if (info.Length() < 3 || info.Length() > 4) {
+    return Nan::ThrowTypeError("Invalid number of arguments");
+  }
 
   int i = info[0]->IntegerValue();
   int j = info[1]->IntegerValue();
-  double val = info[2]->NumberValue();
-  int vint = 0;
-
-  if (info.Length() == 4) {
-    self->mat.at<cv::Vec3b>(i, j)[info[3]->NumberValue()] = val;
-  } else if (info.Length() == 3) {
-    switch (self->mat.type()) {
-      case CV_32FC3:
-        vint = static_cast<unsigned int>(val + 0.5);
-        self->mat.at<cv::Vec3f>(i, j)[0] = (uchar) (vint >> 16) & 0xff;
-        self->mat.at<cv::Vec3f>(i, j)[1] = (uchar) (vint >> 8) & 0xff;
-        self->mat.at<cv::Vec3f>(i, j)[2] = (uchar) (vint) & 0xff;
-        // printf("!!!i %x, %x, %x", (vint >> 16) & 0xff, (vint >> 8) & 0xff, (vint) & 0xff);
-        break;
-      case CV_32FC1:
-        self->mat.at<float>(i, j) = val;
-        break;
-      default:
-        self->mat.at<double>(i, j) = val;
+
+  if (!InBounds(self->mat, i, j)) {
+    return Nan::ThrowRangeError("Element is outside the matrix");
+  }
+
+  MatAccessor access = MatAccessor::For(self->mat.type());
+
+  if (info[2]->IsArray()) {
+    Local<Array> values = Local<Array>::Cast(info[2]);
+    int channels = std::min((int) values->Length(), self->mat.channels());
+    for (int c = 0; c < channels; c++) {
+      access.set(self->mat, i, j, c, values->Get(c)->NumberValue());
     }
+    return;
+  }
 
-  } else {
-    Nan::ThrowTypeError("Invalid number of arguments");
+  int channel = info.Length() == 4 ? info[3]->IntegerValue() : 0;
+  if (channel < 0 || channel >= self->mat.channels()) {
+    return Nan::ThrowRangeError("Channel index out of range");
   }
 
-  return;
+  access.set(self->mat, i, j, channel, info[2]->NumberValue());
 }
 
 // @author tualo
@@ -344,14 +456,197 @@ NAN_METHOD(Matrix::Set) {
 // img.put(new Buffer([0,100,0,100,100...]));
 NAN_METHOD(Matrix::Put) {
   SETUP_FUNCTION(Matrix)
+  self->MakeWritable();
 
   if (!Buffer::HasInstance(info[0])) {
-    Nan::ThrowTypeError("Not a buffer");
+    return Nan::ThrowTypeError("Not a buffer");
   }
   const char* buffer_data = Buffer::Data(info[0]);
   size_t buffer_length = Buffer::Length(info[0]);
-  memcpy(self->mat.data, buffer_data, buffer_length);
-  return;
+
+  size_t rowBytes = self->mat.cols * self->mat.elemSize();
+  if (buffer_length > rowBytes * self->mat.rows) {
+    return Nan::ThrowRangeError("Buffer is larger than the matrix");
+  }
+
+  // Row by row, so that padding after each row (ROI views) is skipped.
+  for (int y = 0; buffer_length > 0; y++) {
+    size_t n = std::min(rowBytes, buffer_length);
+    memcpy(self->mat.ptr(y), buffer_data, n);
+    buffer_data += n;
+    buffer_length -= n;
+  }
+}
+
+// Whether `rows` rows of `rowBytes` bytes, `step` bytes apart, fit in
+// `length` bytes. Divides rather than multiplies, so that huge steps can't
+// wrap around.
+static bool RowsFit(size_t length, int rows, size_t rowBytes, size_t step) {
+  if (rows <= 0 || rowBytes > length) {
+    return rows <= 0;
+  }
+  return rows == 1 || step <= (length - rowBytes) / (size_t) (rows - 1);
+}
+
+// A byte count or distance from JS. False unless it's a non-negative integer.
+static bool ToByteCount(Local<Value> value, size_t &out) {
+  if (!value->IsNumber()) {
+    return false;
+  }
+  double number = value->NumberValue();
+  if (!(number >= 0) || number != std::floor(number) || number > 9007199254740991.0) {
+    return false;
+  }
+  out = (size_t) number;
+  return true;
+}
+
+// Element depth of a typed array, -1 for anything else.
+static int TypedArrayDepth(Local<Value> value) {
+  if (value->IsUint8Array() || value->IsUint8ClampedArray()) return CV_8U;
+  if (value->IsInt8Array()) return CV_8S;
+  if (value->IsUint16Array()) return CV_16U;
+  if (value->IsInt16Array()) return CV_16S;
+  if (value->IsInt32Array()) return CV_32S;
+  if (value->IsFloat32Array()) return CV_32F;
+  if (value->IsFloat64Array()) return CV_64F;
+  return -1;
+}
+
+// Copies `data` into `rect` of `mat`, or into one channel of it, both of which
+// the caller has checked. Buffers hold elements of the matrix depth; typed
+// arrays hold their own element type and are converted. `stride` is the byte
+// distance between source rows, 0 for packed rows. Throws a const char* on data
+// of the wrong kind, std::out_of_range on a stride or size that doesn't fit.
+static void WriteRegion(cv::Mat &mat, const cv::Rect &rect, int channel,
+    Local<Value> data, size_t stride) {
+  char *bytes;
+  size_t length;
+  int depth = TypedArrayDepth(data);
+
+  // Buffer::HasInstance() takes any ArrayBufferView on newer Node, so only
+  // Buffers and Uint8Arrays are taken as raw bytes
+  if (Buffer::HasInstance(data) && (depth < 0 || depth == CV_8U)) {
+    bytes = Buffer::Data(data);
+    length = Buffer::Length(data);
+    depth = mat.depth();
+  } else if (depth >= 0) {
+    Local<ArrayBufferView> view = data.As<ArrayBufferView>();
+    bytes = (char *) view->Buffer()->GetContents().Data() + view->ByteOffset();
+    length = view->ByteLength();
+  } else {
+    throw "Data must be a Buffer or a typed array";
+  }
+
+  int type = CV_MAKETYPE(depth, channel >= 0 ? 1 : mat.channels());
+  size_t rowBytes = (size_t) rect.width * CV_ELEM_SIZE(type);
+  if (stride == 0) {
+    stride = rowBytes;
+  }
+  if (stride < rowBytes || stride % CV_ELEM_SIZE1(type) != 0) {
+    throw std::out_of_range("Stride must cover a whole row and be a multiple of the element size");
+  }
+  if (!RowsFit(length, rect.height, rowBytes, stride)) {
+    throw std::out_of_range("Data is too small for the region");
+  }
+
+  cv::Mat src(rect.height, rect.width, type, bytes, stride);
+  cv::Mat target = mat(rect);
+
+  if (channel < 0) {
+    // Same size and type, so this writes through the ROI header.
+    src.convertTo(target, mat.type());
+    return;
+  }
+
+  if (depth != mat.depth()) {
+    src.convertTo(src, mat.depth());
+  }
+  int fromTo[] = {0, channel};
+  cv::mixChannels(&src, 1, &target, 1, fromTo, 1);
+}
+
+// Writes the whole matrix from a Buffer or typed array, converting typed
+// array elements to the matrix depth.
+// img.setData(data[, stride]);
+NAN_METHOD(Matrix::SetData) {
+  SETUP_FUNCTION(Matrix)
+  self->MakeWritable();
+
+  if (self->mat.empty()) {
+    return Nan::ThrowError("Matrix is empty");
+  }
+
+  size_t stride = 0;
+  if (info.Length() > 1 && !info[1]->IsUndefined() && !ToByteCount(info[1], stride)) {
+    return Nan::ThrowRangeError("Stride must be a non-negative integer");
+  }
+
+  try {
+    WriteRegion(self->mat, cv::Rect(0, 0, self->mat.cols, self->mat.rows), -1,
+        info[0], stride);
+  } catch (const char *msg) {
+    return Nan::ThrowTypeError(msg);
+  } catch (const std::out_of_range &e) {
+    return Nan::ThrowRangeError(e.what());
+  }
+}
+
+// Same for a rectangle of the matrix, optionally one channel only.
+// img.putRegion(data, rect[, { channel: 2, stride: 4096 }]);
+NAN_METHOD(Matrix::PutRegion) {
+  SETUP_FUNCTION(Matrix)
+  self->MakeWritable();
+
+  if (info.Length() < 2) {
+    return Nan::ThrowError("Matrix.putRegion requires at least 2 arguments");
+  }
+
+  int channel = -1;
+  size_t stride = 0;
+  if (info.Length() > 2 && info[2]->IsObject()) {
+    Local<Object> options = info[2]->ToObject();
+    Local<String> channelKey = Nan::New<String>("channel").ToLocalChecked();
+    Local<String> strideKey = Nan::New<String>("stride").ToLocalChecked();
+
+    if (options->Has(channelKey)) {
+      channel = options->Get(channelKey)->IntegerValue();
+      if (channel < 0 || channel >= self->mat.channels()) {
+        return Nan::ThrowRangeError("Channel index out of range");
+      }
+    }
+    if (options->Has(strideKey) && !ToByteCount(options->Get(strideKey), stride)) {
+      return Nan::ThrowRangeError("Stride must be a non-negative integer");
+    }
+  }
+
+  cv::Rect rect;
+  try {
+    Local<Value> rectArg = info[1];
+    rect = Rect::RawRect(1, &rectArg);
+  } catch (const char *msg) {
+    return Nan::ThrowTypeError(msg);
+  }
+
+  if ((rect & cv::Rect(0, 0, self->mat.cols, self->mat.rows)) != rect || rect.area() == 0) {
+    return Nan::ThrowRangeError("Region is outside the matrix");
+  }
+
+  try {
+    WriteRegion(self->mat, rect, channel, info[0], stride);
+  } catch (const char *msg) {
+    return Nan::ThrowTypeError(msg);
+  } catch (const std::out_of_range &e) {
+    return Nan::ThrowRangeError(e.what());
+  }
+}
+
+// Buffers and typed arrays have a size limit (2 or 4 GB depending on the node
+// version) that mapped rasters easily exceed.
+static const char *kTooLargeForBuffer = "Matrix is too large for a Buffer, read it through roi() views";
+
+static bool FitsInBuffer(size_t bytes) {
+  return bytes <= node::Buffer::kMaxLength;
 }
 
 // @author tualo
@@ -360,73 +655,116 @@ NAN_METHOD(Matrix::GetData) {
   Nan::HandleScope scope;
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-  int size = self->mat.rows * self->mat.cols * self->mat.elemSize();
+  size_t size = self->mat.total() * self->mat.elemSize();
+  if (!FitsInBuffer(size)) {
+    return Nan::ThrowRangeError(kTooLargeForBuffer);
+  }
   Local<Object> buf = Nan::NewBuffer(size).ToLocalChecked();
   uchar* data = (uchar*) Buffer::Data(buf);
-  // if there is padding after each row, clone first to get rid of it
-  if (self->mat.dims == 2 && self->mat.step[0] != size_t(self->mat.size[1])) {
-    cv::Mat copy = self->mat.clone();
-    memcpy(data, copy.data, size);
-  } else {
-    memcpy(data, self->mat.data, size);
+
+  // Copy row by row so that padding after each row (ROI views) is dropped.
+  cv::Mat dst(self->mat.size(), self->mat.type(), data);
+  self->mat.copyTo(dst);
+
+  info.GetReturnValue().Set(buf);
+}
+
+// What a Buffer returned from Matrix::Data keeps alive: the pixels, and the
+// JS object that owns them when OpenCV doesn't (Matrix.fromBuffer).
+struct MatView {
+  cv::Mat mat;
+  Nan::Persistent<Value> backing;
+};
+
+static void FreeMatView(char *data, void *hint) {
+  MatView *view = static_cast<MatView *>(hint);
+  view->backing.Reset();
+  delete view;
+}
+
+// `backing` is the owner's Matrix::Backing() when `mat` points into its pixels.
+static Local<Object> NewMatView(const cv::Mat &mat, size_t size, Local<Value> backing) {
+  if (size == 0) {
+    return Nan::NewBuffer(0).ToLocalChecked();
+  }
+
+  MatView *view = new MatView();
+  view->mat = mat;
+  if (!backing->IsUndefined()) {
+    view->backing.Reset(backing);
+  }
+  return Nan::NewBuffer((char *) view->mat.data, size, FreeMatView, view).ToLocalChecked();
+}
+
+// Buffer aliasing the pixel data without copying it. The Buffer holds its own
+// reference to the cv::Mat, and to the Buffer it wraps for fromBuffer
+// matrices, so it stays valid after the Matrix is released.
+// Rows of ROI views are not contiguous, those get a Buffer over a detached
+// copy that writes don't reach the Matrix through.
+// img.data(); // <Buffer ...>
+NAN_METHOD(Matrix::Data) {
+  SETUP_FUNCTION(Matrix)
+
+  if (!FitsInBuffer(self->mat.total() * self->mat.elemSize())) {
+    return Nan::ThrowRangeError(kTooLargeForBuffer);
   }
 
-  v8::Local<v8::Object> globalObj = Nan::GetCurrentContext()->Global();
-  v8::Local<v8::Function> bufferConstructor = v8::Local<v8::Function>::Cast(globalObj->Get(Nan::New<String>("Buffer").ToLocalChecked()));
-  v8::Local<v8::Value> constructorArgs[3] = {buf, Nan::New<v8::Integer>((unsigned) size), Nan::New<v8::Integer>(0)};
-  v8::Local<v8::Object> actualBuffer = Nan::NewInstance(bufferConstructor, 3, constructorArgs).ToLocalChecked();
+  if (!self->mat.isContinuous()) {
+    cv::Mat mat = self->mat.clone();
+    return info.GetReturnValue().Set(NewMatView(mat, mat.total() * mat.elemSize(), Nan::Undefined()));
+  }
 
-  info.GetReturnValue().Set(actualBuffer);
+  // The Buffer can write into the pixels
+  self->MakeWritable();
+  info.GetReturnValue().Set(NewMatView(self->mat, self->mat.total() * self->mat.elemSize(),
+      self->Backing()));
 }
 
-NAN_METHOD(Matrix::Brightness) {
+// Wraps a Buffer as a Matrix without copying it. The Matrix keeps the Buffer
+// alive; writes through either one are visible in the other.
+// cv.Matrix.fromBuffer(buf, rows, cols, type[, step]);
+NAN_METHOD(Matrix::FromBuffer) {
   Nan::HandleScope scope;
-  Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
 
-  if (info.Length() == 2) {
-    cv::Mat image;
+  if (info.Length() < 4) {
+    return Nan::ThrowError("Matrix.fromBuffer requires at least 4 arguments");
+  }
 
-    if (self->mat.channels() == 3) {
-      image = self->mat;
-    } else if (self->mat.channels() == 1) {
-      cv::Mat myimg = self->mat;
-      cv::cvtColor(myimg, image, CV_GRAY2RGB);
-    } else {
-      Nan::ThrowError("those channels are not supported");
-    }
+  if (!Buffer::HasInstance(info[0])) {
+    return Nan::ThrowTypeError("Argument 1 must be a Buffer");
+  }
 
-    cv::Mat new_image = cv::Mat::zeros( image.size(), image.type() );
-    double alpha = info[0]->NumberValue();
-    int beta = info[1]->IntegerValue();
-
-    // Do the operation new_image(i,j) = alpha*image(i,j) + beta
-    for (int y = 0; y < image.rows; y++ ) {
-      for (int x = 0; x < image.cols; x++ ) {
-        for (int c = 0; c < 3; c++ ) {
-          new_image.at<cv::Vec3b>(y,x)[c] =
-              cv::saturate_cast<uchar>(alpha*( image.at<cv::Vec3b>(y,x)[c] ) + beta);
-        }
-      }
-    }
+  if (!info[1]->IsInt32() || !info[2]->IsInt32() || !info[3]->IsInt32()) {
+    return Nan::ThrowTypeError("rows, cols and type must be integers");
+  }
 
-    if (self->mat.channels() == 3) {
-      new_image.copyTo(self->mat);
-    } else if (self->mat.channels() == 1) {
-      cv::Mat gray;
-      cv::cvtColor(new_image, gray, CV_BGR2GRAY);
-      gray.copyTo(self->mat);
-    }
-  } else {
-    if (info.Length() == 1) {
-      int diff = info[0]->IntegerValue();
-      cv::Mat img = self->mat + diff;
-      img.copyTo(self->mat);
-    } else {
-      info.GetReturnValue().Set(Nan::New("Insufficient or wrong arguments").ToLocalChecked());
-    }
+  int rows = info[1]->Int32Value();
+  int cols = info[2]->Int32Value();
+  int type = info[3]->Int32Value();
+
+  if (rows <= 0 || cols <= 0) {
+    return Nan::ThrowError("rows and cols must be > 0");
   }
 
-  info.GetReturnValue().Set(Nan::Null());
+  size_t rowBytes = (size_t) cols * CV_ELEM_SIZE(type);
+  size_t step = rowBytes;
+  if (info.Length() > 4 && !info[4]->IsUndefined() && !ToByteCount(info[4], step)) {
+    return Nan::ThrowRangeError("step must be a non-negative integer");
+  }
+
+  if (step < rowBytes || step % CV_ELEM_SIZE1(type) != 0) {
+    return Nan::ThrowRangeError("step must cover a whole row and be a multiple of the element size");
+  }
+
+  Local<Object> buf = info[0]->ToObject();
+  if (!RowsFit(Buffer::Length(buf), rows, rowBytes, step)) {
+    return Nan::ThrowRangeError("Buffer is too small for the given size and type");
+  }
+
+  Local<Object> out = NewInstance(cv::Mat(rows, cols, type, Buffer::Data(buf), step));
+  UNWRAP_OBJ(Matrix, out)->SetBacking(buf);
+
+  info.GetReturnValue().Set(out);
 }
 
 int getNormType(int type) {
@@ -476,7 +814,9 @@ NAN_METHOD(Matrix::Normalize) {
 
   cv::normalize(self->mat, norm, min, max, type, dtype, mask);
 
+  self->MakeWritable();
   norm.copyTo(self->mat);
+  self->UpdateExternalMemory();
 
   info.GetReturnValue().Set(Nan::Null());
 }
@@ -540,13 +880,7 @@ NAN_METHOD(Matrix::Type) {
 NAN_METHOD(Matrix::Clone) {
   SETUP_FUNCTION(Matrix)
 
-  Local < Object > im_h =
-      Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-
-  Matrix *m = Nan::ObjectWrap::Unwrap<Matrix>(im_h);
-  m->mat = self->mat.clone();
-
-  info.GetReturnValue().Set(im_h);
+  info.GetReturnValue().Set(NewInstance(self->mat.clone()));
 }
 
 NAN_METHOD(Matrix::Crop) {
@@ -562,97 +896,183 @@ NAN_METHOD(Matrix::Crop) {
 
     cv::Rect roi(x, y, width, height);
 
-    Local < Object > im_h =
-        Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-    Matrix *m = Nan::ObjectWrap::Unwrap<Matrix>(im_h);
-    m->mat = self->mat(roi);
+    Local<Object> out = NewInstance(self->mat(roi));
+    UNWRAP_OBJ(Matrix, out)->ShareBacking(self);
 
-    info.GetReturnValue().Set(im_h);
+    info.GetReturnValue().Set(out);
   } else {
     info.GetReturnValue().Set(Nan::New("Insufficient or wrong arguments").ToLocalChecked());
   }
 }
 
+// Copies `mat`, or only one of its channels, into a new typed array of the
+// matching element type.
+static Local<Object> NewTypedArray(const cv::Mat &mat, int channel = -1) {
+  int channels = channel < 0 ? mat.channels() : 1;
+  size_t count = mat.total() * channels;
+  Local<ArrayBuffer> buffer = ArrayBuffer::New(Isolate::GetCurrent(), count * mat.elemSize1());
+
+  cv::Mat dst(mat.size(), CV_MAKETYPE(mat.depth(), channels), buffer->GetContents().Data());
+  if (channel < 0) {
+    mat.copyTo(dst);
+  } else {
+    int fromTo[] = {channel, 0};
+    cv::mixChannels(&mat, 1, &dst, 1, fromTo, 1);
+  }
+
+  switch (mat.depth()) {
+    case CV_8S:
+      return Int8Array::New(buffer, 0, count);
+    case CV_16U:
+      return Uint16Array::New(buffer, 0, count);
+    case CV_16S:
+      return Int16Array::New(buffer, 0, count);
+    case CV_32S:
+      return Int32Array::New(buffer, 0, count);
+    case CV_32F:
+      return Float32Array::New(buffer, 0, count);
+    case CV_64F:
+      return Float64Array::New(buffer, 0, count);
+    default:
+      return Uint8Array::New(buffer, 0, count);
+  }
+}
+
+// Same, as a plain Array of numbers.
+static Local<Array> NewNumberArray(const cv::Mat &mat) {
+  MatAccessor access = MatAccessor::For(mat.type());
+  size_t rowLength = (size_t) mat.cols * mat.channels();
+  std::vector<double> values(mat.rows * rowLength);
+
+  for (int i = 0; i < mat.rows; i++) {
+    access.getRow(mat, i, 0, mat.cols, &values[i * rowLength]);
+  }
+
+  Local<Array> arr = Nan::New<Array>(values.size());
+  for (size_t i = 0; i < values.size(); i++) {
+    arr->Set(i, Nan::New<Number>(values[i]));
+  }
+  return arr;
+}
+
+// First channel of every element in row y.
 NAN_METHOD(Matrix::Row) {
   SETUP_FUNCTION(Matrix)
 
-  int width = self->mat.size().width;
   int y = info[0]->IntegerValue();
-  v8::Local < v8::Array > arr = Nan::New<Array>(width);
-
-  for (int x = 0; x < width; x++) {
-    double v = Matrix::DblGet(self->mat, y, x);
-    arr->Set(x, Nan::New<Number>(v));
+  if (y < 0 || y >= self->mat.rows) {
+    return Nan::ThrowRangeError("Row index out of range");
   }
 
-  info.GetReturnValue().Set(arr);
+  cv::Mat row = self->mat.row(y);
+  if (row.channels() > 1) {
+    cv::extractChannel(self->mat.row(y), row, 0);
+  }
+  info.GetReturnValue().Set(NewNumberArray(row));
 }
 
+// Every channel of row y, interleaved, whatever the depth.
 NAN_METHOD(Matrix::PixelRow) {
   SETUP_FUNCTION(Matrix)
 
-  int width = self->mat.size().width;
   int y = info[0]->IntegerValue();
-  v8::Local < v8::Array > arr;
-
-  if (self->mat.channels() == 3) {
-    arr = Nan::New<Array>(width * 3);
-    for (int x = 0; x < width; x++) {
-      cv::Vec3b pixel = self->mat.at<cv::Vec3b>(y, x);
-      int offset = x * 3;
-      arr->Set(offset, Nan::New<Number>((double) pixel.val[0]));
-      arr->Set(offset + 1, Nan::New<Number>((double) pixel.val[1]));
-      arr->Set(offset + 2, Nan::New<Number>((double) pixel.val[2]));
-    }
-  } else {
-    arr = Nan::New<Array>(width);
-    for (int x = 0; x < width; x++) {
-      int pixel = (int)self->mat.at<unsigned char>(y, x);
-      arr->Set(x, Nan::New<Number>(pixel));
-    }
+  if (y < 0 || y >= self->mat.rows) {
+    return Nan::ThrowRangeError("Row index out of range");
   }
 
-  info.GetReturnValue().Set(arr);
+  info.GetReturnValue().Set(NewNumberArray(self->mat.row(y)));
 }
 
 NAN_METHOD(Matrix::Col) {
   SETUP_FUNCTION(Matrix)
 
-  int height = self->mat.size().height;
   int x = info[0]->IntegerValue();
-  v8::Local < v8::Array > arr = Nan::New<Array>(height);
+  if (x < 0 || x >= self->mat.cols) {
+    return Nan::ThrowRangeError("Column index out of range");
+  }
 
-  for (int y = 0; y < height; y++) {
-    double v = Matrix::DblGet(self->mat, y, x);
-    arr->Set(y, Nan::New<Number>(v));
+  cv::Mat col = self->mat.col(x);
+  if (col.channels() > 1) {
+    cv::extractChannel(self->mat.col(x), col, 0);
   }
-  info.GetReturnValue().Set(arr);
+  info.GetReturnValue().Set(NewNumberArray(col));
 }
 
 NAN_METHOD(Matrix::PixelCol) {
   SETUP_FUNCTION(Matrix)
 
-  int height = self->mat.size().height;
   int x = info[0]->IntegerValue();
-  v8::Local < v8::Array > arr;
-
-  if (self->mat.channels() == 3) {
-    arr = Nan::New<Array>(height * 3);
-    for (int y = 0; y < height; y++) {
-      cv::Vec3b pixel = self->mat.at<cv::Vec3b>(y, x);
-      int offset = y * 3;
-      arr->Set(offset, Nan::New<Number>((double) pixel.val[0]));
-      arr->Set(offset + 1, Nan::New<Number>((double) pixel.val[1]));
-      arr->Set(offset + 2, Nan::New<Number>((double) pixel.val[2]));
-    }
-  } else {
-    arr = Nan::New<Array>(height);
-    for (int y = 0; y < height; y++) {
-      int pixel = (int)self->mat.at<unsigned char>(y, x);
-      arr->Set(y, Nan::New<Number>(pixel));
-    }
+  if (x < 0 || x >= self->mat.cols) {
+    return Nan::ThrowRangeError("Column index out of range");
   }
-  info.GetReturnValue().Set(arr);
+
+  info.GetReturnValue().Set(NewNumberArray(self->mat.col(x)));
+}
+
+// Typed array copies of part of the matrix. The array type follows the depth
+// (Uint8Array for CV_8U, Float32Array for CV_32F, ...) and channels are
+// interleaved, as in memory.
+// img.rowData(y); img.colData(x); img.regionData(rect); img.channelData(c);
+NAN_METHOD(Matrix::RowData) {
+  SETUP_FUNCTION(Matrix)
+
+  int y = info[0]->IntegerValue();
+  if (y < 0 || y >= self->mat.rows) {
+    return Nan::ThrowRangeError("Row index out of range");
+  }
+
+  info.GetReturnValue().Set(NewTypedArray(self->mat.row(y)));
+}
+
+NAN_METHOD(Matrix::ColData) {
+  SETUP_FUNCTION(Matrix)
+
+  int x = info[0]->IntegerValue();
+  if (x < 0 || x >= self->mat.cols) {
+    return Nan::ThrowRangeError("Column index out of range");
+  }
+
+  info.GetReturnValue().Set(NewTypedArray(self->mat.col(x)));
+}
+
+NAN_METHOD(Matrix::RegionData) {
+  SETUP_FUNCTION(Matrix)
+
+  if (info.Length() == 0) {
+    return Nan::ThrowError("Matrix.regionData requires at least 1 argument");
+  }
+
+  cv::Rect rect;
+  try {
+    SETUP_ARGC_AND_ARGV()
+
+    rect = Rect::RawRect(argc, argv);
+  } catch (const char* msg) {
+    return Nan::ThrowTypeError(msg);
+  }
+
+  if ((rect & cv::Rect(0, 0, self->mat.cols, self->mat.rows)) != rect) {
+    return Nan::ThrowRangeError("Region is outside the matrix");
+  }
+  if (!FitsInBuffer((size_t) rect.width * rect.height * self->mat.elemSize())) {
+    return Nan::ThrowRangeError(kTooLargeForBuffer);
+  }
+
+  info.GetReturnValue().Set(NewTypedArray(self->mat(rect)));
+}
+
+NAN_METHOD(Matrix::ChannelData) {
+  SETUP_FUNCTION(Matrix)
+
+  int channel = info[0]->IntegerValue();
+  if (channel < 0 || channel >= self->mat.channels()) {
+    return Nan::ThrowRangeError("Channel index out of range");
+  }
+  if (!FitsInBuffer(self->mat.total() * self->mat.elemSize1())) {
+    return Nan::ThrowRangeError(kTooLargeForBuffer);
+  }
+
+  info.GetReturnValue().Set(NewTypedArray(self->mat, channel));
 }
 
 NAN_METHOD(Matrix::Width) {
@@ -680,155 +1100,56 @@ NAN_METHOD(Matrix::ToBuffer) {
     return Matrix::ToBufferAsync(info);
   }
 
-  // SergeMv changes
   // img.toBuffer({ext: ".png", pngCompression: 9}); // default png compression is 3
   // img.toBuffer({ext: ".jpg", jpegQuality: 80});
   // img.toBuffer(); // creates Jpeg with quality of 95 (Opencv default quality)
   // via the ext you can do other image formats too (like tiff), see
   // http://docs.opencv.org/modules/highgui/doc/reading_and_writing_images_and_video.html#imencode
-  //---------------------------
-  // Provide default value
-  const char *ext = ".jpg";
-  std::string optExt;
-  std::vector<int> params;
-
-  // See if the options argument is passed
-  if ((info.Length() > 0) && (info[0]->IsObject())) {
-    // Get this options argument
-    v8::Handle < v8::Object > options = v8::Local<v8::Object>::Cast(info[0]);
-    // If the extension (image format) is provided
-    if (options->Has(Nan::New<String>("ext").ToLocalChecked())) {
-      v8::String::Utf8Value str(
-          options->Get(Nan::New<String>("ext").ToLocalChecked())->ToString());
-      optExt = *str;
-      ext = (const char *) optExt.c_str();
-    }
-    if (options->Has(Nan::New<String>("jpegQuality").ToLocalChecked())) {
-      int compression =
-          options->Get(Nan::New<String>("jpegQuality").ToLocalChecked())->IntegerValue();
-      params.push_back(CV_IMWRITE_JPEG_QUALITY);
-      params.push_back(compression);
-    }
-    if (options->Has(Nan::New<String>("pngCompression").ToLocalChecked())) {
-      int compression =
-          options->Get(Nan::New<String>("pngCompression").ToLocalChecked())->IntegerValue();
-      params.push_back(CV_IMWRITE_PNG_COMPRESSION);
-      params.push_back(compression);
+  // The bytes are handed to the Buffer without a copy.
+  Encoder encoder;
+  try {
+    if (info.Length() > 0 && info[0]->IsObject()) {
+      encoder.Parse(info[0]);
+    } else {
+      encoder.Parse(Nan::Undefined());
     }
+  } catch (const char *msg) {
+    return Nan::ThrowTypeError(msg);
   }
 
-  //---------------------------
-  std::vector<uchar> vec(0);
-
-  cv::imencode(ext, self->mat, vec, params);
-
-  Local < Object > buf = Nan::NewBuffer(vec.size()).ToLocalChecked();
-  uchar* data = (uchar*) Buffer::Data(buf);
-  memcpy(data, &vec[0], vec.size());
-
-  v8::Local < v8::Object > globalObj = Nan::GetCurrentContext()->Global();
-  v8::Local < v8::Function > bufferConstructor = v8::Local < v8::Function
-      > ::Cast(globalObj->Get(Nan::New<String>("Buffer").ToLocalChecked()));
-  v8::Local<v8::Value> constructorArgs[3] =
-      {buf, Nan::New<v8::Integer>((unsigned)vec.size()), Nan::New<v8::Integer>(0)};
-  v8::Local < v8::Object > actualBuffer = Nan::NewInstance(bufferConstructor, 3, constructorArgs).ToLocalChecked();
-
-  info.GetReturnValue().Set(actualBuffer);
-}
-
-class AsyncToBufferWorker: public Nan::AsyncWorker {
-public:
-  AsyncToBufferWorker(Nan::Callback *callback, Matrix* matrix, std::string ext,
-    std::vector<int> params) :
-      Nan::AsyncWorker(callback),
-      matrix(matrix),
-      ext(ext),
-      params(params) {
-  }
-
-  ~AsyncToBufferWorker() {
-  }
-
-  void Execute() {
-    std::vector<uchar> vec(0);
-    // std::vector<int> params(0);//CV_IMWRITE_JPEG_QUALITY 90
-    cv::imencode(ext, this->matrix->mat, vec, this->params);
-    res = vec;
-  }
-
-  void HandleOKCallback() {
-    Nan::HandleScope scope;
-
-    Local<Object> buf = Nan::NewBuffer(res.size()).ToLocalChecked();
-    uchar* data = (uchar*) Buffer::Data(buf);
-    memcpy(data, &res[0], res.size());
-
-    v8::Local<v8::Object> globalObj = Nan::GetCurrentContext()->Global();
-    v8::Local<v8::Function> bufferConstructor = v8::Local<v8::Function>::Cast(globalObj->Get(Nan::New<String>("Buffer").ToLocalChecked()));
-    v8::Local<v8::Value> constructorArgs[3] = {buf, Nan::New<v8::Integer>((unsigned)res.size()), Nan::New<v8::Integer>(0)};
-    v8::Local<v8::Object> actualBuffer = Nan::NewInstance(bufferConstructor, 3, constructorArgs).ToLocalChecked();;
-
-    Local<Value> argv[] = {
-      Nan::Null(),
-      actualBuffer
-    };
-
-    Nan::TryCatch try_catch;
-    callback->Call(Nan::GetCurrentContext()->Global(), 2, argv);
-    if (try_catch.HasCaught()) {
-      Nan::FatalException(try_catch);
-    }
-
+  std::vector<uchar> *bytes;
+  try {
+    bytes = encoder.Encode(self->mat);
+  } catch (cv::Exception &e) {
+    return Nan::ThrowError(e.what());
   }
 
-private:
-  Matrix* matrix;
-  std::string ext;
-  std::vector<int> params;
-  std::vector<uchar> res;
-};
+  info.GetReturnValue().Set(Encoder::NewBuffer(bytes));
+}
 
 NAN_METHOD(Matrix::ToBufferAsync) {
   SETUP_FUNCTION(Matrix)
 
   REQ_FUN_ARG(0, cb);
 
-  std::string ext = std::string(".jpg");
-  std::vector<int> params;
-
-  // See if the options argument is passed
+  Local<Value> argv[1] = { Nan::Undefined() };
   if ((info.Length() > 1) && (info[1]->IsObject())) {
-    // Get this options argument
-    v8::Handle < v8::Object > options = v8::Local<v8::Object>::Cast(info[1]);
-    // If the extension (image format) is provided
-    if (options->Has(Nan::New<String>("ext").ToLocalChecked())) {
-      v8::String::Utf8Value str(
-          options->Get(Nan::New<String>("ext").ToLocalChecked())->ToString());
-      std::string str2 = std::string(*str);
-      ext = str2;
-    }
-    if (options->Has(Nan::New<String>("jpegQuality").ToLocalChecked())) {
-      int compression =
-          options->Get(Nan::New<String>("jpegQuality").ToLocalChecked())->IntegerValue();
-      params.push_back(CV_IMWRITE_JPEG_QUALITY);
-      params.push_back(compression);
-    }
-    if (options->Has(Nan::New<String>("pngCompression").ToLocalChecked())) {
-      int compression =
-          options->Get(Nan::New<String>("pngCompression").ToLocalChecked())->IntegerValue();
-      params.push_back(CV_IMWRITE_PNG_COMPRESSION);
-      params.push_back(compression);
-    }
+    argv[0] = info[1];
   }
 
-  Nan::Callback *callback = new Nan::Callback(cb.As<Function>());
-  Nan::AsyncQueueWorker(new AsyncToBufferWorker(callback, self, ext, params));
+  Nan::TryCatch try_catch;
+  Nan::MaybeLocal<Object> encoder = Nan::NewInstance(
+      Nan::GetFunction(Nan::New(Encoder::constructor)).ToLocalChecked(), 1, argv);
+  if (encoder.IsEmpty()) {
+    return try_catch.ReThrow();
+  }
 
-  return;
+  Encoder::Queue(info, 0, encoder.ToLocalChecked(), info.This());
 }
 
 NAN_METHOD(Matrix::Ellipse) {
   SETUP_FUNCTION(Matrix)
+  self->MakeWritable();
 
   int x = 0;
   int y = 0;
@@ -900,6 +1221,7 @@ NAN_METHOD(Matrix::Ellipse) {
 
 NAN_METHOD(Matrix::Rectangle) {
   SETUP_FUNCTION(Matrix)
+  self->MakeWritable();
 
   if (info[0]->IsArray() && info[1]->IsArray()) {
     Local < Object > xy = info[0]->ToObject();
@@ -932,6 +1254,7 @@ NAN_METHOD(Matrix::Rectangle) {
 
 NAN_METHOD(Matrix::Line) {
   SETUP_FUNCTION(Matrix)
+  self->MakeWritable();
 
   if (info[0]->IsArray() && info[1]->IsArray()) {
     Local < Object > xy1 = info[0]->ToObject();
@@ -963,6 +1286,7 @@ NAN_METHOD(Matrix::Line) {
 
 NAN_METHOD(Matrix::FillPoly) {
   SETUP_FUNCTION(Matrix)
+  self->MakeWritable();
 
   if (info[0]->IsArray()) {
     Local < Array > polyArray = Local < Array > ::Cast(info[0]->ToObject());
@@ -1068,165 +1392,180 @@ NAN_METHOD(Matrix::SaveAsync) {
   REQ_FUN_ARG(1, cb);
 
   Nan::Callback *callback = new Nan::Callback(cb.As<Function>());
-  Nan::AsyncQueueWorker(new AsyncSaveWorker(callback, self, *filename));
+  WorkerPool::Queue(new AsyncSaveWorker(callback, self, *filename));
 
   return;
 }
 
-NAN_METHOD(Matrix::Zeros) {
-  Nan::HandleScope scope;
+class SaveRawWorker : public AsyncResultWorker {
+public:
+  SaveRawWorker(const cv::Mat &mat, const std::string &path): mat(mat), path(path) {}
 
-  int w = info[0]->Uint32Value();
-  int h = info[1]->Uint32Value();
-  int type = (info.Length() > 2) ? info[2]->IntegerValue() : CV_64FC1;
+  void Execute() override {
+    try {
+      MatrixFile::Write(path, mat);
+    } catch (std::exception &e) {
+      SetErrorMessage(e.what());
+    }
+  }
 
-  Local<Object> im_h = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(im_h);
-  cv::Mat mat = cv::Mat::zeros(w, h, type);
+protected:
+  Local<Value> Result() override {
+    return Nan::Undefined();
+  }
 
-  img->mat = mat;
-  info.GetReturnValue().Set(im_h);
-}
+private:
+  cv::Mat mat;
+  std::string path;
+};
 
-NAN_METHOD(Matrix::Ones) {
-  Nan::HandleScope scope;
+// Writes the matrix losslessly in the format described in MatrixFile.h.
+// Async when a callback is passed.
+// img.saveRaw('./depth.cvmat'[, function(err) {}]);
+NAN_METHOD(Matrix::SaveRaw) {
+  SETUP_FUNCTION(Matrix)
 
-  int w = info[0]->Uint32Value();
-  int h = info[1]->Uint32Value();
-  int type = (info.Length() > 2) ? info[2]->IntegerValue() : CV_64FC1;
+  if (info.Length() < 1 || !info[0]->IsString()) {
+    return Nan::ThrowTypeError("filename required");
+  }
 
-  Local<Object> im_h = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(im_h);
-  cv::Mat mat = cv::Mat::ones(w, h, type);
+  std::string path = *Nan::Utf8String(info[0]);
+
+  if (info.Length() > 1 && info[1]->IsFunction()) {
+    SaveRawWorker *worker = NewAsyncResultWorker<SaveRawWorker>(info, 1, self->mat, path);
+    worker->SaveToPersistent("matrix", info.This());
+    return WorkerPool::Queue(worker);
+  }
 
-  img->mat = mat;
-  info.GetReturnValue().Set(im_h);
+  try {
+    MatrixFile::Write(path, self->mat);
+  } catch (std::exception &e) {
+    return Nan::ThrowError(e.what());
+  }
 }
 
-NAN_METHOD(Matrix::Eye) {
+// Loads a file written by saveRaw. With mmap the pixels are paged in from the
+// file as they are touched rather than read up front, and roi() views only
+// touch the pages of their region. Writes to the matrix stay in memory unless
+// `shared` is set, then they go to the file.
+// cv.Matrix.loadRaw('./depth.cvmat'[, { mmap: true, shared: false }]);
+NAN_METHOD(Matrix::LoadRaw) {
   Nan::HandleScope scope;
 
-  int w = info[0]->Uint32Value();
-  int h = info[1]->Uint32Value();
-  int type = (info.Length() > 2) ? info[2]->IntegerValue() : CV_64FC1;
+  if (info.Length() < 1 || !info[0]->IsString()) {
+    return Nan::ThrowTypeError("filename required");
+  }
 
-  Local<Object> im_h = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(im_h);
-  cv::Mat mat = cv::Mat::eye(w, h, type);
+  std::string path = *Nan::Utf8String(info[0]);
 
-  img->mat = mat;
-  info.GetReturnValue().Set(im_h);
-}
+  bool map = false, shared = false;
+  if (info.Length() > 1 && info[1]->IsObject()) {
+    Local<Object> options = info[1]->ToObject();
+    map = options->Get(Nan::New<String>("mmap").ToLocalChecked())->BooleanValue();
+    shared = options->Get(Nan::New<String>("shared").ToLocalChecked())->BooleanValue();
+  }
 
-NAN_METHOD(Matrix::ConvertGrayscale) {
-  Nan::HandleScope scope;
+  if (shared && !map) {
+    return Nan::ThrowTypeError("shared requires mmap");
+  }
 
-  Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-  if (self->mat.channels() != 3) {
-    Nan::ThrowError("Image is no 3-channel");
+  if (!map || !MatrixFile::CanMap()) {
+    cv::Mat mat;
+    try {
+      mat = MatrixFile::Read(path);
+    } catch (std::exception &e) {
+      return Nan::ThrowError(e.what());
+    }
+    return info.GetReturnValue().Set(NewInstance(mat));
   }
 
-  cv::cvtColor(self->mat, self->mat, CV_BGR2GRAY);
+  // The mapping lasts as long as any Mat over it
+  cv::Mat mat;
+  try {
+    mat = MatrixFile::Map(path, shared);
+  } catch (std::exception &e) {
+    return Nan::ThrowError(e.what());
+  }
 
-  info.GetReturnValue().Set(Nan::Null());
+  info.GetReturnValue().Set(NewInstance(mat));
 }
 
-NAN_METHOD(Matrix::ConvertHSVscale) {
+// Creates a zero filled raw file and returns a Matrix mapped over it, for
+// results larger than memory. Writes go to the file; pages that are never
+// written take no disk space where the filesystem supports sparse files.
+// cv.Matrix.createRaw('./mosaic.cvmat', 40000, 40000, cv.Constants.CV_8UC3);
+NAN_METHOD(Matrix::CreateRaw) {
   Nan::HandleScope scope;
 
-  Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-  if (self->mat.channels() != 3) {
-    Nan::ThrowError("Image is no 3-channel");
+  if (info.Length() < 4 || !info[0]->IsString() || !info[1]->IsInt32() ||
+      !info[2]->IsInt32() || !info[3]->IsInt32()) {
+    return Nan::ThrowTypeError("Matrix.createRaw takes a filename, rows, cols and type");
   }
 
-  cv::Mat hsv;
+  if (!MatrixFile::CanMap()) {
+    return Nan::ThrowError("Mapping files needs mmap and OpenCV 3 or later");
+  }
 
-  cv::cvtColor(self->mat, hsv, CV_BGR2HSV);
-  hsv.copyTo(self->mat);
+  cv::Mat mat;
+  try {
+    mat = MatrixFile::Create(*Nan::Utf8String(info[0]), info[1]->Int32Value(),
+        info[2]->Int32Value(), info[3]->Int32Value());
+  } catch (std::exception &e) {
+    return Nan::ThrowError(e.what());
+  }
 
-  info.GetReturnValue().Set(Nan::Null());
+  info.GetReturnValue().Set(NewInstance(mat));
 }
 
-NAN_METHOD(Matrix::GaussianBlur) {
+NAN_METHOD(Matrix::Zeros) {
   Nan::HandleScope scope;
-  cv::Size ksize;
-  cv::Mat blurred;
 
-  Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-  double sigma = 0;
+  int w = info[0]->Uint32Value();
+  int h = info[1]->Uint32Value();
+  int type = (info.Length() > 2) ? info[2]->IntegerValue() : CV_64FC1;
 
-  if (info.Length() < 1) {
-    ksize = cv::Size(5, 5);
-  }
-  else {
-    if (!info[0]->IsArray()) {
-      Nan::ThrowTypeError("'ksize' argument must be a 2 double array");
-    }
-    Local<Object> array = info[0]->ToObject();
-    // TODO: Length check
-    Local<Value> x = array->Get(0);
-    Local<Value> y = array->Get(1);
-    if (!x->IsNumber() || !y->IsNumber()) {
-      Nan::ThrowTypeError("'ksize' argument must be a 2 double array");
-    }
-    ksize = cv::Size(x->NumberValue(), y->NumberValue());
-    if (info[1]->IsNumber()) {
-      sigma = Nan::To<double>(info[1]).FromJust();
-    }
-  }
+  cv::Mat mat = cv::Mat::zeros(w, h, type);
 
-  cv::GaussianBlur(self->mat, blurred, ksize, sigma);
-  blurred.copyTo(self->mat);
+  info.GetReturnValue().Set(NewInstance(mat));
+}
 
-  info.GetReturnValue().Set(Nan::Null());
+NAN_METHOD(Matrix::Ones) {
+  Nan::HandleScope scope;
+
+  int w = info[0]->Uint32Value();
+  int h = info[1]->Uint32Value();
+  int type = (info.Length() > 2) ? info[2]->IntegerValue() : CV_64FC1;
+
+  cv::Mat mat = cv::Mat::ones(w, h, type);
+
+  info.GetReturnValue().Set(NewInstance(mat));
 }
 
-NAN_METHOD(Matrix::MedianBlur) {
+NAN_METHOD(Matrix::Eye) {
   Nan::HandleScope scope;
-  cv::Mat blurred;
-  int ksize = 3;
-  Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
 
-  if (info[0]->IsNumber()) {
-    ksize = info[0]->IntegerValue();
-    if ((ksize % 2) == 0) {
-      Nan::ThrowTypeError("'ksize' argument must be a positive odd integer");
-    }
-  } else {
-    Nan::ThrowTypeError("'ksize' argument must be a positive odd integer");
-  }
+  int w = info[0]->Uint32Value();
+  int h = info[1]->Uint32Value();
+  int type = (info.Length() > 2) ? info[2]->IntegerValue() : CV_64FC1;
 
-  cv::medianBlur(self->mat, blurred, ksize);
-  blurred.copyTo(self->mat);
+  cv::Mat mat = cv::Mat::eye(w, h, type);
 
-  info.GetReturnValue().Set(Nan::Null());
+  info.GetReturnValue().Set(NewInstance(mat));
 }
 
-NAN_METHOD(Matrix::BilateralFilter) {
+NAN_METHOD(Matrix::ConvertHSVscale) {
   Nan::HandleScope scope;
-  cv::Mat filtered;
-  int d = 15;
-  double sigmaColor = 80;
-  double sigmaSpace = 80;
-  int borderType = cv::BORDER_DEFAULT;
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-
-  if (info.Length() != 0) {
-    if (info.Length() < 3 || info.Length() > 4) {
-      Nan::ThrowTypeError("BilateralFilter takes 0, 3, or 4 arguments");
-    } else {
-      d = info[0]->IntegerValue();
-      sigmaColor = info[1]->NumberValue();
-      sigmaSpace = info[2]->NumberValue();
-      if (info.Length() == 4) {
-        borderType = info[3]->IntegerValue();
-      }
-    }
+  if (self->mat.channels() != 3) {
+    Nan::ThrowError("Image is no 3-channel");
   }
 
-  cv::bilateralFilter(self->mat, filtered, d, sigmaColor, sigmaSpace, borderType);
-  filtered.copyTo(self->mat);
+  cv::Mat hsv;
+
+  cv::cvtColor(self->mat, hsv, CV_BGR2HSV);
+  self->MakeWritable();
+  hsv.copyTo(self->mat);
 
   info.GetReturnValue().Set(Nan::Null());
 }
@@ -1252,13 +1591,10 @@ NAN_METHOD(Matrix::Sobel) {
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
 
-  Local<Object> result_to_return =
-      Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *result = Nan::ObjectWrap::Unwrap<Matrix>(result_to_return);
-
-  cv::Sobel(self->mat, result->mat, ddepth, xorder, yorder, ksize, scale, delta, borderType);
+  cv::Mat result;
+  cv::Sobel(self->mat, result, ddepth, xorder, yorder, ksize, scale, delta, borderType);
 
-  info.GetReturnValue().Set(result_to_return);
+  info.GetReturnValue().Set(NewInstance(result));
 }
 
 NAN_METHOD(Matrix::Copy) {
@@ -1266,12 +1602,10 @@ NAN_METHOD(Matrix::Copy) {
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
 
-  Local<Object> img_to_return =
-      Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(img_to_return);
-  self->mat.copyTo(img->mat);
+  cv::Mat copy;
+  self->mat.copyTo(copy);
 
-  info.GetReturnValue().Set(img_to_return);
+  info.GetReturnValue().Set(NewInstance(copy));
 }
 
 NAN_METHOD(Matrix::Flip) {
@@ -1286,11 +1620,10 @@ NAN_METHOD(Matrix::Flip) {
 
   int flipCode = Nan::To<int>(info[0]).FromJust();
 
-  Local<Object> img_to_return = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(img_to_return);
-  cv::flip(self->mat, img->mat, flipCode);
+  cv::Mat flipped;
+  cv::flip(self->mat, flipped, flipCode);
 
-  info.GetReturnValue().Set(img_to_return);
+  info.GetReturnValue().Set(NewInstance(flipped));
 }
 
 NAN_METHOD(Matrix::ROI) {
@@ -1310,8 +1643,8 @@ NAN_METHOD(Matrix::ROI) {
   }
 
   // Although it's an image to return, it is in fact a pointer to ROI of parent matrix
-  Local<Object> out = NewInstance();
-  UNWRAP_OBJ(Matrix, out)->mat = self->mat(rect);
+  Local<Object> out = NewInstance(self->mat(rect));
+  UNWRAP_OBJ(Matrix, out)->ShareBacking(self);
 
   info.GetReturnValue().Set(out);
 }
@@ -1319,24 +1652,27 @@ NAN_METHOD(Matrix::ROI) {
 NAN_METHOD(Matrix::Ptr) {
   Nan::HandleScope scope;
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-  int line = info[0]->Uint32Value();
+  int64_t line = info[0]->IntegerValue();
 
-  char* data = self->mat.ptr<char>(line);
-  // uchar* data = self->mat.data;
+  if (line < 0 || line >= self->mat.rows) {
+    return Nan::ThrowRangeError("Row index out of range");
+  }
 
-  // char *mydata = "Random raw data\0";
-  Local<Object> return_buffer = Nan::NewBuffer((char*)data, self->mat.step).ToLocalChecked();
-  info.GetReturnValue().Set( return_buffer );
-//  return;
+  self->MakeWritable();
+  // The row is a view into the matrix, not memory the Buffer may free
+  cv::Mat row = self->mat.row(line);
+  info.GetReturnValue().Set(NewMatView(row, row.cols * row.elemSize(), self->Backing()));
 }
 
 NAN_METHOD(Matrix::AbsDiff) {
   Nan::HandleScope scope;
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
+  self->MakeWritable();
   Matrix *src1 = Nan::ObjectWrap::Unwrap<Matrix>(info[0]->ToObject());
   Matrix *src2 = Nan::ObjectWrap::Unwrap<Matrix>(info[1]->ToObject());
   cv::absdiff(src1->mat, src2->mat, self->mat);
+  self->UpdateExternalMemory();
 
   info.GetReturnValue().Set(Nan::Null());
 }
@@ -1348,13 +1684,10 @@ NAN_METHOD(Matrix::Dct) {
   int cols = self->mat.cols;
   int rows = self->mat.rows;
 
-  Local<Object> out = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *m_out = Nan::ObjectWrap::Unwrap<Matrix>(out);
-  m_out->mat.create(cols, rows, CV_32F);
-
-  cv::dct(self->mat, m_out->mat);
+  cv::Mat out(cols, rows, CV_32F);
+  cv::dct(self->mat, out);
 
-  info.GetReturnValue().Set(out);
+  info.GetReturnValue().Set(NewInstance(out));
 }
 
 NAN_METHOD(Matrix::Idct) {
@@ -1364,19 +1697,17 @@ NAN_METHOD(Matrix::Idct) {
   int cols = self->mat.cols;
   int rows = self->mat.rows;
 
-  Local<Object> out = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *m_out = Nan::ObjectWrap::Unwrap<Matrix>(out);
-  m_out->mat.create(cols, rows, CV_32F);
-
-  cv::idct(self->mat, m_out->mat);
+  cv::Mat out(cols, rows, CV_32F);
+  cv::idct(self->mat, out);
 
-  info.GetReturnValue().Set(out);
+  info.GetReturnValue().Set(NewInstance(out));
 }
 
 NAN_METHOD(Matrix::AddWeighted) {
   Nan::HandleScope scope;
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
+  self->MakeWritable();
   Matrix *src1 = Nan::ObjectWrap::Unwrap<Matrix>(info[0]->ToObject());
   Matrix *src2 = Nan::ObjectWrap::Unwrap<Matrix>(info[2]->ToObject());
 
@@ -1386,6 +1717,7 @@ NAN_METHOD(Matrix::AddWeighted) {
 
   try {
     cv::addWeighted(src1->mat, alpha, src2->mat, beta, gamma, self->mat);
+    self->UpdateExternalMemory();
   } catch(cv::Exception& e ) {
     const char* err_msg = e.what();
     Nan::ThrowError(err_msg);
@@ -1403,12 +1735,13 @@ NAN_METHOD(Matrix::Add) {
 
   Matrix *src1 = Nan::ObjectWrap::Unwrap<Matrix>(info[0]->ToObject());
 
-  Local<Object> out = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
+  Local<Object> out = NewInstance();
   Matrix *m_out = Nan::ObjectWrap::Unwrap<Matrix>(out);
   m_out->mat.create(cols, rows, self->mat.type());
 
   try {
     cv::add(self->mat, src1->mat, m_out->mat);
+    m_out->UpdateExternalMemory();
   } catch(cv::Exception& e ) {
     const char* err_msg = e.what();
     Nan::ThrowError(err_msg);
@@ -1421,6 +1754,7 @@ NAN_METHOD(Matrix::BitwiseXor) {
   Nan::HandleScope scope;
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
+  self->MakeWritable();
   Matrix *src1 = Nan::ObjectWrap::Unwrap<Matrix>(info[0]->ToObject());
   Matrix *src2 = Nan::ObjectWrap::Unwrap<Matrix>(info[1]->ToObject());
 
@@ -1430,6 +1764,7 @@ NAN_METHOD(Matrix::BitwiseXor) {
   } else {
     cv::bitwise_xor(src1->mat, src2->mat, self->mat);
   }
+  self->UpdateExternalMemory();
 
   info.GetReturnValue().Set(Nan::Null());
 }
@@ -1439,12 +1774,14 @@ NAN_METHOD(Matrix::BitwiseNot) {
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
   Matrix *dst = Nan::ObjectWrap::Unwrap<Matrix>(info[0]->ToObject());
+  dst->MakeWritable();
   if (info.Length() == 2) {
     Matrix *mask = Nan::ObjectWrap::Unwrap<Matrix>(info[1]->ToObject());
     cv::bitwise_not(self->mat, dst->mat, mask->mat);
   } else {
     cv::bitwise_not(self->mat, dst->mat);
   }
+  dst->UpdateExternalMemory();
 
   info.GetReturnValue().Set(Nan::Null());
 }
@@ -1453,6 +1790,7 @@ NAN_METHOD(Matrix::BitwiseAnd) {
   Nan::HandleScope scope;
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
+  self->MakeWritable();
   Matrix *src1 = Nan::ObjectWrap::Unwrap<Matrix>(info[0]->ToObject());
   Matrix *src2 = Nan::ObjectWrap::Unwrap<Matrix>(info[1]->ToObject());
   if (info.Length() == 3) {
@@ -1461,6 +1799,7 @@ NAN_METHOD(Matrix::BitwiseAnd) {
   } else {
     cv::bitwise_and(src1->mat, src2->mat, self->mat);
   }
+  self->UpdateExternalMemory();
 
   info.GetReturnValue().Set(Nan::Null());
 }
@@ -1522,79 +1861,11 @@ NAN_METHOD(Matrix::Moments) {
   info.GetReturnValue().Set(res);
 }
 
-NAN_METHOD(Matrix::Canny) {
-  Nan::HandleScope scope;
-
-  Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-  int lowThresh = info[0]->NumberValue();
-  int highThresh = info[1]->NumberValue();
-
-  cv::Canny(self->mat, self->mat, lowThresh, highThresh);
-
-  info.GetReturnValue().Set(Nan::Null());
-}
-
-NAN_METHOD(Matrix::Dilate) {
-  Nan::HandleScope scope;
-
-  Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-  int niters = info[0]->NumberValue();
-
-  cv::Mat kernel = cv::Mat();
-  if (info.Length() == 2) {
-    Matrix *kernelMatrix = Nan::ObjectWrap::Unwrap<Matrix>(info[1]->ToObject());
-    kernel = kernelMatrix->mat;
-  }
-
-  cv::dilate(self->mat, self->mat, kernel, cv::Point(-1, -1), niters);
-
-  info.GetReturnValue().Set(Nan::Null());
-}
-
-NAN_METHOD(Matrix::Erode) {
-  Nan::HandleScope scope;
-
-  Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-  int niters = info[0]->NumberValue();
-
-  cv::Mat kernel = cv::Mat();
-  if (info.Length() == 2) {
-    Matrix *kernelMatrix = Nan::ObjectWrap::Unwrap<Matrix>(info[1]->ToObject());
-    kernel = kernelMatrix->mat;
-  }
-  cv::erode(self->mat, self->mat, kernel, cv::Point(-1, -1), niters);
-
-  info.GetReturnValue().Set(Nan::Null());
-}
-
-NAN_METHOD(Matrix::FindContours) {
-  Nan::HandleScope scope;
-
-  int mode = CV_RETR_LIST;
-  int chain = CV_CHAIN_APPROX_SIMPLE;
-
-  if (info.Length() > 0) {
-    if (info[0]->IsNumber()) mode = info[0]->IntegerValue();
-  }
-
-  if (info.Length() > 1) {
-    if (info[1]->IsNumber()) chain = info[1]->IntegerValue();
-  }
-
-  Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-  Local<Object> conts_to_return = Nan::NewInstance(Nan::GetFunction(Nan::New(Contour::constructor)).ToLocalChecked()).ToLocalChecked();
-  Contour *contours = Nan::ObjectWrap::Unwrap<Contour>(conts_to_return);
-
-  cv::findContours(self->mat, contours->contours, contours->hierarchy, mode, chain);
-
-  info.GetReturnValue().Set(conts_to_return);
-
-}
-
 NAN_METHOD(Matrix::DrawContour) {
   Nan::HandleScope scope;
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
+  self->MakeWritable();
   Contour *cont = Nan::ObjectWrap::Unwrap<Contour>(info[0]->ToObject());
   int pos = info[1]->NumberValue();
   cv::Scalar color(0, 0, 255);
@@ -1626,6 +1897,7 @@ NAN_METHOD(Matrix::DrawAllContours) {
   Nan::HandleScope scope;
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
+  self->MakeWritable();
   Contour *cont = Nan::ObjectWrap::Unwrap<Contour>(info[0]->ToObject());
   cv::Scalar color(0, 0, 255);
 
@@ -1745,70 +2017,6 @@ NAN_METHOD(Matrix::CalcOpticalFlowPyrLK) {
   info.GetReturnValue().Set(data);
 }
 
-NAN_METHOD(Matrix::HoughLinesP) {
-  Nan::HandleScope scope;
-
-  Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-  double rho = info.Length() < 1 ? 1 : info[0]->NumberValue();
-  double theta = info.Length() < 2 ? CV_PI/180 : info[1]->NumberValue();
-  int threshold = info.Length() < 3 ? 80 : info[2]->Uint32Value();
-  double minLineLength = info.Length() < 4 ? 30 : info[3]->NumberValue();
-  double maxLineGap = info.Length() < 5 ? 10 : info[4]->NumberValue();
-  std::vector<cv::Vec4i> lines;
-
-  cv::Mat gray;
-
-  equalizeHist(self->mat, gray);
-  // cv::Canny(gray, gray, 50, 200, 3);
-  cv::HoughLinesP(gray, lines, rho, theta, threshold, minLineLength, maxLineGap);
-
-  v8::Local<v8::Array> arr = Nan::New<Array>(lines.size());
-
-  for (unsigned int i=0; i<lines.size(); i++) {
-    v8::Local<v8::Array> pt = Nan::New<Array>(4);
-    pt->Set(0, Nan::New<Number>((double) lines[i][0]));
-    pt->Set(1, Nan::New<Number>((double) lines[i][1]));
-    pt->Set(2, Nan::New<Number>((double) lines[i][2]));
-    pt->Set(3, Nan::New<Number>((double) lines[i][3]));
-    arr->Set(i, pt);
-  }
-
-  info.GetReturnValue().Set(arr);
-}
-
-NAN_METHOD(Matrix::HoughCircles) {
-  Nan::HandleScope scope;
-
-  Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-
-  double dp = info.Length() < 1 ? 1 : info[0]->NumberValue();
-  double minDist = info.Length() < 2 ? 1 : info[1]->NumberValue();
-  double higherThreshold = info.Length() < 3 ? 100 : info[2]->NumberValue();
-  double accumulatorThreshold = info.Length() < 4 ? 100 : info[3]->NumberValue();
-  int minRadius = info.Length() < 5 ? 0 : info[4]->Uint32Value();
-  int maxRadius = info.Length() < 6 ? 0 : info[5]->Uint32Value();
-  std::vector<cv::Vec3f> circles;
-
-  cv::Mat gray;
-
-  equalizeHist(self->mat, gray);
-
-  cv::HoughCircles(gray, circles, CV_HOUGH_GRADIENT, dp, minDist,
-      higherThreshold, accumulatorThreshold, minRadius, maxRadius);
-
-  v8::Local<v8::Array> arr = Nan::New<Array>(circles.size());
-
-  for (unsigned int i=0; i < circles.size(); i++) {
-    v8::Local<v8::Array> pt = Nan::New<Array>(3);
-    pt->Set(0, Nan::New<Number>((double) circles[i][0]));  // center x
-    pt->Set(1, Nan::New<Number>((double) circles[i][1]));// center y
-    pt->Set(2, Nan::New<Number>((double) circles[i][2]));// radius
-    arr->Set(i, pt);
-  }
-
-  info.GetReturnValue().Set(arr);
-}
-
 cv::Scalar setColor(Local<Object> objColor) {
   int64_t channels[4] = { 0, 0, 0, 0 };
 
@@ -1856,39 +2064,6 @@ cv::Rect* setRect(Local<Object> objRect, cv::Rect &result) {
   return &result;
 }
 
-NAN_METHOD(Matrix::Resize) {
-  SETUP_FUNCTION(Matrix)
-
-  if (info.Length() == 0) {
-    return Nan::ThrowError("Matrix.resize requires at least 1 argument");
-  }
-
-  cv::Size size;
-  try {
-    size = Size::RawSize(1, new Local<Value>[1] { info[0] });
-  } catch(const char* msg) {
-    return Nan::ThrowTypeError(msg);
-  }
-
-  if (size.area() == 0) {
-    return Nan::ThrowError("Area of size must be > 0");
-  }
-
-  double fx = 0;
-  double fy = 0;
-  int interpolation = cv::INTER_LINEAR;
-
-  DOUBLE_FROM_ARGS(fx, 1)
-  DOUBLE_FROM_ARGS(fy, 2)
-  INT_FROM_ARGS(interpolation, 3)
-
-  Local<Object> res = NewInstance();
-
-  cv::resize(self->mat, Nan::ObjectWrap::Unwrap<Matrix>(res)->mat, size, fx, fy, interpolation);
-
-  info.GetReturnValue().Set(res);
-}
-
 NAN_METHOD(Matrix::Rotate) {
   Nan::HandleScope scope;
 
@@ -1920,7 +2095,9 @@ NAN_METHOD(Matrix::Rotate) {
     if (angle2 == 90) {mode = 0;}
     // If clockwise, flip around the y-axis
     if (angle2 == 270) {mode = 1;}
+    self->MakeWritable();
     cv::flip(self->mat, self->mat, mode);
+    self->UpdateExternalMemory();
     return;
   }
 
@@ -1936,6 +2113,7 @@ NAN_METHOD(Matrix::Rotate) {
   cv::warpAffine(self->mat, res, rotMatrix, self->mat.size());
   ~self->mat;
   self->mat = res;
+  self->UpdateExternalMemory();
 
   return;
 }
@@ -1951,73 +2129,9 @@ NAN_METHOD(Matrix::GetRotationMatrix2D) {
   int y = Nan::To<uint32_t>(info[2]).FromJust();
   double scale = Nan::To<double>(info[3]).FromMaybe(1.0);
 
-  Local<Object> img_to_return =
-      Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(img_to_return);
-
   cv::Point center = cv::Point(x,y);
-  img->mat = getRotationMatrix2D(center, angle, scale);
-
-  info.GetReturnValue().Set(img_to_return);
-}
-
-NAN_METHOD(Matrix::WarpAffine) {
-  Nan::HandleScope scope;
-
-  Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-  cv::Mat res;
-
-  Matrix *rotMatrix = Nan::ObjectWrap::Unwrap<Matrix>(info[0]->ToObject());
-
-  // Resize the image if size is specified
-  int dstRows = info[1]->IsUndefined() ? self->mat.rows : info[1]->Uint32Value();
-  int dstCols = info[2]->IsUndefined() ? self->mat.cols : info[2]->Uint32Value();
-  cv::Size resSize = cv::Size(dstRows, dstCols);
-
-  cv::warpAffine(self->mat, res, rotMatrix->mat, resSize);
-  ~self->mat;
-  self->mat = res;
-
-  return;
-}
 
-NAN_METHOD(Matrix::PyrDown) {
-  SETUP_FUNCTION(Matrix)
-
-  cv::pyrDown(self->mat, self->mat);
-  return;
-}
-
-NAN_METHOD(Matrix::PyrUp) {
-  SETUP_FUNCTION(Matrix)
-
-  cv::pyrUp(self->mat, self->mat);
-  return;
-}
-
-NAN_METHOD(Matrix::inRange) {
-  Nan::HandleScope scope;
-
-  Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-  /*if (self->mat.channels() != 3)
-   Nan::ThrowError(String::New("Image is no 3-channel"));*/
-
-  if (info[0]->IsArray() && info[1]->IsArray()) {
-    Local<Object> args_lowerb = info[0]->ToObject();
-    Local<Object> args_upperb = info[1]->ToObject();
-
-    cv::Scalar lowerb(0, 0, 0);
-    cv::Scalar upperb(0, 0, 0);
-
-    lowerb = setColor(args_lowerb);
-    upperb = setColor(args_upperb);
-
-    cv::Mat mask;
-    cv::inRange(self->mat, lowerb, upperb, mask);
-    mask.copyTo(self->mat);
-  }
-
-  info.GetReturnValue().Set(Nan::Null());
+  info.GetReturnValue().Set(NewInstance(getRotationMatrix2D(center, angle, scale)));
 }
 
 NAN_METHOD(Matrix::AdjustROI) {
@@ -2049,117 +2163,17 @@ NAN_METHOD(Matrix::LocateROI) {
   info.GetReturnValue().Set(arr);
 }
 
-NAN_METHOD(Matrix::Threshold) {
-  SETUP_FUNCTION(Matrix)
-
-  double threshold = info[0]->NumberValue();
-  double maxVal = info[1]->NumberValue();
-  int typ = cv::THRESH_BINARY;
-
-  if (info.Length() >= 3) {
-    Nan::Utf8String typstr(info[2]);
-
-    if (strcmp(*typstr, "Binary") == 0) {
-      // Uses default value
-    }
-    else if (strcmp(*typstr, "Binary Inverted") == 0) {
-      typ = cv::THRESH_BINARY_INV;
-    }
-    else if (strcmp(*typstr, "Threshold Truncated") == 0) {
-      typ = cv::THRESH_TRUNC;
-    }
-    else if (strcmp(*typstr, "Threshold to Zero") == 0) {
-      typ = cv::THRESH_TOZERO;
-    }
-    else if (strcmp(*typstr, "Threshold to Zero Inverted") == 0) {
-      typ = cv::THRESH_TOZERO_INV;
-    }
-    else {
-      char *typeString = *typstr;
-      char text[] = "\" is no supported binarization technique. "
-        "Use \"Binary\" (default), \"Binary Inverted\", "
-        "\"Threshold Truncated\", \"Threshold to Zero\" "
-        "or \"Threshold to Zero Inverted\"";
-      char *errorMessage;
-      errorMessage = new char[strlen(typeString) + strlen(text) + 2];
-      strcpy(errorMessage, "\"");
-      strcat(errorMessage, typeString);
-      strcat(errorMessage, text);
-
-      Nan::ThrowError(errorMessage);
-      return;
-    }
-  }
-
-  if (info.Length() >= 4) {
-    Nan::Utf8String algorithm(info[3]);
-
-    if (strcmp(*algorithm, "Simple") == 0) {
-        // Uses default
-    }
-    else if (strcmp(*algorithm, "Otsu") == 0) {
-      typ += 8;
-    }
-    else {
-      char *algo = *algorithm;
-      char text[] = "\" is no supported threshold algorithm. "
-        "Use \"Simple\" (default) or \"Otsu\".";
-      char *errorMessage;
-      errorMessage = new char[strlen(algo) + strlen(text) + 2];
-      strcpy(errorMessage, "\"");
-      strcat(errorMessage, algo);
-      strcat(errorMessage, text);
-
-      Nan::ThrowError(errorMessage);
-      return;
-    }
-  }
-
-  Local < Object > img_to_return =
-      Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(img_to_return);
-  self->mat.copyTo(img->mat);
-
-  cv::threshold(self->mat, img->mat, threshold, maxVal, typ);
-
-  info.GetReturnValue().Set(img_to_return);
-}
-
-NAN_METHOD(Matrix::AdaptiveThreshold) {
-  SETUP_FUNCTION(Matrix)
-
-  double maxVal = info[0]->NumberValue();
-  double adaptiveMethod = info[1]->NumberValue();
-  double thresholdType = info[2]->NumberValue();
-  double blockSize = info[3]->NumberValue();
-  double C = info[4]->NumberValue();
-
-  Local < Object > img_to_return =
-      Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(img_to_return);
-  self->mat.copyTo(img->mat);
-
-  cv::adaptiveThreshold(self->mat, img->mat, maxVal, adaptiveMethod,
-      thresholdType, blockSize, C);
-
-  info.GetReturnValue().Set(img_to_return);
-}
-
 NAN_METHOD(Matrix::MeanStdDev) {
   Nan::HandleScope scope;
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
 
-  Local<Object> mean = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *m_mean = Nan::ObjectWrap::Unwrap<Matrix>(mean);
-  Local<Object> stddev = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *m_stddev = Nan::ObjectWrap::Unwrap<Matrix>(stddev);
-
-  cv::meanStdDev(self->mat, m_mean->mat, m_stddev->mat);
+  cv::Mat mean, stddev;
+  cv::meanStdDev(self->mat, mean, stddev);
 
   Local<Object> data = Nan::New<Object>();
-  data->Set(Nan::New<String>("mean").ToLocalChecked(), mean);
-  data->Set(Nan::New<String>("stddev").ToLocalChecked(), stddev);
+  data->Set(Nan::New<String>("mean").ToLocalChecked(), NewInstance(mean));
+  data->Set(Nan::New<String>("stddev").ToLocalChecked(), NewInstance(stddev));
 
   info.GetReturnValue().Set(data);
 }
@@ -2187,6 +2201,7 @@ NAN_METHOD(Matrix::CopyTo) {
   // param 2 - y coord of the destination
   int y = info[2]->IntegerValue();
 
+  dest->MakeWritable();
   cv::Mat dstROI = cv::Mat(dest->mat, cv::Rect(x, y, width, height));
   self->mat.copyTo(dstROI);
 
@@ -2223,72 +2238,9 @@ NAN_METHOD(Matrix::ConvertTo) {
     DOUBLE_FROM_ARGS(beta, 3);
   }
 
+  dest->MakeWritable();
   self->mat.convertTo(dest->mat, rtype, alpha, beta);
-
-  return;
-}
-
-// @author SergeMv
-// Does in-place color transformation
-// img.cvtColor('CV_BGR2YCrCb');
-NAN_METHOD(Matrix::CvtColor) {
-  Nan::HandleScope scope;
-
-  Matrix * self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-  if (info.Length() < 1) {
-    Nan::ThrowTypeError("Invalid number of arguments");
-  }
-
-  // Get transform string
-  v8::String::Utf8Value str (info[0]->ToString());
-  std::string str2 = std::string(*str);
-  const char * sTransform = (const char *) str2.c_str();
-  int iTransform;
-
-  if (!strcmp(sTransform, "CV_BGR2GRAY")) {
-    iTransform = CV_BGR2GRAY;
-  } else if (!strcmp(sTransform, "CV_GRAY2BGR")) {
-    iTransform = CV_GRAY2BGR;
-  } else if (!strcmp(sTransform, "CV_BGR2XYZ")) {
-    iTransform = CV_BGR2XYZ;
-  } else if (!strcmp(sTransform, "CV_XYZ2BGR")) {
-    iTransform = CV_XYZ2BGR;
-  } else if (!strcmp(sTransform, "CV_BGR2YCrCb")) {
-    iTransform = CV_BGR2YCrCb;
-  } else if (!strcmp(sTransform, "CV_YCrCb2BGR")) {
-    iTransform = CV_YCrCb2BGR;
-  } else if (!strcmp(sTransform, "CV_BGR2HSV")) {
-    iTransform = CV_BGR2HSV;
-  } else if (!strcmp(sTransform, "CV_HSV2BGR")) {
-    iTransform = CV_HSV2BGR;
-  } else if (!strcmp(sTransform, "CV_BGR2HLS")) {
-    iTransform = CV_BGR2HLS;
-  } else if (!strcmp(sTransform, "CV_HLS2BGR")) {
-    iTransform = CV_HLS2BGR;
-  } else if (!strcmp(sTransform, "CV_BGR2Lab")) {
-    iTransform = CV_BGR2Lab;
-  } else if (!strcmp(sTransform, "CV_Lab2BGR")) {
-    iTransform = CV_Lab2BGR;
-  } else if (!strcmp(sTransform, "CV_BGR2Luv")) {
-    iTransform = CV_BGR2Luv;
-  } else if (!strcmp(sTransform, "CV_Luv2BGR")) {
-    iTransform = CV_Luv2BGR;
-  } else if (!strcmp(sTransform, "CV_BayerBG2BGR")) {
-    iTransform = CV_BayerBG2BGR;
-  } else if (!strcmp(sTransform, "CV_BayerGB2BGR")) {
-    iTransform = CV_BayerGB2BGR;
-  } else if (!strcmp(sTransform, "CV_BayerRG2BGR")) {
-    iTransform = CV_BayerRG2BGR;
-  } else if (!strcmp(sTransform, "CV_BayerGR2BGR")) {
-    iTransform = CV_BayerGR2BGR;
-  } else if (!strcmp(sTransform, "CV_BGR2RGB")) {
-    iTransform = CV_BGR2RGB;
-  } else {
-    iTransform = 0;  // to avoid compiler warning
-    Nan::ThrowTypeError("Conversion code is unsupported");
-  }
-
-  cv::cvtColor(self->mat, self->mat, iTransform);
+  dest->UpdateExternalMemory();
 
   return;
 }
@@ -2312,11 +2264,7 @@ NAN_METHOD(Matrix::Split) {
   size = channels.size();
   v8::Local<v8::Array> arrChannels = Nan::New<Array>(size);
   for (unsigned int i = 0; i < size; i++) {
-    Local<Object> matObject =
-        Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-    Matrix * m = Nan::ObjectWrap::Unwrap<Matrix>(matObject);
-    m->mat = channels[i];
-    arrChannels->Set(i, matObject);
+    arrChannels->Set(i, NewInstance(channels[i]));
   }
 
   info.GetReturnValue().Set(arrChannels);
@@ -2328,6 +2276,7 @@ NAN_METHOD(Matrix::Merge) {
   Nan::HandleScope scope;
 
   Matrix * self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
+  self->MakeWritable();
   if (!info[0]->IsArray()) {
     Nan::ThrowTypeError("The argument must be an array");
   }
@@ -2340,52 +2289,11 @@ NAN_METHOD(Matrix::Merge) {
     vChannels[i] = matObject->mat;
   }
   cv::merge(vChannels, self->mat);
+  self->UpdateExternalMemory();
 
   return;
 }
 
-// @author SergeMv
-// Equalizes histogram
-// img.equalizeHist()
-NAN_METHOD(Matrix::EqualizeHist) {
-  Nan::HandleScope scope;
-  Matrix * self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
-
-  cv::equalizeHist(self->mat, self->mat);
-
-  return;
-}
-
-NAN_METHOD(Matrix::FloodFill) {
-  SETUP_FUNCTION(Matrix)
-  // obj->Get(Nan::New<String>("x").ToLocalChecked())
-  // int cv::floodFill(cv::InputOutputArray, cv::Point, cv::Scalar, cv::Rect*, cv::Scalar, cv::Scalar, int)
-
-  /*  mat.floodFill( {seedPoint: [1,1] ,
-        newColor: [255,0,0] ,
-        rect:[[0,2],[30,40]] ,
-        loDiff : [8,90,60],
-        upDiff:[10,100,70]
-      }); */
-
-  if (info.Length() < 1 || !info[0]->IsObject()) {
-    // error
-  }
-
-  Local < Object > obj = info[0]->ToObject();
-  cv::Rect rect;
-
-  int ret = cv::floodFill(self->mat,
-      setPoint(obj->Get(Nan::New<String>("seedPoint").ToLocalChecked())->ToObject()),
-      setColor(obj->Get(Nan::New<String>("newColor").ToLocalChecked())->ToObject()),
-      obj->Get(Nan::New<String>("rect").ToLocalChecked())->IsUndefined() ?
-          0 : setRect(obj->Get(Nan::New<String>("rect").ToLocalChecked())->ToObject(), rect),
-      setColor(obj->Get(Nan::New<String>("loDiff").ToLocalChecked())->ToObject()),
-      setColor(obj->Get(Nan::New<String>("upDiff").ToLocalChecked())->ToObject()), 4);
-
-  info.GetReturnValue().Set(Nan::New<Number>(ret));
-}
-
 // @author olfox
 // Returns an array of the most probable positions
 // Usage: output = input.templateMatches(min_probability, max_probability, limit, ascending, min_x_distance, min_y_distance);
@@ -2484,46 +2392,6 @@ NAN_METHOD(Matrix::TemplateMatches) {
   info.GetReturnValue().Set(probabilites_array);
 }
 
-// MatchTemplate accept a Matrix
-// Usage: output = input.matchTemplate(matrix, method);
-NAN_METHOD(Matrix::MatchTemplate) {
-  SETUP_FUNCTION(Matrix)
-
-  if (info.Length() < 2) {
-    return Nan::ThrowError("Matrix.matchTemplate requires at least 2 arguments");
-  }
-
-  if (!HasInstance(info[0])) {
-    return Nan::ThrowTypeError("Argument 1 must be a Matrix");
-  }
-
-  if (!info[1]->IsInt32()) {
-    return Nan::ThrowTypeError("Argument 2 must be a number");
-  }
-
-  Matrix *templ = UNWRAP_ARG(Matrix, 0);
-  int method = info[1]->Int32Value();
-
-  Local<Object> out = NewInstance();
-  Matrix *m_out = Nan::ObjectWrap::Unwrap<Matrix>(out);
-  m_out->mat.create(self->mat.cols - templ->mat.cols + 1, self->mat.rows - templ->mat.rows + 1, CV_32FC1);
-
-#if CV_MAJOR_VERSION < 3
-  cv::matchTemplate(self->mat, templ->mat, m_out->mat, method);
-#else
-  Matrix *mask = nullptr;
-  MATRIX_FROM_ARGS(mask, 2)
-
-  if (mask == nullptr) {
-    cv::matchTemplate(self->mat, templ->mat, m_out->mat, method);
-  } else {
-    cv::matchTemplate(self->mat, templ->mat, m_out->mat, method, mask->mat);
-  }
-#endif
-
-  info.GetReturnValue().Set(out);
-}
-
 // @author ytham
 // Min/Max location
 NAN_METHOD(Matrix::MinMaxLoc) {
@@ -2549,8 +2417,10 @@ NAN_METHOD(Matrix::PushBack) {
   Nan::HandleScope scope;
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
+  self->MakeWritable();
   Matrix *m_input = Nan::ObjectWrap::Unwrap<Matrix>(info[0]->ToObject());
   self->mat.push_back(m_input->mat);
+  self->UpdateExternalMemory();
 
   info.GetReturnValue().Set(info.This());
 }
@@ -2559,6 +2429,7 @@ NAN_METHOD(Matrix::PutText) {
   Nan::HandleScope scope;
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
+  self->MakeWritable();
   Nan::Utf8String textString(info[0]);  //FIXME: might cause issues, see here https://github.com/rvagg/nan/pull/152
   char *text = *textString;//(char *) malloc(textString.length() + 1);
   //strcpy(text, *textString);
@@ -2610,40 +2481,7 @@ NAN_METHOD(Matrix::GetPerspectiveTransform) {
     tgt_corners[i] = cvPoint(tgtArray->Get(i*2)->IntegerValue(),tgtArray->Get(i*2+1)->IntegerValue());
   }
 
-  Local<Object> xfrm = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *xfrmmat = Nan::ObjectWrap::Unwrap<Matrix>(xfrm);
-  xfrmmat->mat = cv::getPerspectiveTransform(src_corners, tgt_corners);
-
-  info.GetReturnValue().Set(xfrm);
-}
-
-NAN_METHOD(Matrix::WarpPerspective) {
-  SETUP_FUNCTION(Matrix)
-
-  Matrix *xfrm = Nan::ObjectWrap::Unwrap<Matrix>(info[0]->ToObject());
-
-  int width = info[1]->IntegerValue();
-  int height = info[2]->IntegerValue();
-
-  int flags = cv::INTER_LINEAR;
-  int borderMode = cv::BORDER_REPLICATE;
-
-  cv::Scalar borderColor(0, 0, 255);
-
-  if (info[3]->IsArray()) {
-    Local < Object > objColor = info[3]->ToObject();
-    borderColor = setColor(objColor);
-  }
-
-  cv::Mat res = cv::Mat(width, height, CV_32FC3);
-
-  cv::warpPerspective(self->mat, res, xfrm->mat, cv::Size(width, height), flags,
-      borderMode, borderColor);
-
-  ~self->mat;
-  self->mat = res;
-
-  info.GetReturnValue().Set(Nan::Null());
+  info.GetReturnValue().Set(NewInstance(cv::getPerspectiveTransform(src_corners, tgt_corners)));
 }
 
 NAN_METHOD(Matrix::CopyWithMask) {
@@ -2654,7 +2492,9 @@ NAN_METHOD(Matrix::CopyWithMask) {
   // param 1 - mask. same size as src and dest
   Matrix *mask = Nan::ObjectWrap::Unwrap<Matrix>(info[1]->ToObject());
 
+  dest->MakeWritable();
   self->mat.copyTo(dest->mat, mask->mat);
+  dest->UpdateExternalMemory();
 
   return;
 }
@@ -2706,6 +2546,7 @@ NAN_METHOD(Matrix::Shift) {
   res = padded(roi);
   ~self->mat;
   self->mat = res;
+  self->UpdateExternalMemory();
 
   return;
 }
@@ -2729,13 +2570,10 @@ NAN_METHOD(Matrix::Reshape) {
     JSTHROW("Invalid number of arguments");
   }
 
-  Local<Object> img_to_return =
-      Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-  Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(img_to_return);
+  Local<Object> out = NewInstance(self->mat.reshape(cn, rows));
+  UNWRAP_OBJ(Matrix, out)->ShareBacking(self);
 
-  img->mat = self->mat.reshape(cn, rows);
-
-  info.GetReturnValue().Set(img_to_return);
+  info.GetReturnValue().Set(out);
 }
 
 NAN_METHOD(Matrix::Release) {
@@ -2743,12 +2581,14 @@ NAN_METHOD(Matrix::Release) {
 
   Matrix *self = Nan::ObjectWrap::Unwrap<Matrix>(info.This());
   self->mat.release();
+  self->UpdateExternalMemory();
 
   return;
 }
 
 NAN_METHOD(Matrix::Subtract) {
   SETUP_FUNCTION(Matrix)
+  self->MakeWritable();
 
   if (info.Length() < 1) {
     Nan::ThrowTypeError("Invalid number of arguments");
@@ -1,6 +1,7 @@
 
 #include "OpenCV.h"
 #include "../inc/Matrix.h"
+#include "Stats.h"
 
 #define MATRIX_FROM_ARGS(NAME, IND) \
   if (info.Length() > IND && Matrix::HasInstance(info[IND])) { \
@@ -18,8 +19,42 @@ public:
   Matrix(int rows, int cols);
   Matrix(int rows, int cols, int type);
   Matrix(int rows, int cols, int type, Local<Object> scalarObj);
+  ~Matrix();
 
   static Local<Object> NewInstance();
+  static Local<Object> NewInstance(const cv::Mat &mat);
+
+  // Keeps V8's external memory counter in sync with the pixel buffer held by
+  // `mat`. Call it after anything that reassigns or reallocates `mat`.
+  void UpdateExternalMemory();
+
+  // Views share the pixels of the matrix they were taken from. When those
+  // pixels live in a JS Buffer (Matrix.fromBuffer) the view must keep the
+  // Buffer alive too.
+  void ShareBacking(const Matrix *owner);
+
+  // Keeps `owner`, a JS object holding the memory `mat` points into, alive as
+  // long as this matrix.
+  void SetBacking(Local<Object> owner);
+
+  // The object passed to SetBacking(), or undefined when OpenCV owns the
+  // pixels.
+  Local<Value> Backing() const;
+
+  // Marks the pixels as shared read-only, with the DecodeCache.
+  void SetCopyOnWrite();
+
+  // Call before writing into `mat` in place: gives a copy-on-write matrix
+  // pixels of its own, unless nothing else holds on to the shared ones.
+  void MakeWritable();
+
+  // MakeWritable() for callers about to overwrite every pixel in place:
+  // pixels anything else still holds on to are let go of rather than copied,
+  // so only unshared pixels are reused.
+  void MakeOverwritable();
+
+  // Whether anything but `mat` holds on to its pixels. Worker safe.
+  static bool IsShared(const cv::Mat &mat);
 
   static bool HasInstance(Local<Value> object);
 
@@ -34,16 +69,23 @@ public:
   JSFUNC(Get)  // at
   JSFUNC(Set)
   JSFUNC(Put)
+  JSFUNC(SetData)
+  JSFUNC(PutRegion)
 
   JSFUNC(GetData)
+  JSFUNC(Data)
+  JSFUNC(FromBuffer)  // factory
   JSFUNC(Normalize)
-  JSFUNC(Brightness)
   JSFUNC(Norm)
 
   JSFUNC(Row)
   JSFUNC(PixelRow)
   JSFUNC(Col)
   JSFUNC(PixelCol)
+  JSFUNC(RowData)
+  JSFUNC(ColData)
+  JSFUNC(RegionData)
+  JSFUNC(ChannelData)
 
   JSFUNC(Size)
   JSFUNC(Width)
@@ -59,22 +101,17 @@ public:
 
   JSFUNC(Save)
   JSFUNC(SaveAsync)
+  JSFUNC(SaveRaw)
+  JSFUNC(LoadRaw)  // factory
+  JSFUNC(CreateRaw)  // factory
 
   JSFUNC(ToBuffer)
   JSFUNC(ToBufferAsync)
 
-  JSFUNC(Resize)
   JSFUNC(Rotate)
   JSFUNC(GetRotationMatrix2D)
-  JSFUNC(WarpAffine)
-  JSFUNC(PyrDown)
-  JSFUNC(PyrUp)
 
-  JSFUNC(ConvertGrayscale)
   JSFUNC(ConvertHSVscale)
-  JSFUNC(GaussianBlur)
-  JSFUNC(MedianBlur)
-  JSFUNC(BilateralFilter)
   JSFUNC(Sobel)
   JSFUNC(Copy)
   JSFUNC(Flip)
@@ -91,41 +128,27 @@ public:
   JSFUNC(CountNonZero)
   //JSFUNC(Split)
   JSFUNC(Moments)
-  JSFUNC(Canny)
-  JSFUNC(Dilate)
-  JSFUNC(Erode)
 
-  JSFUNC(FindContours)
   JSFUNC(DrawContour)
   JSFUNC(DrawAllContours)
 
   // Feature Detection
   JSFUNC(GoodFeaturesToTrack)
   JSFUNC(CalcOpticalFlowPyrLK)
-  JSFUNC(HoughLinesP)
-  JSFUNC(HoughCircles)
 
   JSFUNC(Crop)
 
-  JSFUNC(inRange)
-
   JSFUNC(LocateROI)
   JSFUNC(AdjustROI)
 
-  JSFUNC(Threshold)
-  JSFUNC(AdaptiveThreshold)
   JSFUNC(MeanStdDev)
 
   JSFUNC(CopyTo)
   JSFUNC(ConvertTo)
-  JSFUNC(CvtColor)
   JSFUNC(Split)
   JSFUNC(Merge)
-  JSFUNC(EqualizeHist)
   JSFUNC(Pixel)
-  JSFUNC(FloodFill)
 
-  JSFUNC(MatchTemplate)
   JSFUNC(MatchTemplateByMatrix)
   JSFUNC(TemplateMatches)
   JSFUNC(MinMaxLoc)
@@ -134,7 +157,6 @@ public:
 
   JSFUNC(PutText)
   JSFUNC(GetPerspectiveTransform)
-  JSFUNC(WarpPerspective)
 
   JSFUNC(CopyWithMask)
   JSFUNC(Mean)
@@ -147,6 +169,19 @@ public:
 
   static NAN_METHOD(ToString);
 
+private:
+  // Bytes currently reported to V8 through Nan::AdjustExternalMemory.
+  int64_t externalMemory;
+
+  // Binding that created this matrix, for Stats::TrackMatrix.
+  Stats::Binding *site;
+
+  // Whether MakeWritable() has to check for shared pixels.
+  bool copyOnWrite;
+
+  // JS object that owns the memory `mat` points into, if OpenCV doesn't.
+  Nan::Persistent<Object> backing;
+
   /*
    static Handle<Value> Val(const Arguments& info);
    static Handle<Value> RowRange(const Arguments& info);
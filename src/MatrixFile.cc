@@ -0,0 +1,284 @@
+#include "MatrixFile.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static const char kMagic[8] = { 'C', 'V', 'M', 'A', 'T', 'R', 'A', 'W' };
+static const uint32_t kVersion = 1;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t dataOffset;
+  int32_t rows;
+  int32_t cols;
+  int32_t type;
+  uint32_t reserved;
+  uint64_t step;
+  uint8_t padding[24];
+};
+
+static_assert(sizeof(FileHeader) == 64, "FileHeader must be 64 bytes");
+
+static std::runtime_error IOError(const std::string &path) {
+  return std::runtime_error(path + ": " + strerror(errno));
+}
+
+static std::runtime_error FormatError(const std::string &path, const char *what) {
+  return std::runtime_error(path + ": " + what);
+}
+
+// Checks a header read from a file of `size` bytes.
+static void Validate(const std::string &path, const FileHeader &header, uint64_t size) {
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    throw FormatError(path, "not a raw matrix file");
+  }
+  if (header.version != kVersion) {
+    throw FormatError(path, "unsupported raw matrix version");
+  }
+
+  int type = header.type;
+  if (type != CV_MAT_TYPE(type) || CV_MAT_DEPTH(type) > CV_64F) {
+    throw FormatError(path, "invalid matrix type");
+  }
+  if (header.rows <= 0 || header.cols <= 0) {
+    throw FormatError(path, "invalid matrix size");
+  }
+
+  uint64_t rowBytes = (uint64_t) header.cols * CV_ELEM_SIZE(type);
+  if (header.step < rowBytes || header.step % CV_ELEM_SIZE1(type) != 0) {
+    throw FormatError(path, "invalid row step");
+  }
+  if (header.dataOffset < sizeof(FileHeader) || header.dataOffset % 64 != 0) {
+    throw FormatError(path, "invalid data offset");
+  }
+
+  // The rows must fit in the file. Divides rather than multiplies, so that a
+  // huge step can't wrap around.
+  if (size < header.dataOffset || size - header.dataOffset < rowBytes ||
+      (header.rows > 1 &&
+       header.step > (size - header.dataOffset - rowBytes) / (uint64_t) (header.rows - 1))) {
+    throw FormatError(path, "file is truncated");
+  }
+}
+
+static FileHeader NewHeader(int rows, int cols, int type) {
+  FileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.dataOffset = sizeof(FileHeader);
+  header.rows = rows;
+  header.cols = cols;
+  header.type = type;
+  header.step = (uint64_t) cols * CV_ELEM_SIZE(type);
+  return header;
+}
+
+void MatrixFile::Write(const std::string &path, const cv::Mat &mat) {
+  if (mat.dims > 2 || mat.empty()) {
+    throw std::runtime_error("Only non-empty 2D matrices can be saved raw");
+  }
+
+  FileHeader header = NewHeader(mat.rows, mat.cols, mat.type());
+
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!file) {
+    throw IOError(path);
+  }
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  for (int y = 0; ok && y < mat.rows; y++) {
+    ok = fwrite(mat.ptr(y), header.step, 1, file) == 1;
+  }
+
+  if (fclose(file) != 0) {
+    ok = false;
+  }
+  if (!ok) {
+    throw IOError(path);
+  }
+}
+
+cv::Mat MatrixFile::Read(const std::string &path) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) {
+    throw IOError(path);
+  }
+
+  FileHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1) {
+    fclose(file);
+    throw FormatError(path, "file is truncated");
+  }
+
+  cv::Mat mat;
+  try {
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0) {
+      throw IOError(path);
+    }
+    Validate(path, header, st.st_size);
+    mat.create(header.rows, header.cols, header.type);
+
+    size_t rowBytes = (size_t) mat.cols * mat.elemSize();
+    bool ok = fseek(file, header.dataOffset, SEEK_SET) == 0;
+    for (int y = 0; ok && y < mat.rows; y++) {
+      ok = fread(mat.ptr(y), rowBytes, 1, file) == 1;
+      if (ok && header.step > rowBytes && y < mat.rows - 1) {
+        ok = fseek(file, header.step - rowBytes, SEEK_CUR) == 0;
+      }
+    }
+    if (!ok) {
+      throw FormatError(path, "file is truncated");
+    }
+  } catch (...) {
+    fclose(file);
+    throw;
+  }
+
+  fclose(file);
+  return mat;
+}
+
+#if !defined(_WIN32) && CV_MAJOR_VERSION >= 3
+
+bool MatrixFile::CanMap() {
+  return true;
+}
+
+// Unmaps a file once the last Mat over it lets go. The UMatData of the Mat
+// holds the mapping, so views, copies held by workers and data() Buffers
+// all keep it mapped, just as they keep allocated pixels alive.
+class MappingAllocator: public cv::MatAllocator {
+public:
+  cv::UMatData* allocate(int dims, const int* sizes, int type, void* data0,
+      size_t* step, int flags, cv::UMatUsageFlags usageFlags) const {
+    // Never the allocator of a Mat, only of its UMatData
+    return cv::Mat::getDefaultAllocator()->allocate(dims, sizes, type, data0, step, flags, usageFlags);
+  }
+
+  bool allocate(cv::UMatData* u, int accessFlags, cv::UMatUsageFlags usageFlags) const {
+    return u != NULL;
+  }
+
+  void deallocate(cv::UMatData* u) const {
+    if (!u) {
+      return;
+    }
+
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    munmap(u->origdata, u->size);
+    delete u;
+  }
+};
+
+static cv::MatAllocator *Allocator() {
+  // Never destroyed: mapped matrices may be released after static destructors.
+  static MappingAllocator *allocator = new MappingAllocator();
+  return allocator;
+}
+
+// A Mat over the rows of a validated file mapped at `base`, owning the mapping.
+static cv::Mat MatOver(void *base, size_t length) {
+  const FileHeader &header = *static_cast<const FileHeader *>(base);
+  cv::Mat mat(header.rows, header.cols, header.type,
+      static_cast<char *>(base) + header.dataOffset, header.step);
+
+  cv::UMatData *u = new cv::UMatData(Allocator());
+  u->data = u->origdata = static_cast<uchar *>(base);
+  u->size = length;
+  u->flags |= cv::UMatData::USER_ALLOCATED;
+  u->refcount = 1;
+  mat.u = u;
+  return mat;
+}
+
+cv::Mat MatrixFile::Map(const std::string &path, bool shared) {
+  int fd = open(path.c_str(), shared ? O_RDWR : O_RDONLY);
+  if (fd < 0) {
+    throw IOError(path);
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw IOError(path);
+  }
+  if ((uint64_t) st.st_size < sizeof(FileHeader)) {
+    close(fd);
+    throw FormatError(path, "file is truncated");
+  }
+
+  // Always writable, so that in-place ops work. Private mappings leave the
+  // file alone.
+  void *base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE,
+      shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    throw IOError(path);
+  }
+
+  const FileHeader &header = *static_cast<const FileHeader *>(base);
+  try {
+    Validate(path, header, st.st_size);
+  } catch (...) {
+    munmap(base, st.st_size);
+    throw;
+  }
+
+  return MatOver(base, st.st_size);
+}
+
+cv::Mat MatrixFile::Create(const std::string &path, int rows, int cols, int type) {
+  if (rows <= 0 || cols <= 0 || type != CV_MAT_TYPE(type) || CV_MAT_DEPTH(type) > CV_64F) {
+    throw std::runtime_error("Invalid matrix size or type");
+  }
+
+  FileHeader header = NewHeader(rows, cols, type);
+  uint64_t length = header.dataOffset + header.step * rows;
+
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw IOError(path);
+  }
+
+  if (write(fd, &header, sizeof(header)) != (ssize_t) sizeof(header) ||
+      ftruncate(fd, length) != 0) {
+    close(fd);
+    throw IOError(path);
+  }
+
+  void *base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    throw IOError(path);
+  }
+
+  return MatOver(base, length);
+}
+
+#else
+
+bool MatrixFile::CanMap() {
+  return false;
+}
+
+cv::Mat MatrixFile::Map(const std::string &path, bool shared) {
+  throw std::runtime_error("Mapping files needs mmap and OpenCV 3 or later");
+}
+
+cv::Mat MatrixFile::Create(const std::string &path, int rows, int cols, int type) {
+  throw std::runtime_error("Mapping files needs mmap and OpenCV 3 or later");
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef __NODE_MATRIXFILE_H
+#define __NODE_MATRIXFILE_H
+
+#include "OpenCV.h"
+
+#include <stdint.h>
+#include <string>
+
+/**
+ * Lossless file format for any Matrix: a 64 byte header followed by the rows,
+ * exactly as they are in memory. Unlike imwrite it keeps float, 16-bit and
+ * many-channel data as is, and a file can be mapped instead of read.
+ *
+ *   offset  size
+ *        0     8  magic "CVMATRAW"
+ *        8     4  version, 1
+ *       12     4  offset of the first row
+ *       16     4  rows
+ *       20     4  cols
+ *       24     4  OpenCV type (CV_32FC3, ...)
+ *       28     4  reserved, 0
+ *       32     8  bytes from one row to the next
+ *       40    24  reserved, 0
+ *
+ * Numbers are little endian. The first row starts on a 64 byte boundary, the
+ * others follow it `step` bytes apart.
+ */
+class MatrixFile {
+public:
+  // The functions below throw std::runtime_error on I/O errors and bad files.
+
+  static void Write(const std::string &path, const cv::Mat &mat);
+
+  // Reads the pixels into a new Mat.
+  static cv::Mat Read(const std::string &path);
+
+  // Maps the file and returns a Mat over the mapped rows. The mapping is
+  // reference counted like any Mat's pixels: it goes away once the last Mat
+  // over it, view or copy of the header, is released. Unless `shared` is
+  // set, writes to the Mat are private to the process and never reach the
+  // file. The pixels are flagged USER_ALLOCATED, as they take no heap.
+  static cv::Mat Map(const std::string &path, bool shared = false);
+
+  // Creates a zero filled file for a rows x cols matrix and maps it shared.
+  // The file is sparse where the filesystem allows, so nothing is written
+  // until rows are.
+  static cv::Mat Create(const std::string &path, int rows, int cols, int type);
+
+  // False where Map() is not available: without mmap, or with OpenCV 2,
+  // whose Mats can't own a mapping.
+  static bool CanMap();
+};
+
+#endif
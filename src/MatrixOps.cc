@@ -0,0 +1,1240 @@
+#include "MatrixOps.h"
+#include "Stats.h"
+#include "AsyncResultWorker.h"
+#include "Contours.h"
+#include "Size.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <vector>
+
+cv::Scalar setColor(Local<Object> objColor);
+cv::Point setPoint(Local<Object> objPoint);
+cv::Rect* setRect(Local<Object> objRect, cv::Rect &result);
+
+// Compiled pipelines copy their ops for every run, so that runs can overlap.
+#define CLONE_OP(TYPE) \
+  MatrixOp* Clone() const override { return new TYPE(*this); }
+
+// Neighbourhood filters can't write over their own input. When an op runs in
+// place `dst` shares pixels with `src`, so read from a copy instead.
+static cv::Mat Unaliased(const cv::Mat &src, const cv::Mat &dst) {
+  return src.data == dst.data ? src.clone() : src;
+}
+
+static Local<Array> ToArray(const std::vector<cv::Vec4i> &items) {
+  Local<Array> arr = Nan::New<Array>(items.size());
+  for (unsigned int i = 0; i < items.size(); i++) {
+    Local<Array> item = Nan::New<Array>(4);
+    for (int j = 0; j < 4; j++) {
+      item->Set(j, Nan::New<Number>((double) items[i][j]));
+    }
+    arr->Set(i, item);
+  }
+  return arr;
+}
+
+static Local<Array> ToArray(const std::vector<cv::Vec3f> &items) {
+  Local<Array> arr = Nan::New<Array>(items.size());
+  for (unsigned int i = 0; i < items.size(); i++) {
+    Local<Array> item = Nan::New<Array>(3);
+    for (int j = 0; j < 3; j++) {
+      item->Set(j, Nan::New<Number>((double) items[i][j]));
+    }
+    arr->Set(i, item);
+  }
+  return arr;
+}
+
+static cv::Mat MatrixArg(Local<Value> arg, const char *error) {
+  if (!Matrix::HasInstance(arg)) {
+    throw error;
+  }
+  return Nan::ObjectWrap::Unwrap<Matrix>(arg->ToObject())->mat;
+}
+
+class ResizeOp : public MatrixOp {
+public:
+  CLONE_OP(ResizeOp)
+
+  ResizeOp(): MatrixOp(NEW_MATRIX, 1), fx(0), fy(0), interpolation(cv::INTER_LINEAR) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc == 0) {
+      throw "Matrix.resize requires at least 1 argument";
+    }
+
+    size = Size::RawSize(1, argv);
+    if (size.area() == 0) {
+      throw "Area of size must be > 0";
+    }
+
+    if (argc > 1 && argv[1]->IsNumber()) fx = argv[1]->NumberValue();
+    if (argc > 2 && argv[2]->IsNumber()) fy = argv[2]->NumberValue();
+    if (argc > 3 && argv[3]->IsNumber()) interpolation = argv[3]->Int32Value();
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::resize(src, dst, size, fx, fy, interpolation);
+  }
+
+private:
+  cv::Size size;
+  double fx, fy;
+  int interpolation;
+};
+
+static const struct {
+  const char *name;
+  int code;
+} kColorConversions[] = {
+  { "CV_BGR2GRAY", CV_BGR2GRAY },
+  { "CV_GRAY2BGR", CV_GRAY2BGR },
+  { "CV_BGR2XYZ", CV_BGR2XYZ },
+  { "CV_XYZ2BGR", CV_XYZ2BGR },
+  { "CV_BGR2YCrCb", CV_BGR2YCrCb },
+  { "CV_YCrCb2BGR", CV_YCrCb2BGR },
+  { "CV_BGR2HSV", CV_BGR2HSV },
+  { "CV_HSV2BGR", CV_HSV2BGR },
+  { "CV_BGR2HLS", CV_BGR2HLS },
+  { "CV_HLS2BGR", CV_HLS2BGR },
+  { "CV_BGR2Lab", CV_BGR2Lab },
+  { "CV_Lab2BGR", CV_Lab2BGR },
+  { "CV_BGR2Luv", CV_BGR2Luv },
+  { "CV_Luv2BGR", CV_Luv2BGR },
+  { "CV_BayerBG2BGR", CV_BayerBG2BGR },
+  { "CV_BayerGB2BGR", CV_BayerGB2BGR },
+  { "CV_BayerRG2BGR", CV_BayerRG2BGR },
+  { "CV_BayerGR2BGR", CV_BayerGR2BGR },
+  { "CV_BGR2RGB", CV_BGR2RGB }
+};
+
+// @author SergeMv
+// Does in-place color transformation
+// img.cvtColor('CV_BGR2YCrCb');
+class CvtColorOp : public MatrixOp {
+public:
+  CLONE_OP(CvtColorOp)
+
+  CvtColorOp(): MatrixOp(IN_PLACE, 1), code(-1) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc < 1) {
+      throw "Invalid number of arguments";
+    }
+
+    Nan::Utf8String name(argv[0]);
+    for (size_t i = 0; i < sizeof(kColorConversions) / sizeof(kColorConversions[0]); i++) {
+      if (*name && !strcmp(*name, kColorConversions[i].name)) {
+        code = kColorConversions[i].code;
+      }
+    }
+
+    if (code < 0) {
+      throw "Conversion code is unsupported";
+    }
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::cvtColor(src, dst, code);
+  }
+
+  int Halo() const override {
+    // Demosaicing interpolates from neighbouring photosites.
+    bool bayer = code == CV_BayerBG2BGR || code == CV_BayerGB2BGR ||
+        code == CV_BayerRG2BGR || code == CV_BayerGR2BGR;
+    return bayer ? 2 : 0;
+  }
+
+private:
+  int code;
+};
+
+class ConvertGrayscaleOp : public MatrixOp {
+public:
+  CLONE_OP(ConvertGrayscaleOp)
+
+  ConvertGrayscaleOp(): MatrixOp(IN_PLACE, -1) {}
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    if (src.channels() != 3) {
+      CV_Error(CV_StsBadArg, "Image is no 3-channel");
+    }
+    cv::cvtColor(src, dst, CV_BGR2GRAY);
+  }
+
+  int Halo() const override {
+    return 0;
+  }
+};
+
+class GaussianBlurOp : public MatrixOp {
+public:
+  CLONE_OP(GaussianBlurOp)
+
+  GaussianBlurOp(): MatrixOp(IN_PLACE, 0), ksize(5, 5), sigma(0) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc < 1) {
+      return;
+    }
+
+    if (!argv[0]->IsArray()) {
+      throw "'ksize' argument must be a 2 double array";
+    }
+    Local<Object> array = argv[0]->ToObject();
+    Local<Value> x = array->Get(0);
+    Local<Value> y = array->Get(1);
+    if (!x->IsNumber() || !y->IsNumber()) {
+      throw "'ksize' argument must be a 2 double array";
+    }
+    ksize = cv::Size(x->NumberValue(), y->NumberValue());
+
+    if (argc > 1 && argv[1]->IsNumber()) {
+      sigma = argv[1]->NumberValue();
+    }
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::GaussianBlur(Unaliased(src, dst), dst, ksize, sigma);
+  }
+
+  int Halo() const override {
+    // Radius of the kernel OpenCV derives from sigma for a 0 ksize, taken on
+    // each axis, as ksize and sigma can each set one of them
+    int fromSigma = (int) std::ceil(sigma * 4) + 1;
+    int x = std::max(ksize.width / 2, fromSigma);
+    int y = std::max(ksize.height / 2, fromSigma);
+    return std::max(x, y);
+  }
+
+private:
+  cv::Size ksize;
+  double sigma;
+};
+
+class MedianBlurOp : public MatrixOp {
+public:
+  CLONE_OP(MedianBlurOp)
+
+  MedianBlurOp(): MatrixOp(IN_PLACE, 1), ksize(3) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc < 1 || !argv[0]->IsNumber()) {
+      throw "'ksize' argument must be a positive odd integer";
+    }
+
+    ksize = argv[0]->IntegerValue();
+    if (ksize <= 0 || (ksize % 2) == 0) {
+      throw "'ksize' argument must be a positive odd integer";
+    }
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::medianBlur(Unaliased(src, dst), dst, ksize);
+  }
+
+  int Halo() const override {
+    return ksize / 2;
+  }
+
+private:
+  int ksize;
+};
+
+class BilateralFilterOp : public MatrixOp {
+public:
+  CLONE_OP(BilateralFilterOp)
+
+  BilateralFilterOp(): MatrixOp(IN_PLACE, 0), d(15), sigmaColor(80),
+    sigmaSpace(80), borderType(cv::BORDER_DEFAULT) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc == 0) {
+      return;
+    }
+
+    if (argc < 3 || argc > 4) {
+      throw "BilateralFilter takes 0, 3, or 4 arguments";
+    }
+
+    d = argv[0]->IntegerValue();
+    sigmaColor = argv[1]->NumberValue();
+    sigmaSpace = argv[2]->NumberValue();
+    if (argc == 4) {
+      borderType = argv[3]->IntegerValue();
+    }
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::bilateralFilter(Unaliased(src, dst), dst, d, sigmaColor, sigmaSpace, borderType);
+  }
+
+  int Halo() const override {
+    return d > 0 ? d / 2 : cvRound(sigmaSpace * 1.5);
+  }
+
+private:
+  int d;
+  double sigmaColor;
+  double sigmaSpace;
+  int borderType;
+};
+
+class CannyOp : public MatrixOp {
+public:
+  CLONE_OP(CannyOp)
+
+  CannyOp(): MatrixOp(IN_PLACE, 2), lowThresh(0), highThresh(0) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc < 2) {
+      throw "Matrix.canny requires 2 arguments";
+    }
+
+    lowThresh = argv[0]->NumberValue();
+    highThresh = argv[1]->NumberValue();
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::Canny(src, dst, lowThresh, highThresh);
+  }
+
+private:
+  int lowThresh;
+  int highThresh;
+};
+
+// Shared by dilate and erode: (iterations[, kernel])
+class MorphologyOp : public MatrixOp {
+public:
+  MorphologyOp(): MatrixOp(IN_PLACE, 2), niters(1) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc > 0) {
+      niters = argv[0]->NumberValue();
+    }
+
+    if (argc > 1 && Matrix::HasInstance(argv[1])) {
+      kernel = Nan::ObjectWrap::Unwrap<Matrix>(argv[1]->ToObject())->mat;
+    }
+  }
+
+  int Halo() const override {
+    // The default kernel is 3x3
+    int radius = kernel.empty() ? 1 : std::max(kernel.cols, kernel.rows) / 2;
+    return radius * std::max(niters, 1);
+  }
+
+protected:
+  int niters;
+  cv::Mat kernel;
+};
+
+class DilateOp : public MorphologyOp {
+public:
+  CLONE_OP(DilateOp)
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::dilate(src, dst, kernel, cv::Point(-1, -1), niters);
+  }
+};
+
+class ErodeOp : public MorphologyOp {
+public:
+  CLONE_OP(ErodeOp)
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::erode(src, dst, kernel, cv::Point(-1, -1), niters);
+  }
+};
+
+class ThresholdOp : public MatrixOp {
+public:
+  CLONE_OP(ThresholdOp)
+
+  ThresholdOp(): MatrixOp(NEW_MATRIX, 2), threshold(0), maxVal(0),
+    type(cv::THRESH_BINARY) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc < 2) {
+      throw "Matrix.threshold requires at least 2 arguments";
+    }
+
+    threshold = argv[0]->NumberValue();
+    maxVal = argv[1]->NumberValue();
+
+    if (argc >= 3) {
+      Nan::Utf8String typstr(argv[2]);
+
+      if (strcmp(*typstr, "Binary") == 0) {
+        // Uses default value
+      }
+      else if (strcmp(*typstr, "Binary Inverted") == 0) {
+        type = cv::THRESH_BINARY_INV;
+      }
+      else if (strcmp(*typstr, "Threshold Truncated") == 0) {
+        type = cv::THRESH_TRUNC;
+      }
+      else if (strcmp(*typstr, "Threshold to Zero") == 0) {
+        type = cv::THRESH_TOZERO;
+      }
+      else if (strcmp(*typstr, "Threshold to Zero Inverted") == 0) {
+        type = cv::THRESH_TOZERO_INV;
+      }
+      else {
+        throw "Unsupported binarization technique. "
+          "Use \"Binary\" (default), \"Binary Inverted\", "
+          "\"Threshold Truncated\", \"Threshold to Zero\" "
+          "or \"Threshold to Zero Inverted\"";
+      }
+    }
+
+    if (argc >= 4) {
+      Nan::Utf8String algorithm(argv[3]);
+
+      if (strcmp(*algorithm, "Simple") == 0) {
+        // Uses default
+      }
+      else if (strcmp(*algorithm, "Otsu") == 0) {
+        type += cv::THRESH_OTSU;
+      }
+#if CV_MAJOR_VERSION >= 3
+      else if (strcmp(*algorithm, "Triangle") == 0) {
+        type += cv::THRESH_TRIANGLE;
+      }
+#endif
+      else {
+        throw "Unsupported threshold algorithm. "
+          "Use \"Simple\" (default), \"Otsu\" or \"Triangle\".";
+      }
+    }
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::threshold(src, dst, threshold, maxVal, type);
+  }
+
+  int Halo() const override {
+    // Otsu and Triangle pick the threshold from the histogram of the whole
+    // image.
+#if CV_MAJOR_VERSION >= 3
+    return (type & (cv::THRESH_OTSU | cv::THRESH_TRIANGLE)) ? -1 : 0;
+#else
+    return (type & cv::THRESH_OTSU) ? -1 : 0;
+#endif
+  }
+
+private:
+  double threshold;
+  double maxVal;
+  int type;
+};
+
+class AdaptiveThresholdOp : public MatrixOp {
+public:
+  CLONE_OP(AdaptiveThresholdOp)
+
+  AdaptiveThresholdOp(): MatrixOp(NEW_MATRIX, 5) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc < 5) {
+      throw "Matrix.adaptiveThreshold requires 5 arguments";
+    }
+
+    maxVal = argv[0]->NumberValue();
+    adaptiveMethod = argv[1]->NumberValue();
+    thresholdType = argv[2]->NumberValue();
+    blockSize = argv[3]->NumberValue();
+    C = argv[4]->NumberValue();
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::adaptiveThreshold(src, dst, maxVal, adaptiveMethod, thresholdType,
+        blockSize, C);
+  }
+
+  int Halo() const override {
+    return (int) blockSize / 2;
+  }
+
+private:
+  double maxVal;
+  double adaptiveMethod;
+  double thresholdType;
+  double blockSize;
+  double C;
+};
+
+class WarpAffineOp : public MatrixOp {
+public:
+  CLONE_OP(WarpAffineOp)
+
+  WarpAffineOp(): MatrixOp(IN_PLACE, 1), dstRows(-1), dstCols(-1) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc < 1) {
+      throw "Matrix.warpAffine requires at least 1 argument";
+    }
+
+    rotation = MatrixArg(argv[0], "Argument 1 must be a Matrix");
+
+    // Resize the image if size is specified
+    if (argc > 1 && !argv[1]->IsUndefined()) dstRows = argv[1]->Uint32Value();
+    if (argc > 2 && !argv[2]->IsUndefined()) dstCols = argv[2]->Uint32Value();
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::Size size(dstRows < 0 ? src.rows : dstRows, dstCols < 0 ? src.cols : dstCols);
+
+    // In place, the result has always gone to a buffer of its own
+    if (dst.data == src.data) {
+      dst = cv::Mat();
+    }
+    cv::warpAffine(src, dst, rotation, size);
+  }
+
+private:
+  cv::Mat rotation;
+  int dstRows;
+  int dstCols;
+};
+
+class WarpPerspectiveOp : public MatrixOp {
+public:
+  CLONE_OP(WarpPerspectiveOp)
+
+  WarpPerspectiveOp(): MatrixOp(IN_PLACE, 3), borderColor(0, 0, 255) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc < 3) {
+      throw "Matrix.warpPerspective requires at least 3 arguments";
+    }
+
+    xfrm = MatrixArg(argv[0], "Argument 1 must be a Matrix");
+    size = cv::Size(argv[1]->IntegerValue(), argv[2]->IntegerValue());
+
+    if (argc > 3 && argv[3]->IsArray()) {
+      borderColor = setColor(argv[3]->ToObject());
+    }
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    if (dst.data == src.data) {
+      dst = cv::Mat();
+    }
+    cv::warpPerspective(src, dst, xfrm, size, cv::INTER_LINEAR,
+        cv::BORDER_REPLICATE, borderColor);
+  }
+
+private:
+  cv::Mat xfrm;
+  cv::Size size;
+  cv::Scalar borderColor;
+};
+
+class PyrDownOp : public MatrixOp {
+public:
+  CLONE_OP(PyrDownOp)
+
+  PyrDownOp(): MatrixOp(IN_PLACE, 0) {}
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::pyrDown(src, dst);
+  }
+};
+
+class PyrUpOp : public MatrixOp {
+public:
+  CLONE_OP(PyrUpOp)
+
+  PyrUpOp(): MatrixOp(IN_PLACE, 0) {}
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::pyrUp(src, dst);
+  }
+};
+
+class InRangeOp : public MatrixOp {
+public:
+  CLONE_OP(InRangeOp)
+
+  InRangeOp(): MatrixOp(IN_PLACE, 2) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc < 2 || !argv[0]->IsArray() || !argv[1]->IsArray()) {
+      throw "Matrix.inRange requires lower and upper bound arrays";
+    }
+
+    lowerb = setColor(argv[0]->ToObject());
+    upperb = setColor(argv[1]->ToObject());
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::inRange(src, lowerb, upperb, dst);
+  }
+
+  int Halo() const override {
+    return 0;
+  }
+
+private:
+  cv::Scalar lowerb;
+  cv::Scalar upperb;
+};
+
+// @author SergeMv
+// Equalizes histogram
+// img.equalizeHist()
+class EqualizeHistOp : public MatrixOp {
+public:
+  CLONE_OP(EqualizeHistOp)
+
+  EqualizeHistOp(): MatrixOp(IN_PLACE, 0) {}
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::equalizeHist(src, dst);
+  }
+};
+
+// Intensity curves for 8-bit images go through a 256 entry table and cv::LUT.
+// Tables are built by Parse() on the main thread and kept by op name and
+// parameters, so a per-frame gamma(2.2) builds its table once.
+typedef double (*CurveFn)(double value, const std::vector<double> &params);
+
+static const size_t kMaxCachedTables = 64;
+
+static cv::Mat CachedTable(const char *name, const std::vector<double> &params, CurveFn curve) {
+  typedef std::pair<std::string, std::vector<double> > Key;
+  static std::map<Key, cv::Mat> cache;
+
+  Key key(name, params);
+  std::map<Key, cv::Mat>::iterator it = cache.find(key);
+  if (it != cache.end()) {
+    return it->second;
+  }
+
+  if (cache.size() >= kMaxCachedTables) {
+    cache.clear();
+  }
+
+  cv::Mat table(1, 256, CV_8U);
+  for (int i = 0; i < 256; i++) {
+    table.at<uchar>(i) = cv::saturate_cast<uchar>(curve(i, params));
+  }
+  cache[key] = table;
+  return table;
+}
+
+static double LinearCurve(double value, const std::vector<double> &params) {
+  return params[0] * value + params[1];
+}
+
+static double GammaCurve(double value, const std::vector<double> &params) {
+  return 255.0 * std::pow(value / 255.0, 1.0 / params[0]);
+}
+
+// params: inBlack, inWhite, gamma, outBlack, outWhite
+static double LevelsCurve(double value, const std::vector<double> &params) {
+  double v = (value - params[0]) / (params[1] - params[0]);
+  v = std::min(1.0, std::max(0.0, v));
+  return params[3] + std::pow(v, 1.0 / params[2]) * (params[4] - params[3]);
+}
+
+static void RequireBytes(const cv::Mat &src, const char *method) {
+  if (src.depth() != CV_8U) {
+    CV_Error(CV_StsUnsupportedFormat, std::string(method) + " requires an 8-bit image");
+  }
+}
+
+// new(i,j) = alpha * old(i,j) + beta, on every channel
+// img.brightness(alpha, beta); img.brightness(diff);
+class BrightnessOp : public MatrixOp {
+public:
+  CLONE_OP(BrightnessOp)
+
+  BrightnessOp(): MatrixOp(IN_PLACE, 1), alpha(1), beta(0) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc == 1) {
+      beta = argv[0]->NumberValue();
+    } else if (argc == 2) {
+      alpha = argv[0]->NumberValue();
+      beta = argv[1]->NumberValue();
+    } else {
+      throw "Insufficient or wrong arguments";
+    }
+
+    std::vector<double> params;
+    params.push_back(alpha);
+    params.push_back(beta);
+    table = CachedTable("brightness", params, LinearCurve);
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    if (src.depth() == CV_8U) {
+      cv::LUT(src, table, dst);
+    } else {
+      src.convertTo(dst, -1, alpha, beta);
+    }
+  }
+
+  int Halo() const override {
+    return 0;
+  }
+
+private:
+  double alpha;
+  double beta;
+  cv::Mat table;
+};
+
+// Maps every 8-bit value through a 256 entry table. The table is an array or
+// typed array of numbers, or a Matrix of 256 elements with one channel or as
+// many as the image; its depth becomes the image's.
+// img.lut(table)
+class LutOp : public MatrixOp {
+public:
+  CLONE_OP(LutOp)
+
+  LutOp(): MatrixOp(IN_PLACE, 1) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc < 1) {
+      throw "Matrix.lut requires a table";
+    }
+
+    if (Matrix::HasInstance(argv[0])) {
+      table = Nan::ObjectWrap::Unwrap<Matrix>(argv[0]->ToObject())->mat;
+      if (table.total() != 256) {
+        throw "Table must have 256 entries";
+      }
+      return;
+    }
+
+    if (!argv[0]->IsObject()) {
+      throw "Table must be an array of 256 numbers or a Matrix";
+    }
+
+    Local<Object> values = argv[0]->ToObject();
+    Local<Value> length = values->Get(Nan::New<String>("length").ToLocalChecked());
+    if (!length->IsNumber() || length->Uint32Value() != 256) {
+      throw "Table must have 256 entries";
+    }
+
+    table.create(1, 256, CV_8U);
+    for (int i = 0; i < 256; i++) {
+      table.at<uchar>(i) = cv::saturate_cast<uchar>(values->Get(i)->NumberValue());
+    }
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    RequireBytes(src, "lut");
+    cv::LUT(src, table, dst);
+  }
+
+  int Halo() const override {
+    return 0;
+  }
+
+private:
+  cv::Mat table;
+};
+
+// new = 255 * (old / 255) ^ (1 / gamma), so gamma > 1 brightens
+// img.gamma(2.2)
+class GammaOp : public MatrixOp {
+public:
+  CLONE_OP(GammaOp)
+
+  GammaOp(): MatrixOp(IN_PLACE, 1) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc < 1 || !argv[0]->IsNumber() || !(argv[0]->NumberValue() > 0)) {
+      throw "Gamma must be a number > 0";
+    }
+
+    std::vector<double> params(1, argv[0]->NumberValue());
+    table = CachedTable("gamma", params, GammaCurve);
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    RequireBytes(src, "gamma");
+    cv::LUT(src, table, dst);
+  }
+
+  int Halo() const override {
+    return 0;
+  }
+
+private:
+  cv::Mat table;
+};
+
+// Stretches [inBlack, inWhite] to [outBlack, outWhite] with a gamma curve in
+// between, like a levels dialog. Values outside the input range are clipped.
+// img.levels(inBlack, inWhite[, gamma[, outBlack, outWhite]])
+class LevelsOp : public MatrixOp {
+public:
+  CLONE_OP(LevelsOp)
+
+  LevelsOp(): MatrixOp(IN_PLACE, 2) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc < 2 || argc == 4) {
+      throw "Matrix.levels takes inBlack, inWhite[, gamma[, outBlack, outWhite]]";
+    }
+
+    std::vector<double> params(5);
+    params[0] = argv[0]->NumberValue();
+    params[1] = argv[1]->NumberValue();
+    params[2] = argc > 2 ? argv[2]->NumberValue() : 1;
+    params[3] = argc > 3 ? argv[3]->NumberValue() : 0;
+    params[4] = argc > 4 ? argv[4]->NumberValue() : 255;
+
+    if (!(params[1] > params[0])) {
+      throw "inWhite must be greater than inBlack";
+    }
+    if (!(params[2] > 0)) {
+      throw "Gamma must be a number > 0";
+    }
+
+    table = CachedTable("levels", params, LevelsCurve);
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    RequireBytes(src, "levels");
+    cv::LUT(src, table, dst);
+  }
+
+  int Halo() const override {
+    return 0;
+  }
+
+private:
+  cv::Mat table;
+};
+
+class HoughLinesPOp : public MatrixOp {
+public:
+  CLONE_OP(HoughLinesPOp)
+
+  HoughLinesPOp(): MatrixOp(NO_MATRIX, -1) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    rho = argc < 1 ? 1 : argv[0]->NumberValue();
+    theta = argc < 2 ? CV_PI/180 : argv[1]->NumberValue();
+    threshold = argc < 3 ? 80 : argv[2]->Uint32Value();
+    minLineLength = argc < 4 ? 30 : argv[3]->NumberValue();
+    maxLineGap = argc < 5 ? 10 : argv[4]->NumberValue();
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::Mat gray;
+
+    cv::equalizeHist(src, gray);
+    cv::HoughLinesP(gray, lines, rho, theta, threshold, minLineLength, maxLineGap);
+  }
+
+  Local<Value> Result() override {
+    return ToArray(lines);
+  }
+
+private:
+  double rho;
+  double theta;
+  int threshold;
+  double minLineLength;
+  double maxLineGap;
+  std::vector<cv::Vec4i> lines;
+};
+
+class HoughCirclesOp : public MatrixOp {
+public:
+  CLONE_OP(HoughCirclesOp)
+
+  HoughCirclesOp(): MatrixOp(NO_MATRIX, -1) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    dp = argc < 1 ? 1 : argv[0]->NumberValue();
+    minDist = argc < 2 ? 1 : argv[1]->NumberValue();
+    higherThreshold = argc < 3 ? 100 : argv[2]->NumberValue();
+    accumulatorThreshold = argc < 4 ? 100 : argv[3]->NumberValue();
+    minRadius = argc < 5 ? 0 : argv[4]->Uint32Value();
+    maxRadius = argc < 6 ? 0 : argv[5]->Uint32Value();
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::Mat gray;
+
+    cv::equalizeHist(src, gray);
+    cv::HoughCircles(gray, circles, CV_HOUGH_GRADIENT, dp, minDist,
+        higherThreshold, accumulatorThreshold, minRadius, maxRadius);
+  }
+
+  // [[x, y, radius], ...]
+  Local<Value> Result() override {
+    return ToArray(circles);
+  }
+
+private:
+  double dp;
+  double minDist;
+  double higherThreshold;
+  double accumulatorThreshold;
+  int minRadius;
+  int maxRadius;
+  std::vector<cv::Vec3f> circles;
+};
+
+class FindContoursOp : public MatrixOp {
+public:
+  CLONE_OP(FindContoursOp)
+
+  FindContoursOp(): MatrixOp(NO_MATRIX, -1), mode(CV_RETR_LIST),
+    chain(CV_CHAIN_APPROX_SIMPLE) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc > 0 && argv[0]->IsNumber()) mode = argv[0]->IntegerValue();
+    if (argc > 1 && argv[1]->IsNumber()) chain = argv[1]->IntegerValue();
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    cv::findContours(src, contours, hierarchy, mode, chain);
+  }
+
+  bool WritesSource() const override {
+    // Up to OpenCV 3.2 it draws over its source as it traces
+#if CV_MAJOR_VERSION < 3 || (CV_MAJOR_VERSION == 3 && CV_MINOR_VERSION < 2)
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  Local<Value> Result() override {
+    Local<Object> conts_to_return = Nan::NewInstance(Nan::GetFunction(Nan::New(Contour::constructor)).ToLocalChecked()).ToLocalChecked();
+    Contour *result = Nan::ObjectWrap::Unwrap<Contour>(conts_to_return);
+    result->contours.swap(contours);
+    result->hierarchy.swap(hierarchy);
+    return conts_to_return;
+  }
+
+private:
+  int mode;
+  int chain;
+  std::vector<std::vector<cv::Point> > contours;
+  std::vector<cv::Vec4i> hierarchy;
+};
+
+// MatchTemplate accept a Matrix
+// Usage: output = input.matchTemplate(matrix, method);
+class MatchTemplateOp : public MatrixOp {
+public:
+  CLONE_OP(MatchTemplateOp)
+
+  MatchTemplateOp(): MatrixOp(NEW_MATRIX, -1), method(0) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc < 2) {
+      throw "Matrix.matchTemplate requires at least 2 arguments";
+    }
+
+    templ = MatrixArg(argv[0], "Argument 1 must be a Matrix");
+
+    if (!argv[1]->IsInt32()) {
+      throw "Argument 2 must be a number";
+    }
+    method = argv[1]->Int32Value();
+
+#if CV_MAJOR_VERSION >= 3
+    if (argc > 2 && Matrix::HasInstance(argv[2])) {
+      mask = Nan::ObjectWrap::Unwrap<Matrix>(argv[2]->ToObject())->mat;
+    }
+#endif
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+#if CV_MAJOR_VERSION < 3
+    cv::matchTemplate(src, templ, dst, method);
+#else
+    if (mask.empty()) {
+      cv::matchTemplate(src, templ, dst, method);
+    } else {
+      cv::matchTemplate(src, templ, dst, method, mask);
+    }
+#endif
+  }
+
+private:
+  cv::Mat templ;
+  cv::Mat mask;
+  int method;
+};
+
+/*  mat.floodFill( {seedPoint: [1,1] ,
+      newColor: [255,0,0] ,
+      rect:[[0,2],[30,40]] ,
+      loDiff : [8,90,60],
+      upDiff:[10,100,70]
+    }); */
+class FloodFillOp : public MatrixOp {
+public:
+  CLONE_OP(FloodFillOp)
+
+  FloodFillOp(): MatrixOp(IN_PLACE, -1), hasRect(false), filled(0) {}
+
+  void Parse(int argc, Local<Value> argv[]) override {
+    if (argc < 1 || !argv[0]->IsObject()) {
+      throw "Matrix.floodFill requires an options object";
+    }
+
+    Local<Object> obj = argv[0]->ToObject();
+    seedPoint = setPoint(obj->Get(Nan::New<String>("seedPoint").ToLocalChecked())->ToObject());
+    newColor = setColor(obj->Get(Nan::New<String>("newColor").ToLocalChecked())->ToObject());
+    loDiff = setColor(obj->Get(Nan::New<String>("loDiff").ToLocalChecked())->ToObject());
+    upDiff = setColor(obj->Get(Nan::New<String>("upDiff").ToLocalChecked())->ToObject());
+
+    Local<Value> objRect = obj->Get(Nan::New<String>("rect").ToLocalChecked());
+    if (!objRect->IsUndefined()) {
+      hasRect = setRect(objRect->ToObject(), rect) != 0;
+    }
+  }
+
+  void Run(const cv::Mat &src, cv::Mat &dst) override {
+    if (dst.data != src.data) {
+      src.copyTo(dst);
+    }
+    filled = cv::floodFill(dst, seedPoint, newColor, hasRect ? &rect : 0,
+        loDiff, upDiff, 4);
+  }
+
+  // Number of pixels filled
+  Local<Value> Result() override {
+    return Nan::New<Number>(filled);
+  }
+
+private:
+  cv::Point seedPoint;
+  cv::Scalar newColor;
+  cv::Scalar loDiff;
+  cv::Scalar upDiff;
+  bool hasRect;
+  cv::Rect rect;
+  int filled;
+};
+
+// Splits the trailing destination Matrix and callback off the arguments.
+// Returns the destination or NULL, and leaves `argc` at what the op parses.
+static Matrix* DstFromArgs(Nan::NAN_METHOD_ARGS_TYPE info, int &argc, int minDst) {
+  if (minDst >= 0 && argc > minDst && Matrix::HasInstance(info[argc - 1])) {
+    argc--;
+    return UNWRAP_ARG(Matrix, argc);
+  }
+  return NULL;
+}
+
+static void ParseArgs(MatrixOp *op, Nan::NAN_METHOD_ARGS_TYPE info, int argc) {
+  std::vector<Local<Value> > argv(argc);
+  for (int i = 0; i < argc; i++) {
+    argv[i] = info[i];
+  }
+  op->Parse(argc, argv.data());
+}
+
+// Runs an op on the main thread. In-place ops return null, the others what
+// their synchronous method always returned.
+template <class Op>
+static NAN_METHOD(RunOp) {
+  SETUP_FUNCTION(Matrix)
+
+  Op op;
+  int argc = info.Length();
+  Matrix *dst = DstFromArgs(info, argc, op.minDst);
+
+  try {
+    ParseArgs(&op, info, argc);
+  } catch (const char *msg) {
+    return Nan::ThrowTypeError(msg);
+  }
+
+  Matrix *target = dst ? dst : (op.output == MatrixOp::IN_PLACE ? self : NULL);
+  cv::Mat out;
+  if (target) {
+    target->MakeWritable();
+    out = target->mat;
+  }
+
+  try {
+    op.Run(op.WritesSource() ? self->mat.clone() : self->mat, out);
+  } catch (cv::Exception &e) {
+    return Nan::ThrowError(e.what());
+  }
+
+  if (target) {
+    target->mat = out;
+    target->UpdateExternalMemory();
+  }
+
+  Local<Value> result = op.Result();
+  if (!result.IsEmpty()) {
+    info.GetReturnValue().Set(result);
+  } else if (dst) {
+    info.GetReturnValue().Set(info[argc]);
+  } else if (op.output == MatrixOp::NEW_MATRIX) {
+    info.GetReturnValue().Set(Matrix::NewInstance(out));
+  } else {
+    info.GetReturnValue().Set(Nan::Null());
+  }
+}
+
+class MatrixOpWorker : public AsyncResultWorker {
+public:
+  // `src` is copied by header, so the pixels stay alive while the op runs.
+  MatrixOpWorker(MatrixOp *op, const cv::Mat &src, Matrix *target):
+    op(op), src(src), target(target) {
+    if (target) {
+      out = target->mat;
+    }
+  }
+
+  void Execute() override {
+    try {
+      op->Run(op->WritesSource() ? src.clone() : src, out);
+    } catch (cv::Exception &e) {
+      SetErrorMessage(e.what());
+    }
+  }
+
+protected:
+  // Resolves with what the op builds, or else the Matrix that received the
+  // image: the one called on, the destination, or a new one.
+  Local<Value> Result() override {
+    if (target) {
+      target->mat = out;
+      target->UpdateExternalMemory();
+    }
+
+    Local<Value> result = op->Result();
+    if (!result.IsEmpty()) {
+      return result;
+    }
+    if (target) {
+      return GetFromPersistent("target");
+    }
+    return Matrix::NewInstance(out);
+  }
+
+private:
+  std::unique_ptr<MatrixOp> op;
+  cv::Mat src;
+  cv::Mat out;
+  Matrix *target;
+};
+
+// Same arguments as the synchronous method, plus an optional callback.
+// Returns a Promise when there is none.
+template <class Op>
+static NAN_METHOD(QueueOp) {
+  SETUP_FUNCTION(Matrix)
+
+  int argc = info.Length();
+  int callbackIndex = -1;
+  if (argc > 0 && info[argc - 1]->IsFunction()) {
+    callbackIndex = --argc;
+  }
+
+  std::unique_ptr<Op> op(new Op());
+  Matrix *dst = DstFromArgs(info, argc, op->minDst);
+
+  try {
+    ParseArgs(op.get(), info, argc);
+  } catch (const char *msg) {
+    return Nan::ThrowTypeError(msg);
+  }
+
+  Matrix *target = dst ? dst : (op->output == MatrixOp::IN_PLACE ? self : NULL);
+  if (target) {
+    target->MakeWritable();
+  }
+  MatrixOpWorker *worker = NewAsyncResultWorker<MatrixOpWorker>(info,
+      callbackIndex, op.release(), self->mat, target);
+  // The source may be a view of memory its Matrix keeps alive.
+  worker->SaveToPersistent("source", info.This());
+  if (target) {
+    worker->SaveToPersistent("target", dst ? info[argc] : Local<Value>(info.This()));
+  }
+  // Matrix arguments, e.g. a kernel or a template, are held by header only,
+  // so the memory behind those made by fromBuffer() has to be kept too.
+  for (int i = 0; i < argc; i++) {
+    if (Matrix::HasInstance(info[i])) {
+      std::string key = "argument" + std::to_string(i);
+      worker->SaveToPersistent(key.c_str(),
+          Nan::ObjectWrap::Unwrap<Matrix>(info[i]->ToObject())->Backing());
+    }
+  }
+
+  WorkerPool::Queue(worker);
+}
+
+template <class Op>
+static MatrixOp* NewOp() {
+  return new Op();
+}
+
+#define MATRIX_OP(NAME, OP) { NAME, NewOp<OP>, RunOp<OP>, QueueOp<OP> }
+
+static const struct {
+  const char *name;
+  MatrixOp* (*create)();
+  Nan::FunctionCallback sync;
+  Nan::FunctionCallback async;
+} kMatrixOps[] = {
+  MATRIX_OP("resize", ResizeOp),
+  MATRIX_OP("cvtColor", CvtColorOp),
+  MATRIX_OP("convertGrayscale", ConvertGrayscaleOp),
+  MATRIX_OP("gaussianBlur", GaussianBlurOp),
+  MATRIX_OP("medianBlur", MedianBlurOp),
+  MATRIX_OP("bilateralFilter", BilateralFilterOp),
+  MATRIX_OP("canny", CannyOp),
+  MATRIX_OP("dilate", DilateOp),
+  MATRIX_OP("erode", ErodeOp),
+  MATRIX_OP("threshold", ThresholdOp),
+  MATRIX_OP("adaptiveThreshold", AdaptiveThresholdOp),
+  MATRIX_OP("warpAffine", WarpAffineOp),
+  MATRIX_OP("warpPerspective", WarpPerspectiveOp),
+  MATRIX_OP("pyrDown", PyrDownOp),
+  MATRIX_OP("pyrUp", PyrUpOp),
+  MATRIX_OP("inRange", InRangeOp),
+  MATRIX_OP("equalizeHist", EqualizeHistOp),
+  MATRIX_OP("brightness", BrightnessOp),
+  MATRIX_OP("lut", LutOp),
+  MATRIX_OP("gamma", GammaOp),
+  MATRIX_OP("levels", LevelsOp),
+  MATRIX_OP("houghLinesP", HoughLinesPOp),
+  MATRIX_OP("houghCircles", HoughCirclesOp),
+  MATRIX_OP("findContours", FindContoursOp),
+  MATRIX_OP("matchTemplate", MatchTemplateOp),
+  MATRIX_OP("floodFill", FloodFillOp)
+};
+
+static const size_t kMatrixOpCount = sizeof(kMatrixOps) / sizeof(kMatrixOps[0]);
+
+void MatrixOps::Init(Local<FunctionTemplate> ctor) {
+  for (size_t i = 0; i < kMatrixOpCount; i++) {
+    std::string async = std::string(kMatrixOps[i].name) + "Async";
+    Stats::SetPrototypeMethod(ctor, kMatrixOps[i].name, kMatrixOps[i].sync);
+    Stats::SetPrototypeMethod(ctor, async.c_str(), kMatrixOps[i].async);
+  }
+}
+
+MatrixOp* MatrixOps::Create(const std::string &name) {
+  for (size_t i = 0; i < kMatrixOpCount; i++) {
+    if (name == kMatrixOps[i].name) {
+      return kMatrixOps[i].create();
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,75 @@
+#ifndef __NODE_MATRIXOPS_H
+#define __NODE_MATRIXOPS_H
+
+#include "OpenCV.h"
+#include "Matrix.h"
+
+/**
+ * A Matrix method split into the part that needs V8 and the part that only
+ * touches cv::Mat, so that the OpenCV call can run on a worker thread.
+ *
+ * Every op is exposed twice on Matrix: `name(...)` runs on the main thread and
+ * `nameAsync(...)` runs on the WorkerPool threads, settling a Promise or the
+ * callback passed as last argument. Don't touch the matrix while an async call
+ * on it is pending.
+ */
+class MatrixOp {
+public:
+  enum Output {
+    IN_PLACE,    // result replaces the matrix the method was called on
+    NEW_MATRIX,  // result is returned as a new Matrix
+    NO_MATRIX    // result is whatever Result() builds
+  };
+
+  MatrixOp(Output output, int minDst): output(output), minDst(minDst) {}
+  virtual ~MatrixOp() {}
+
+  // Main thread. Reads the method arguments, without the destination Matrix
+  // and callback. Throws a const char* on bad input, like Rect::RawRect.
+  virtual void Parse(int argc, Local<Value> argv[]) {}
+
+  // Any thread. `dst` comes in as the destination's header, which may share
+  // pixels with `src`, and is what the destination holds afterwards. Throws
+  // cv::Exception on failure.
+  virtual void Run(const cv::Mat &src, cv::Mat &dst) = 0;
+
+  // Main thread, after Run(). Ops returning something other than the
+  // destination Matrix build it here; others return an empty handle.
+  virtual Local<Value> Result() {
+    return Local<Value>();
+  }
+
+  // Pixels of context the op needs around a region to compute it exactly, so
+  // that large images can be processed in tiles. -1 when the result can't be
+  // computed tile by tile: it depends on the whole image or has another size.
+  virtual int Halo() const {
+    return -1;
+  }
+
+  // Whether Run() writes over `src`. The Matrix methods and pipelines copy
+  // their input for such an op rather than change the Matrix they were given.
+  virtual bool WritesSource() const {
+    return false;
+  }
+
+  // Copy of the op as parsed. Compiled pipelines run copies so that several
+  // runs can be in flight at once.
+  virtual MatrixOp* Clone() const = 0;
+
+  const Output output;
+
+  // A trailing Matrix at this argument index or later is used as the
+  // destination instead of allocating one. -1 when the op takes none.
+  const int minDst;
+};
+
+class MatrixOps {
+public:
+  // Registers the sync and async method of every op on Matrix.prototype.
+  static void Init(Local<FunctionTemplate> ctor);
+
+  // Unparsed op for a Matrix method name, NULL if the method isn't an op.
+  static MatrixOp* Create(const std::string &name);
+};
+
+#endif
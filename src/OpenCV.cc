@@ -1,6 +1,12 @@
 #include "OpenCV.h"
+#include "Stats.h"
 #include "Matrix.h"
+#include "AsyncResultWorker.h"
+#include "WorkerPool.h"
+#include "ImageHeader.h"
+#include "DecodeCache.h"
 #include <nan.h>
+#include <memory>
 
 void OpenCV::Init(Local<Object> target) {
   Nan::HandleScope scope;
@@ -8,27 +14,142 @@ void OpenCV::Init(Local<Object> target) {
   // Version string.
   target->Set(Nan::New<String>("version").ToLocalChecked(), Nan::New<String>(CV_VERSION).ToLocalChecked());
 
-  Nan::SetMethod(target, "readImage", ReadImage);
-  Nan::SetMethod(target, "readImageMulti", ReadImageMulti);
+  Stats::SetMethod(target, "readImage", ReadImage);
+  Stats::SetMethod(target, "readImages", ReadImages);
+  Stats::SetMethod(target, "readImageMulti", ReadImageMulti);
 }
 
-class ReadImageAsyncWorker : public Nan::AsyncWorker {
+#if CV_MAJOR_VERSION > 3 || (CV_MAJOR_VERSION == 3 && CV_MINOR_VERSION >= 2)
+#define HAVE_IMREAD_REDUCED
+#endif
+
+int OpenCV::ImreadMode(Local<Value> mode) {
+  if (mode->IsNumber()) {
+    return mode->Int32Value();
+  }
+  if (mode->IsString()) {
+    std::string name = *Nan::Utf8String(mode);
+    if (name == "color") {
+      return cv::IMREAD_COLOR;
+    } else if (name == "grayscale") {
+      return cv::IMREAD_GRAYSCALE;
+    } else if (name == "unchanged") {
+      return cv::IMREAD_UNCHANGED;
+    }
+  }
+  throw "mode must be 'color', 'grayscale', 'unchanged' or imread flags";
+}
+
+void OpenCV::ParseReadOptions(Local<Object> options, ReadOptions &read) {
+  Local<Value> mode = options->Get(Nan::New<String>("mode").ToLocalChecked());
+  Local<Value> maxSize = options->Get(Nan::New<String>("maxSize").ToLocalChecked());
+
+  if (!mode->IsUndefined()) {
+    read.mode = OpenCV::ImreadMode(mode);
+  }
+
+  if (!maxSize->IsUndefined()) {
+    if (!maxSize->IsNumber() || maxSize->Int32Value() < 1) {
+      throw "maxSize must be a number >= 1";
+    }
+    read.maxSize = maxSize->Int32Value();
+  }
+}
+
+// The imread flags that make libjpeg scale a `largest` pixel wide JPEG down
+// by 2, 4 or 8 while decoding, as far as it stays at least `maxSize` wide.
+static int ReducedMode(int mode, int largest, int maxSize) {
+#ifdef HAVE_IMREAD_REDUCED
+  int factor = 8;
+  while (factor > 1 && largest / factor < maxSize) {
+    factor /= 2;
+  }
+  if (factor == 1) {
+    return mode;
+  }
+
+  if (mode == cv::IMREAD_COLOR) {
+    return factor == 2 ? cv::IMREAD_REDUCED_COLOR_2 :
+        factor == 4 ? cv::IMREAD_REDUCED_COLOR_4 : cv::IMREAD_REDUCED_COLOR_8;
+  }
+  if (mode == cv::IMREAD_GRAYSCALE) {
+    return factor == 2 ? cv::IMREAD_REDUCED_GRAYSCALE_2 :
+        factor == 4 ? cv::IMREAD_REDUCED_GRAYSCALE_4 : cv::IMREAD_REDUCED_GRAYSCALE_8;
+  }
+#endif
+  return mode;
+}
+
+// Reads an image from `path`, or when `data` is set, decodes `length` bytes
+// of an encoded image. Worker safe; throws cv::Exception.
+static cv::Mat Decode(const std::string &path, const uint8_t *data, size_t length,
+    const OpenCV::ReadOptions &options) {
+  int mode = options.mode;
+  if (options.maxSize > 0) {
+    // Other formats get decoded in full anyway, so they're only resized once
+    ImageHeader header;
+    bool known = data == nullptr ? header.Probe(path) : header.Probe(data, length);
+    if (known && strcmp(header.format, "jpeg") == 0) {
+      mode = ReducedMode(mode, std::max(header.width, header.height), options.maxSize);
+    }
+  }
+
+  cv::Mat mat;
+  if (data == nullptr) {
+    mat = cv::imread(path, mode);
+  } else {
+    // One byte per element: imdecode reads rows * cols * elemSize bytes
+    cv::Mat mbuf(1, length, CV_8UC1, const_cast<uint8_t *>(data));
+    mat = cv::imdecode(mbuf, mode);
+  }
+
+  int largest = std::max(mat.cols, mat.rows);
+  if (options.maxSize > 0 && largest > options.maxSize) {
+    double scale = (double) options.maxSize / largest;
+    cv::Size size(std::max(1, cvRound(mat.cols * scale)), std::max(1, cvRound(mat.rows * scale)));
+    cv::resize(mat, mat, size, 0, 0, cv::INTER_AREA);
+  }
+  return mat;
+}
+
+cv::Mat OpenCV::DecodeImage(const std::string &path, const uint8_t *data, size_t length,
+    const ReadOptions &options, bool &cached) {
+  std::string variant = std::to_string(options.mode) + "," + std::to_string(options.maxSize);
+  std::string key = data == nullptr ? DecodeCache::PathKey(path, variant) :
+      DecodeCache::BufferKey(data, length, variant);
+
+  cv::Mat mat;
+  if (DecodeCache::Get(key, mat)) {
+    cached = true;
+    return mat;
+  }
+
+  mat = Decode(path, data, length, options);
+  DecodeCache::Put(key, mat);
+  cached = !key.empty() && !mat.empty();
+  return mat;
+}
+
+Local<Object> OpenCV::NewImage(const cv::Mat &mat, bool cached) {
+  Local<Object> image = Matrix::NewInstance(mat);
+  if (cached) {
+    Nan::ObjectWrap::Unwrap<Matrix>(image)->SetCopyOnWrite();
+  }
+  return image;
+}
+
+class ReadImageAsyncWorker : public AsyncResultWorker {
 public:
-  ReadImageAsyncWorker(const std::string &path): Nan::AsyncWorker{nullptr}, path(path) {}
-  ReadImageAsyncWorker(const unsigned &length, uint8_t *data): Nan::AsyncWorker{nullptr}, length(length), data(data) {}
+  ReadImageAsyncWorker(const std::string &path): path(path) {}
+  ReadImageAsyncWorker(size_t length, uint8_t *data): length(length), data(data) {}
 
-  void SetImreadMode(cv::ImreadModes mode) {
-    this->mode = mode;
+  void SetOptions(const OpenCV::ReadOptions &options) {
+    this->options = options;
   }
 
   void Execute() override {
     try {
-      if (data == nullptr) {
-        mat = cv::imread(path, mode);
-      } else {
-        cv::Mat mbuf(length, 1, CV_64FC1, data);
-        mat = cv::imdecode(mbuf, mode);
-      }
+      mat = OpenCV::DecodeImage(path, data, length, options, cached);
     } catch (cv::Exception& e) {
       return SetErrorMessage(e.what());
     }
@@ -39,181 +160,304 @@ public:
   }
 
 protected:
-  void HandleOKCallback() override {
-    Nan::HandleScope scope;
+  Local<Value> Result() override {
+    return OpenCV::NewImage(mat, cached);
+  }
+
+private:
+    const std::string path;
 
-    Local<Object> m = Matrix::NewInstance();
-    UNWRAP_OBJ(Matrix, m)->mat = this->mat;
+    size_t length = 0;
+    uint8_t *data = nullptr;
 
-    OnSuccess(m);
-  }
+    OpenCV::ReadOptions options;
 
-  void HandleErrorCallback() override {
-    Nan::HandleScope scope;
+    cv::Mat mat;
+    bool cached = false;
+};
+
+// cv.readImage(pathOrBuffer[, { mode, maxSize }][, callback])
+NAN_METHOD(OpenCV::ReadImage) {
+  Nan::EscapableHandleScope scope;
 
-    OnFailure(Nan::Error(ErrorMessage()));
+  if (info.Length() < 1) {
+    return Nan::ThrowError("readImage requires at least 1 arguments");
   }
 
-protected:
-  virtual void OnSuccess(Local<Value> value) = 0;
-  virtual void OnFailure(Local<Value> error) = 0;
+  int callbackIndex = -1;
+  ReadOptions options;
+  if (info.Length() > 1 && info[1]->IsObject() && !info[1]->IsFunction()) {
+    try {
+      ParseReadOptions(info[1]->ToObject(), options);
+    } catch (const char *msg) {
+      return Nan::ThrowTypeError(msg);
+    }
+    if (info.Length() > 2) {
+      if (!info[2]->IsFunction()) {
+        return Nan::ThrowTypeError("Argument 3 must be a Function");
+      }
+      callbackIndex = 2;
+    }
+  } else if (info.Length() > 1) {
+    if (!info[1]->IsFunction()) {
+      return Nan::ThrowTypeError("Argument 2 must be a Function or an options object");
+    }
 
-private:
-    const std::string path = nullptr;
+    callbackIndex = 1;
+  }
 
-    unsigned length = 0;
-    uint8_t *data = nullptr;
+  ReadImageAsyncWorker *worker = nullptr;
+  if (info[0]->IsString()) {
+    std::string path = std::string(*Nan::Utf8String(info[0]->ToString()));
+    worker = NewAsyncResultWorker<ReadImageAsyncWorker>(info, callbackIndex, path);
+  } else if (Buffer::HasInstance(info[0])) {
+    size_t len = Buffer::Length(info[0]->ToObject());
+    uint8_t *data = (uint8_t *)Buffer::Data(info[0]->ToObject());
 
-    cv::ImreadModes mode = cv::IMREAD_COLOR;
+    worker = NewAsyncResultWorker<ReadImageAsyncWorker>(info, callbackIndex, len, data);
+    // The decoder reads straight from the Buffer
+    worker->SaveToPersistent("buffer", info[0]);
+  } else {
+    return Nan::ThrowTypeError("Argument 1 must be a string or a Buffer");
+  }
 
-    cv::Mat mat;
+  worker->SetOptions(options);
+  WorkerPool::Queue(worker);
+}
+
+class ReadImagesWorker;
+
+// State shared by the decodes of one readImages call.
+struct ReadBatch {
+  struct Item {
+    std::string path;
+    const uint8_t *data;
+    size_t length;
+  };
+
+  // Immutable once the batch is queued; Buffers are kept alive by `done`.
+  std::vector<Item> items;
+  OpenCV::ReadOptions options;
+
+  // Main thread only. `done` keeps the JS state ("results", "inputs",
+  // "onImage") and is queued once every item has settled.
+  WorkerPool::Lane lane;
+  size_t next;
+  size_t remaining;
+  ReadImagesWorker *done;
 };
 
-class CallbackReadImageAsyncWorker : public ReadImageAsyncWorker {
+// Settles the readImages call with the array of results.
+class ReadImagesWorker : public AsyncResultWorker {
 public:
-  CallbackReadImageAsyncWorker(const std::string &path): ReadImageAsyncWorker(path) {}
-  CallbackReadImageAsyncWorker(const unsigned &length, uint8_t *data): ReadImageAsyncWorker(length, data) {}
+  void Execute() override {}
 
 protected:
-  void OnSuccess(Local<Value> value) override {
-	Nan::HandleScope scope;
-
-    Local<Value> argv[2] = {Nan::Undefined(), value};
-    ExecuteCallback(2, argv);
+  Local<Value> Result() override {
+    return GetFromPersistent("results");
   }
+};
 
-  void OnFailure(Local<Value> error) override {
-	Nan::HandleScope scope;
+// Decodes one item, stores its Matrix or Error and queues the next item,
+// so that no more than `concurrency` decodes of a batch are in flight.
+class ReadItemWorker : public Nan::AsyncWorker {
+public:
+  ReadItemWorker(const std::shared_ptr<ReadBatch> &batch, size_t index):
+    Nan::AsyncWorker(nullptr), batch(batch), index(index) {}
 
-    Local<Value> argv[1] = {error};
-    ExecuteCallback(1, argv);
-  }
-private:
-  void ExecuteCallback(const int &argc, Local<Value> argv[]) {
-	Nan::HandleScope scope;
-    
-  	Local<Function> callback = Local<Function>::Cast(GetFromPersistent(0u));
+  void Execute() override {
+    const ReadBatch::Item &item = batch->items[index];
+    try {
+      mat = OpenCV::DecodeImage(item.path, item.data, item.length, batch->options, cached);
+    } catch (cv::Exception& e) {
+      return SetErrorMessage(e.what());
+    }
 
-    Nan::TryCatch try_catch;
-    callback->Call(Nan::GetCurrentContext()->Global(), argc, argv);
-    if (try_catch.HasCaught()) {
-      Nan::FatalException(try_catch);
+    if (mat.empty()) {
+      SetErrorMessage("Could not open or find the image");
     }
   }
-};
 
-class PromiseReadImageAsyncWorker : public ReadImageAsyncWorker {
-public:
-  PromiseReadImageAsyncWorker(const std::string &path): ReadImageAsyncWorker(path) {}
-  PromiseReadImageAsyncWorker(const unsigned &length, uint8_t *data): ReadImageAsyncWorker(length, data) {}
+  // Main thread.
+  static void QueueNext(const std::shared_ptr<ReadBatch> &batch) {
+    WorkerPool::Queue(new ReadItemWorker(batch, batch->next++), batch->lane);
+  }
 
 protected:
-  void OnSuccess(Local<Value> value) override {
-    GetPromise()->Resolve(Nan::GetCurrentContext(), value);
-    Isolate::GetCurrent()->RunMicrotasks();
+  void HandleOKCallback() override {
+    Nan::HandleScope scope;
+
+    Settle(Nan::Undefined(), OpenCV::NewImage(mat, cached));
   }
 
-  void OnFailure(Local<Value> error) override {
-    GetPromise()->Reject(Nan::GetCurrentContext(), error);
-    Isolate::GetCurrent()->RunMicrotasks();
+  void HandleErrorCallback() override {
+    Nan::HandleScope scope;
+
+    Settle(Nan::Error(ErrorMessage()), Nan::Undefined());
   }
+
 private:
-  Local<Promise::Resolver> GetPromise() {
-    return Local<Promise::Resolver>::Cast(GetFromPersistent(0u));
-  }
-};
+  void Settle(Local<Value> error, Local<Value> image) {
+    ReadImagesWorker *done = batch->done;
+    Local<Object> results = done->GetFromPersistent("results")->ToObject();
+    results->Set(index, error->IsUndefined() ? image : error);
 
-NAN_METHOD(OpenCV::ReadImage) {
-  Nan::EscapableHandleScope scope;
+    if (batch->next < batch->items.size()) {
+      QueueNext(batch);
+    }
 
-  if (info.Length() < 1) {
-    return Nan::ThrowError("readImage requires at least 1 arguments");
-  }
+    Local<Value> onImage = done->GetFromPersistent("onImage");
+    if (onImage->IsFunction()) {
+      Local<Value> argv[3] = {error, image, Nan::New<Number>(index)};
+      Nan::TryCatch try_catch;
+      Local<Function>::Cast(onImage)->Call(Nan::GetCurrentContext()->Global(), 3, argv);
+      if (try_catch.HasCaught()) {
+        Nan::FatalException(try_catch);
+      }
+    }
 
-  bool isCallback = false;
-  if (info.Length() > 1) {
-    if (!info[1]->IsFunction()) {
-      return Nan::ThrowTypeError("Argument 2 must be a Function");
+    if (--batch->remaining == 0) {
+      WorkerPool::Queue(done, batch->lane);
     }
+  }
+
+  std::shared_ptr<ReadBatch> batch;
+  size_t index;
+  cv::Mat mat;
+  bool cached = false;
+};
 
-    isCallback = true;
+// cv.readImages(inputs[, { concurrency: n, onImage: fn, mode, maxSize }][, callback])
+// `inputs` holds paths and Buffers. Settles with an array in input order
+// holding a Matrix, or an Error for each input that failed to decode;
+// onImage(err, image, index) sees every item as soon as it is decoded.
+NAN_METHOD(OpenCV::ReadImages) {
+  Nan::HandleScope scope;
+
+  int argc = info.Length();
+  int callbackIndex = -1;
+  if (argc > 0 && info[argc - 1]->IsFunction()) {
+    callbackIndex = --argc;
   }
 
-  ReadImageAsyncWorker *worker = nullptr;
-  if (info[0]->IsString()) {
-    std::string path = std::string(*Nan::Utf8String(info[0]->ToString()));
-    if (isCallback) {
-      worker = new CallbackReadImageAsyncWorker(path);
-    } else {
-      worker = new PromiseReadImageAsyncWorker(path);
+  if (argc < 1 || !info[0]->IsArray()) {
+    return Nan::ThrowTypeError("Argument 1 must be an array of strings and Buffers");
+  }
+  Local<Array> inputs = Local<Array>::Cast(info[0]);
+
+  std::shared_ptr<ReadBatch> batch(new ReadBatch());
+  size_t concurrency = WorkerPool::Threads();
+  Local<Value> onImage = Nan::Undefined();
+  if (argc > 1 && !info[1]->IsUndefined()) {
+    if (!info[1]->IsObject()) {
+      return Nan::ThrowTypeError("Options must be an object");
     }
-  } else if (Buffer::HasInstance(info[0])) {
-    unsigned len = Buffer::Length(info[0]->ToObject());
-    uint8_t *data = (uint8_t *)Buffer::Data(info[0]->ToObject());
+    Local<Object> options = info[1]->ToObject();
+    try {
+      ParseReadOptions(options, batch->options);
+    } catch (const char *msg) {
+      return Nan::ThrowTypeError(msg);
+    }
+    Local<Value> value = options->Get(Nan::New<String>("concurrency").ToLocalChecked());
+    if (!value->IsUndefined()) {
+      if (!value->IsNumber() || value->Int32Value() < 1) {
+        return Nan::ThrowTypeError("concurrency must be a number >= 1");
+      }
+      concurrency = value->Int32Value();
+    }
+    onImage = options->Get(Nan::New<String>("onImage").ToLocalChecked());
+    if (!onImage->IsUndefined() && !onImage->IsFunction()) {
+      return Nan::ThrowTypeError("onImage must be a function");
+    }
+  }
 
-    if (isCallback) {
-      worker = new CallbackReadImageAsyncWorker(len, data);
+  batch->items.resize(inputs->Length());
+  // A copy, so the caller can reuse the array
+  Local<Array> keep = Nan::New<Array>(inputs->Length());
+  for (uint32_t i = 0; i < inputs->Length(); i++) {
+    Local<Value> input = inputs->Get(i);
+    keep->Set(i, input);
+    ReadBatch::Item &item = batch->items[i];
+    if (input->IsString()) {
+      item.path = *Nan::Utf8String(input);
+      item.data = nullptr;
+      item.length = 0;
+    } else if (Buffer::HasInstance(input)) {
+      item.data = (const uint8_t *)Buffer::Data(input->ToObject());
+      item.length = Buffer::Length(input->ToObject());
     } else {
-      worker = new PromiseReadImageAsyncWorker(len, data);
+      return Nan::ThrowTypeError("Argument 1 must be an array of strings and Buffers");
     }
-  } else {
-    return Nan::ThrowTypeError("Argument 1 must be a string or a Buffer");
   }
 
-  if (isCallback) {
-    worker->SaveToPersistent(0u, info[1]);
-  } else {
-    Local<Promise::Resolver> resolver = Promise::Resolver::New(Nan::GetCurrentContext()).ToLocalChecked();
-    worker->SaveToPersistent(0u, resolver);
-    info.GetReturnValue().Set(resolver->GetPromise());
+  batch->lane = WorkerPool::CurrentLane();
+  batch->next = 0;
+  batch->remaining = batch->items.size();
+  batch->done = NewAsyncResultWorker<ReadImagesWorker>(info, callbackIndex);
+  batch->done->SaveToPersistent("results", Nan::New<Array>(batch->items.size()));
+  // The decoders read straight from the Buffers in here
+  batch->done->SaveToPersistent("inputs", keep);
+  batch->done->SaveToPersistent("onImage", onImage);
+
+  if (batch->items.empty()) {
+    WorkerPool::Queue(batch->done);
+    return;
+  }
+  while (batch->next < std::min(concurrency, batch->items.size())) {
+    ReadItemWorker::QueueNext(batch);
   }
-
-  Nan::AsyncQueueWorker(worker);
 }
 
 #if CV_MAJOR_VERSION >= 3
-NAN_METHOD(OpenCV::ReadImageMulti) {
-  Nan::EscapableHandleScope scope;
+class ReadImageMultiWorker : public AsyncResultWorker {
+public:
+  ReadImageMultiWorker(const std::string &path): path(path) {}
 
-  REQ_FUN_ARG(1, cb);
+  void Execute() override {
+    try {
+      cv::imreadmulti(path, mats);
+    } catch (cv::Exception& e) {
+      return SetErrorMessage(e.what());
+    }
 
-  Local<Value> argv[2];
-  argv[0] = Nan::Null();
+    if (mats.empty()) {
+      SetErrorMessage("Error loading file");
+    }
+  }
 
-  std::vector<cv::Mat> mats;
-  try {
-    if (info[0]->IsString()) {
-      std::string filename = std::string(*Nan::Utf8String(info[0]->ToString()));
-      cv::imreadmulti(filename, mats);
+protected:
+  // As readImageMulti always did
+  Local<Value> FailureResult() override {
+    return Nan::New<Array>();
+  }
 
-      if (mats.empty()) {
-        argv[0] = Nan::Error("Error loading file");
-      }
+  Local<Value> Result() override {
+    Local<Array> output = Nan::New<Array>(mats.size());
+    for (std::vector<cv::Mat>::size_type i = 0; i < mats.size(); i ++) {
+      output->Set(i, Matrix::NewInstance(mats[i]));
     }
-  } catch (cv::Exception& e) {
-    argv[0] = Nan::Error(e.what());
-    argv[1] = Nan::Null();
+    return output;
   }
 
-  Local <Array> output = Nan::New<Array>(mats.size());
-  argv[1] = output;
+private:
+  const std::string path;
+  std::vector<cv::Mat> mats;
+};
 
-  for (std::vector<cv::Mat>::size_type i = 0; i < mats.size(); i ++) {
-    Local<Object> im_h = Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-    Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(im_h);
-    img->mat = mats[i];
+// cv.readImageMulti(path, callback). Decodes every page at once; see
+// cv.readImagePages for one page at a time.
+NAN_METHOD(OpenCV::ReadImageMulti) {
+  Nan::HandleScope scope;
 
-    output->Set(i, im_h);
+  if (info.Length() < 2 || !info[1]->IsFunction()) {
+    return Nan::ThrowTypeError("Argument 2 must be a function");
   }
-
-  Nan::TryCatch try_catch;
-  cb->Call(Nan::GetCurrentContext()->Global(), 2, argv);
-
-  if (try_catch.HasCaught()) {
-    Nan::FatalException(try_catch);
+  if (!info[0]->IsString()) {
+    return Nan::ThrowTypeError("Path must be a string");
   }
 
-  return;
+  std::string filename = std::string(*Nan::Utf8String(info[0]->ToString()));
+  WorkerPool::Queue(NewAsyncResultWorker<ReadImageMultiWorker>(info, 1, filename));
 }
 #else
 NAN_METHOD(OpenCV::ReadImageMulti) {
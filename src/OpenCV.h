@@ -29,6 +29,7 @@
 #endif
 
 #include <string.h>
+#include <string>
 #include <nan.h>
 
 using namespace v8;
@@ -75,7 +76,36 @@ class OpenCV: public Nan::ObjectWrap {
 public:
   static void Init(Local<Object> target);
 
+  // How readImage, readImages and the ImageDecoder decode.
+  struct ReadOptions {
+    ReadOptions(): mode(cv::IMREAD_COLOR), maxSize(0) {}
+
+    // cv::imread flags
+    int mode;
+    // When > 0, images are scaled down to fit in maxSize x maxSize.
+    int maxSize;
+  };
+
+  // 'color', 'grayscale', 'unchanged' or a number of cv::imread flags.
+  // Throws a const char* on anything else.
+  static int ImreadMode(Local<Value> mode);
+
+  // { mode: 'color' | 'grayscale' | 'unchanged' | imread flags, maxSize: n }.
+  // Throws a const char* on bad input.
+  static void ParseReadOptions(Local<Object> options, ReadOptions &read);
+
+  // Reads an image from `path`, or when `data` is set, decodes `length`
+  // bytes of an encoded image, through the DecodeCache. `cached` tells
+  // whether the pixels are shared with the cache, and so must be copied
+  // before they are written to. Worker safe; throws cv::Exception.
+  static cv::Mat DecodeImage(const std::string &path, const uint8_t *data, size_t length,
+      const ReadOptions &options, bool &cached);
+
+  // New Matrix for an image from DecodeImage().
+  static Local<Object> NewImage(const cv::Mat &mat, bool cached);
+
   static NAN_METHOD(ReadImage);
+  static NAN_METHOD(ReadImages);
   static NAN_METHOD(ReadImageMulti);
 };
 
@@ -0,0 +1,222 @@
+#include "Pipeline.h"
+#include "Stats.h"
+#include "Matrix.h"
+#include "AsyncResultWorker.h"
+#include "WorkerPool.h"
+
+Nan::Persistent<FunctionTemplate> Pipeline::constructor;
+
+void Pipeline::Init(Local<Object> target) {
+  Nan::HandleScope scope;
+
+  Local<FunctionTemplate> ctor = Nan::New<FunctionTemplate>(Pipeline::New);
+  constructor.Reset(ctor);
+  ctor->InstanceTemplate()->SetInternalFieldCount(1);
+  ctor->SetClassName(Nan::New("Pipeline").ToLocalChecked());
+
+  Stats::SetPrototypeMethod(ctor, "run", Run);
+  Stats::SetPrototypeMethod(ctor, "runAsync", RunAsync);
+  Stats::SetPrototypeMethod(ctor, "length", Length);
+
+  target->Set(Nan::New("Pipeline").ToLocalChecked(), ctor->GetFunction());
+}
+
+bool Pipeline::HasInstance(Local<Value> object) {
+  return Nan::New(constructor)->HasInstance(object);
+}
+
+NAN_METHOD(Pipeline::New) {
+  Nan::HandleScope scope;
+
+  if (!info.IsConstructCall()) {
+    return Nan::ThrowTypeError("Cannot Instantiate without new");
+  }
+
+  Pipeline *pipeline = new Pipeline();
+  Local<Array> backings = Nan::New<Array>();
+  try {
+    Compile(info[0], pipeline->ops, backings);
+  } catch (const char *msg) {
+    delete pipeline;
+    return Nan::ThrowTypeError(msg);
+  }
+  pipeline->backings.Reset(backings);
+
+  pipeline->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+Pipeline::~Pipeline() {
+  backings.Reset();
+}
+
+void Pipeline::Compile(Local<Value> steps, MatrixOpList &ops, Local<Array> backings) {
+  if (!steps->IsArray()) {
+    throw "Pipeline takes an array of steps";
+  }
+
+  Local<Array> list = Local<Array>::Cast(steps);
+  if (list->Length() == 0) {
+    throw "Pipeline needs at least one step";
+  }
+
+  for (unsigned int i = 0; i < list->Length(); i++) {
+    Local<Value> step = list->Get(i);
+
+    // 'pyrDown' is short for ['pyrDown']
+    std::vector<Local<Value> > argv;
+    if (step->IsString()) {
+      argv.push_back(step);
+    } else if (step->IsArray() && Local<Array>::Cast(step)->Length() > 0) {
+      Local<Array> args = Local<Array>::Cast(step);
+      for (unsigned int j = 0; j < args->Length(); j++) {
+        argv.push_back(args->Get(j));
+      }
+    } else {
+      throw "Pipeline steps must be a method name or [name, ...args]";
+    }
+
+    if (!argv[0]->IsString()) {
+      throw "Pipeline steps must start with a method name";
+    }
+
+    std::unique_ptr<MatrixOp> op(MatrixOps::Create(*Nan::Utf8String(argv[0])));
+    if (!op) {
+      throw "Pipeline step is not a Matrix method that can run in a pipeline";
+    }
+
+    if (op->output == MatrixOp::NO_MATRIX && i != list->Length() - 1) {
+      throw "Steps that don't return an image can only come last";
+    }
+
+    op->Parse(argv.size() - 1, argv.data() + 1);
+    ops.push_back(std::move(op));
+
+    for (size_t j = 1; j < argv.size(); j++) {
+      if (Matrix::HasInstance(argv[j])) {
+        backings->Set(backings->Length(),
+            Nan::ObjectWrap::Unwrap<Matrix>(argv[j]->ToObject())->Backing());
+      }
+    }
+  }
+}
+
+cv::Mat Pipeline::Execute(const MatrixOpList &ops, const cv::Mat &src) {
+  cv::Mat image = src;
+  bool owned = false;
+
+  for (size_t i = 0; i < ops.size(); i++) {
+    MatrixOp *op = ops[i].get();
+
+    // The first step writes to a new buffer, later in-place steps reuse
+    // the intermediate image.
+    cv::Mat out;
+    if (owned && op->output == MatrixOp::IN_PLACE) {
+      out = image;
+    }
+    if (!owned && op->WritesSource()) {
+      image = image.clone();
+      owned = true;
+    }
+
+    op->Run(image, out);
+
+    if (op->output != MatrixOp::NO_MATRIX) {
+      image = out;
+      owned = true;
+    }
+  }
+
+  return image;
+}
+
+static void CloneOps(const MatrixOpList &ops, MatrixOpList &copy) {
+  for (size_t i = 0; i < ops.size(); i++) {
+    copy.push_back(std::unique_ptr<MatrixOp>(ops[i]->Clone()));
+  }
+}
+
+// The last step's return value, or else the final image.
+static Local<Value> PipelineResult(const MatrixOpList &ops, const cv::Mat &image) {
+  Local<Value> result = ops.back()->Result();
+  if (!result.IsEmpty()) {
+    return result;
+  }
+  return Matrix::NewInstance(image);
+}
+
+// pipeline.run(matrix)
+NAN_METHOD(Pipeline::Run) {
+  SETUP_FUNCTION(Pipeline)
+
+  if (info.Length() < 1 || !Matrix::HasInstance(info[0])) {
+    return Nan::ThrowTypeError("Argument 1 must be a Matrix");
+  }
+
+  Matrix *src = UNWRAP_ARG(Matrix, 0);
+  MatrixOpList ops;
+  CloneOps(self->ops, ops);
+
+  cv::Mat image;
+  try {
+    image = Execute(ops, src->mat);
+  } catch (cv::Exception &e) {
+    return Nan::ThrowError(e.what());
+  }
+
+  info.GetReturnValue().Set(PipelineResult(ops, image));
+}
+
+class PipelineWorker : public AsyncResultWorker {
+public:
+  PipelineWorker(const MatrixOpList &ops, const cv::Mat &src): src(src) {
+    CloneOps(ops, this->ops);
+  }
+
+  void Execute() override {
+    try {
+      image = Pipeline::Execute(ops, src);
+    } catch (cv::Exception &e) {
+      SetErrorMessage(e.what());
+    }
+  }
+
+protected:
+  Local<Value> Result() override {
+    return PipelineResult(ops, image);
+  }
+
+private:
+  MatrixOpList ops;
+  cv::Mat src;
+  cv::Mat image;
+};
+
+// pipeline.runAsync(matrix[, callback])
+NAN_METHOD(Pipeline::RunAsync) {
+  SETUP_FUNCTION(Pipeline)
+
+  if (info.Length() < 1 || !Matrix::HasInstance(info[0])) {
+    return Nan::ThrowTypeError("Argument 1 must be a Matrix");
+  }
+
+  int callbackIndex = -1;
+  if (info.Length() > 1 && info[1]->IsFunction()) {
+    callbackIndex = 1;
+  }
+
+  Matrix *src = UNWRAP_ARG(Matrix, 0);
+  PipelineWorker *worker = NewAsyncResultWorker<PipelineWorker>(info,
+      callbackIndex, self->ops, src->mat);
+  worker->SaveToPersistent("source", info[0]);
+  // The copies of the ops share its Matrix arguments
+  worker->SaveToPersistent("pipeline", info.This());
+
+  WorkerPool::Queue(worker);
+}
+
+NAN_METHOD(Pipeline::Length) {
+  SETUP_FUNCTION(Pipeline)
+
+  info.GetReturnValue().Set(Nan::New<Number>(self->ops.size()));
+}
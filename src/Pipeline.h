@@ -0,0 +1,63 @@
+#ifndef __NODE_PIPELINE_H
+#define __NODE_PIPELINE_H
+
+#include "OpenCV.h"
+#include "MatrixOps.h"
+
+#include <memory>
+#include <vector>
+
+typedef std::vector<std::unique_ptr<MatrixOp> > MatrixOpList;
+
+/**
+ * A chain of Matrix methods, parsed once and run as a whole:
+ *
+ *   var edges = new cv.Pipeline([
+ *     ['cvtColor', 'CV_BGR2GRAY'],
+ *     ['gaussianBlur', [5, 5]],
+ *     ['canny', 50, 150],
+ *     ['dilate', 2],
+ *     ['findContours']
+ *   ]);
+ *   edges.runAsync(frame).then(function(contours) { ... });
+ *
+ * Intermediate images never leave native memory and the input Matrix is not
+ * modified. The result is the last step's return value, or the final image
+ * when that step works in place. Steps that don't produce an image
+ * (findContours, houghLinesP, ...) can only come last.
+ */
+class Pipeline: public Nan::ObjectWrap {
+public:
+  static Nan::Persistent<FunctionTemplate> constructor;
+  static void Init(Local<Object> target);
+  static NAN_METHOD(New);
+
+  static bool HasInstance(Local<Value> object);
+
+  // Parses [[name, ...args], ...]. The ops hold Matrix arguments, e.g. a
+  // kernel, by header only, so what backs their memory is appended to
+  // `backings`, to be kept alive for as long as the ops. Throws a const
+  // char* on bad input.
+  static void Compile(Local<Value> steps, MatrixOpList &ops, Local<Array> backings);
+
+  // Runs every op on `src` and returns the final image. Worker safe.
+  static cv::Mat Execute(const MatrixOpList &ops, const cv::Mat &src);
+
+  // The compiled steps. Clone them before running.
+  const MatrixOpList &Ops() const {
+    return ops;
+  }
+
+  JSFUNC(Run)
+  JSFUNC(RunAsync)
+  JSFUNC(Length)
+
+  ~Pipeline();
+
+private:
+  MatrixOpList ops;
+  // What backs the Matrix arguments of the ops, see Compile().
+  Nan::Persistent<Array> backings;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "Point.h"
+#include "Stats.h"
 #include "OpenCV.h"
 
 Nan::Persistent<FunctionTemplate> Point::constructor;
@@ -18,7 +19,7 @@ void Point::Init(Local<Object> target) {
   Nan::SetNamedPropertyHandler(inst, PropertyGetter, PropertySetter, 0, 0, PropertyEnumerator);
 
   // Prototype Methods
-  Nan::SetPrototypeMethod(ctor, "dot", Dot);
+  Stats::SetPrototypeMethod(ctor, "dot", Dot);
 
 
   target->Set(Nan::New("Point").ToLocalChecked(), ctor->GetFunction());
@@ -1,4 +1,5 @@
 #include "Rect.h"
+#include "Stats.h"
 #include "Point.h"
 #include "Size.h"
 #include "OpenCV.h"
@@ -20,15 +21,15 @@ void Rect::Init(Local<Object> target) {
   inst->SetHandler(NamedPropertyHandlerConfiguration(PropertyGetter, PropertySetter, 0, 0, PropertyEnumerator));
 
   // Prototype Methods
-  Nan::SetPrototypeMethod(ctor, "tl", TopLeft);
-  Nan::SetPrototypeMethod(ctor, "br", BottomRight);
+  Stats::SetPrototypeMethod(ctor, "tl", TopLeft);
+  Stats::SetPrototypeMethod(ctor, "br", BottomRight);
 
-  Nan::SetPrototypeMethod(ctor, "size", Size);
-  Nan::SetPrototypeMethod(ctor, "area", Area);
+  Stats::SetPrototypeMethod(ctor, "size", Size);
+  Stats::SetPrototypeMethod(ctor, "area", Area);
 
-  Nan::SetPrototypeMethod(ctor, "contains", Contains);
+  Stats::SetPrototypeMethod(ctor, "contains", Contains);
 
-  Nan::SetPrototypeMethod(ctor, "toString", ToString);
+  Stats::SetPrototypeMethod(ctor, "toString", ToString);
 
 
   target->Set(Nan::New("Rect").ToLocalChecked(), ctor->GetFunction());
@@ -1,4 +1,5 @@
 #include "Scalar.h"
+#include "Stats.h"
 #include "OpenCV.h"
 
 Nan::Persistent<FunctionTemplate> Scalar::constructor;
@@ -18,9 +19,9 @@ void Scalar::Init(Local<Object> target) {
   Nan::SetIndexedPropertyHandler(inst, IndexGetter, IndexSetter, IndexQuery, 0, IndexEnumerator);
 
   // Prototype Methods
-  Nan::SetPrototypeMethod(ctor, "mul", Mul);
-  Nan::SetPrototypeMethod(ctor, "conj", Conj);
-  Nan::SetPrototypeMethod(ctor, "isReal", IsReal);
+  Stats::SetPrototypeMethod(ctor, "mul", Mul);
+  Stats::SetPrototypeMethod(ctor, "conj", Conj);
+  Stats::SetPrototypeMethod(ctor, "isReal", IsReal);
 
 
   Nan::Set(target, Nan::New("Scalar").ToLocalChecked(), ctor->GetFunction());
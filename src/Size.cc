@@ -1,4 +1,5 @@
 #include "Size.h"
+#include "Stats.h"
 #include "OpenCV.h"
 
 Nan::Persistent<FunctionTemplate> Size::constructor;
@@ -18,9 +19,9 @@ void Size::Init(Local<Object> target) {
   inst->SetHandler(NamedPropertyHandlerConfiguration(PropertyGetter, PropertySetter, 0, 0, PropertyEnumerator));
 
   // Prototype Methods
-  Nan::SetPrototypeMethod(ctor, "area", Area);
+  Stats::SetPrototypeMethod(ctor, "area", Area);
 
-  Nan::SetPrototypeMethod(ctor, "toString", ToString);
+  Stats::SetPrototypeMethod(ctor, "toString", ToString);
 
 
   Nan::Set(target, Nan::New("Size").ToLocalChecked(), ctor->GetFunction());
@@ -0,0 +1,387 @@
+#include "Stats.h"
+#include "Matrix.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Values below 2 * kSub get a bucket each, then every power of two is split
+// into kSub buckets, which keeps each within 12.5% of its values.
+static const int kSubBits = 3;
+static const int kSub = 1 << kSubBits;
+static const int kMaxExponent = 40;  // 2^40 us is about 12 days
+static const int kBuckets = 2 * kSub + (kMaxExponent - kSubBits) * kSub;
+
+class Histogram {
+public:
+  Histogram(): count(0), sum(0), max(0) {}
+
+  void Record(uint64_t value) {
+    if (buckets.empty()) {
+      buckets.resize(kBuckets);
+    }
+    buckets[Index(value)]++;
+    count++;
+    sum += value;
+    max = std::max(max, value);
+  }
+
+  void Reset() {
+    buckets.clear();
+    count = sum = max = 0;
+  }
+
+  // Upper bound of the bucket holding the p-th fraction of the values.
+  uint64_t Percentile(double p) const {
+    uint64_t rank = std::max((uint64_t) 1, (uint64_t) ceil(p * count));
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+      seen += buckets[i];
+      if (seen >= rank) {
+        return std::min(UpperBound(i), max);
+      }
+    }
+    return max;
+  }
+
+  Local<Object> ToObject(bool withBuckets) const {
+    Local<Object> obj = Nan::New<Object>();
+    Nan::Set(obj, Nan::New("count").ToLocalChecked(), Nan::New<Number>(count));
+    if (count == 0) {
+      return obj;
+    }
+
+    Nan::Set(obj, Nan::New("mean").ToLocalChecked(), Nan::New<Number>((double) sum / count));
+    Nan::Set(obj, Nan::New("p50").ToLocalChecked(), Nan::New<Number>(Percentile(0.5)));
+    Nan::Set(obj, Nan::New("p90").ToLocalChecked(), Nan::New<Number>(Percentile(0.9)));
+    Nan::Set(obj, Nan::New("p99").ToLocalChecked(), Nan::New<Number>(Percentile(0.99)));
+    Nan::Set(obj, Nan::New("max").ToLocalChecked(), Nan::New<Number>(max));
+
+    if (withBuckets) {
+      // [[upper bound, count], ...] for the buckets in use
+      Local<Array> list = Nan::New<Array>();
+      for (int i = 0, n = 0; i < kBuckets; i++) {
+        if (buckets[i] > 0) {
+          Local<Array> bucket = Nan::New<Array>(2);
+          Nan::Set(bucket, 0, Nan::New<Number>(UpperBound(i)));
+          Nan::Set(bucket, 1, Nan::New<Number>(buckets[i]));
+          Nan::Set(list, n++, bucket);
+        }
+      }
+      Nan::Set(obj, Nan::New("buckets").ToLocalChecked(), list);
+    }
+    return obj;
+  }
+
+  uint64_t count;
+
+private:
+  static int Index(uint64_t value) {
+    if (value < 2 * kSub) {
+      return (int) value;
+    }
+
+    int exponent = kSubBits + 1;
+    while (exponent < kMaxExponent && (value >> (exponent + 1)) != 0) {
+      exponent++;
+    }
+    if ((value >> (exponent + 1)) != 0) {
+      return kBuckets - 1;
+    }
+
+    int sub = (int) (value >> (exponent - kSubBits)) - kSub;
+    return 2 * kSub + (exponent - kSubBits - 1) * kSub + sub;
+  }
+
+  static uint64_t UpperBound(int index) {
+    if (index < 2 * kSub) {
+      return index;
+    }
+    int exponent = (index - 2 * kSub) / kSub + kSubBits + 1;
+    int sub = (index - 2 * kSub) % kSub;
+    uint64_t width = (uint64_t) 1 << (exponent - kSubBits);
+    return (kSub + sub) * width + width - 1;
+  }
+
+  std::vector<uint64_t> buckets;  // allocated on first use
+  uint64_t sum;
+  uint64_t max;
+};
+
+struct Stats::Binding {
+  enum Kind {
+    FUNCTION,
+    STATIC,
+    PROTOTYPE
+  };
+
+  Binding(const char *name, Nan::FunctionCallback callback, Kind kind):
+    name(name), callback(callback), kind(kind), calls(0), bytesIn(0), bytesOut(0),
+    liveMatrices(0), matrixBytes(0) {}
+
+  void Reset() {
+    calls = bytesIn = bytesOut = 0;
+    sync.Reset();
+    wait.Reset();
+    execute.Reset();
+  }
+
+  std::string name;
+  std::string label;  // "Matrix#cvtColor", set on the first call
+  Nan::FunctionCallback callback;
+  Kind kind;
+
+  uint64_t calls;
+  uint64_t bytesIn;
+  uint64_t bytesOut;
+  Histogram sync;
+  Histogram wait;
+  Histogram execute;
+
+  // Not cleared by Reset(), these follow the matrices.
+  int64_t liveMatrices;
+  int64_t matrixBytes;
+};
+
+// All main thread. Bindings live as long as the functions using them.
+static std::vector<Stats::Binding *> &bindings = *new std::vector<Stats::Binding *>();
+static bool enabled = false;
+static Stats::Binding *current = NULL;
+
+static int64_t liveMatrices = 0;
+static int64_t matrixBytes = 0;
+static int64_t peakMatrixBytes = 0;
+
+// Bytes of pixel or buffer data in a value.
+static uint64_t DataBytes(Local<Value> value) {
+  if (value.IsEmpty() || !value->IsObject()) {
+    return 0;
+  }
+  if (value->IsArrayBufferView()) {
+    return value.As<ArrayBufferView>()->ByteLength();
+  }
+  if (Matrix::HasInstance(value)) {
+    const cv::Mat &mat = UNWRAP_OBJ(Matrix, value->ToObject())->mat;
+    return mat.total() * mat.elemSize();
+  }
+  return 0;
+}
+
+static std::string Label(const Stats::Binding *binding, const v8::FunctionCallbackInfo<v8::Value> &args) {
+  Local<Object> self = args.This();
+
+  if (binding->kind == Stats::Binding::PROTOTYPE) {
+    return *Nan::Utf8String(self->GetConstructorName()) + ("#" + binding->name);
+  }
+  if (binding->kind == Stats::Binding::STATIC && self->IsFunction()) {
+    return *Nan::Utf8String(self.As<Function>()->GetName()) + ("." + binding->name);
+  }
+  return binding->name;
+}
+
+static void Trampoline(const v8::FunctionCallbackInfo<v8::Value> &args) {
+  Stats::Binding *binding = static_cast<Stats::Binding *>(args.Data().As<External>()->Value());
+  Nan::FunctionCallbackInfo<v8::Value> info(args, Nan::Undefined());
+
+  if (binding->label.empty()) {
+    binding->label = Label(binding, args);
+  }
+
+  // Current() is kept up to date even with stats off, for the Matrix
+  // accounting.
+  Stats::Binding *outer = current;
+  current = binding;
+
+  if (!enabled) {
+    binding->callback(info);
+    current = outer;
+    return;
+  }
+
+  uint64_t bytesIn = 0;
+  for (int i = 0; i < args.Length(); i++) {
+    bytesIn += DataBytes(args[i]);
+  }
+
+  uint64_t start = uv_hrtime();
+  binding->callback(info);
+  uint64_t elapsed = uv_hrtime() - start;
+  current = outer;
+
+  binding->calls++;
+  binding->bytesIn += bytesIn;
+  binding->bytesOut += DataBytes(args.GetReturnValue().Get());
+  binding->sync.Record(elapsed / 1000);
+}
+
+static Local<FunctionTemplate> NewTemplate(const char *name, Nan::FunctionCallback callback,
+    Stats::Binding::Kind kind, Local<Signature> signature = Local<Signature>()) {
+  Stats::Binding *binding = new Stats::Binding(name, callback, kind);
+  bindings.push_back(binding);
+
+  Local<FunctionTemplate> t = FunctionTemplate::New(Isolate::GetCurrent(), Trampoline,
+      Nan::New<External>(binding), signature);
+  t->SetClassName(Nan::New(name).ToLocalChecked());
+  return t;
+}
+
+void Stats::SetMethod(Local<Object> recv, const char *name, Nan::FunctionCallback callback) {
+  Nan::HandleScope scope;
+
+  Local<Function> fn = Nan::GetFunction(NewTemplate(name, callback, Binding::FUNCTION)).ToLocalChecked();
+  Local<String> fnName = Nan::New(name).ToLocalChecked();
+  fn->SetName(fnName);
+  Nan::Set(recv, fnName, fn);
+}
+
+void Stats::SetMethod(Local<FunctionTemplate> recv, const char *name, Nan::FunctionCallback callback) {
+  Nan::HandleScope scope;
+
+  recv->Set(Nan::New(name).ToLocalChecked(), NewTemplate(name, callback, Binding::STATIC));
+}
+
+void Stats::SetPrototypeMethod(Local<FunctionTemplate> recv, const char *name, Nan::FunctionCallback callback) {
+  Nan::HandleScope scope;
+
+  recv->PrototypeTemplate()->Set(Nan::New(name).ToLocalChecked(),
+      NewTemplate(name, callback, Binding::PROTOTYPE, Nan::New<Signature>(recv)));
+}
+
+bool Stats::Enabled() {
+  return enabled;
+}
+
+Stats::Binding *Stats::Current() {
+  return current;
+}
+
+Stats::Binding *Stats::SetCurrent(Binding *binding) {
+  Binding *previous = current;
+  current = binding;
+  return previous;
+}
+
+void Stats::TrackMatrix(Binding *site, int liveChange, int64_t bytesChange) {
+  liveMatrices += liveChange;
+  matrixBytes += bytesChange;
+  peakMatrixBytes = std::max(peakMatrixBytes, matrixBytes);
+
+  if (site) {
+    site->liveMatrices += liveChange;
+    site->matrixBytes += bytesChange;
+  }
+}
+
+void Stats::RecordJob(Binding *binding, uint64_t queued, uint64_t started, uint64_t finished) {
+  binding->wait.Record((started - queued) / 1000);
+  binding->execute.Record((finished - started) / 1000);
+}
+
+void Stats::Init(Local<Object> target) {
+  Nan::HandleScope scope;
+
+  const char *env = getenv("OPENCV_STATS");
+  enabled = env != NULL && *env != '\0' && strcmp(env, "0") != 0;
+
+  // Not through the trampoline, so they don't show up in their own output.
+  Nan::SetMethod(target, "enableStats", EnableStats);
+  Nan::SetMethod(target, "stats", GetStats);
+  Nan::SetMethod(target, "resetStats", ResetStats);
+  Nan::SetMethod(target, "matrixMemory", MatrixMemory);
+}
+
+// cv.enableStats([on = true])
+NAN_METHOD(Stats::EnableStats) {
+  Nan::HandleScope scope;
+
+  enabled = info.Length() < 1 || info[0]->BooleanValue();
+}
+
+// cv.stats([{ buckets: true }])
+NAN_METHOD(Stats::GetStats) {
+  Nan::HandleScope scope;
+
+  bool withBuckets = false;
+  if (info.Length() > 0 && info[0]->IsObject()) {
+    withBuckets = info[0]->ToObject()->Get(Nan::New("buckets").ToLocalChecked())->BooleanValue();
+  }
+
+  Local<Object> result = Nan::New<Object>();
+  for (size_t i = 0; i < bindings.size(); i++) {
+    const Binding *binding = bindings[i];
+    if (binding->calls == 0) {
+      continue;
+    }
+
+    Local<Object> entry = Nan::New<Object>();
+    Nan::Set(entry, Nan::New("calls").ToLocalChecked(), Nan::New<Number>(binding->calls));
+    Nan::Set(entry, Nan::New("bytesIn").ToLocalChecked(), Nan::New<Number>(binding->bytesIn));
+    Nan::Set(entry, Nan::New("bytesOut").ToLocalChecked(), Nan::New<Number>(binding->bytesOut));
+    Nan::Set(entry, Nan::New("sync").ToLocalChecked(), binding->sync.ToObject(withBuckets));
+
+    if (binding->wait.count > 0) {
+      Local<Object> async = Nan::New<Object>();
+      Nan::Set(async, Nan::New("wait").ToLocalChecked(), binding->wait.ToObject(withBuckets));
+      Nan::Set(async, Nan::New("execute").ToLocalChecked(), binding->execute.ToObject(withBuckets));
+      Nan::Set(entry, Nan::New("async").ToLocalChecked(), async);
+    }
+
+    Nan::Set(result, Nan::New(binding->label).ToLocalChecked(), entry);
+  }
+
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(Stats::ResetStats) {
+  Nan::HandleScope scope;
+
+  for (size_t i = 0; i < bindings.size(); i++) {
+    bindings[i]->Reset();
+  }
+}
+
+// cv.matrixMemory([{ resetPeak: true }])
+NAN_METHOD(Stats::MatrixMemory) {
+  Nan::HandleScope scope;
+
+  // Matrices made outside any binding, e.g. by JS subclasses
+  int64_t otherLive = liveMatrices;
+  int64_t otherBytes = matrixBytes;
+
+  Local<Object> sites = Nan::New<Object>();
+  for (size_t i = 0; i < bindings.size(); i++) {
+    const Binding *binding = bindings[i];
+    if (binding->liveMatrices == 0) {
+      continue;
+    }
+    otherLive -= binding->liveMatrices;
+    otherBytes -= binding->matrixBytes;
+
+    Local<Object> site = Nan::New<Object>();
+    Nan::Set(site, Nan::New("live").ToLocalChecked(), Nan::New<Number>(binding->liveMatrices));
+    Nan::Set(site, Nan::New("bytes").ToLocalChecked(), Nan::New<Number>(binding->matrixBytes));
+    Nan::Set(sites, Nan::New(binding->label).ToLocalChecked(), site);
+  }
+  if (otherLive != 0) {
+    Local<Object> site = Nan::New<Object>();
+    Nan::Set(site, Nan::New("live").ToLocalChecked(), Nan::New<Number>(otherLive));
+    Nan::Set(site, Nan::New("bytes").ToLocalChecked(), Nan::New<Number>(otherBytes));
+    Nan::Set(sites, Nan::New("(other)").ToLocalChecked(), site);
+  }
+
+  Local<Object> result = Nan::New<Object>();
+  Nan::Set(result, Nan::New("live").ToLocalChecked(), Nan::New<Number>(liveMatrices));
+  Nan::Set(result, Nan::New("bytes").ToLocalChecked(), Nan::New<Number>(matrixBytes));
+  Nan::Set(result, Nan::New("peakBytes").ToLocalChecked(), Nan::New<Number>(peakMatrixBytes));
+  Nan::Set(result, Nan::New("sites").ToLocalChecked(), sites);
+
+  if (info.Length() > 0 && info[0]->IsObject() &&
+      info[0]->ToObject()->Get(Nan::New("resetPeak").ToLocalChecked())->BooleanValue()) {
+    peakMatrixBytes = matrixBytes;
+  }
+
+  info.GetReturnValue().Set(result);
+}
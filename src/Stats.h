@@ -0,0 +1,66 @@
+#ifndef __NODE_STATS_H
+#define __NODE_STATS_H
+
+#include "OpenCV.h"
+
+#include <stdint.h>
+
+/**
+ * Opt-in timings of every method the add-on exports, and accounting of the
+ * memory held by Matrix objects.
+ *
+ *   cv.enableStats(true);      // or start node with OPENCV_STATS=1
+ *   ...
+ *   cv.stats()['Matrix#cvtColor'];
+ *   // { calls, bytesIn, bytesOut, sync: { count, mean, p50, p90, p99, max },
+ *   //   async: { wait: {...}, execute: {...} } }
+ *   cv.resetStats();
+ *
+ * Methods are registered through Stats::SetMethod and Stats::SetPrototypeMethod
+ * instead of Nan's, which put a trampoline in front of the callback. While
+ * stats are off the trampoline only notes which method is running. While they are on it times
+ * the call, and the WorkerPool times the jobs a call queues: how long they
+ * waited for a thread and how long they ran. Times go into log-linear
+ * histograms with 8 buckets per power of two, in microseconds.
+ *
+ *   cv.matrixMemory();
+ *   // { live, bytes, peakBytes, sites: { 'Matrix#resize': { live, bytes } } }
+ *
+ * Matrix memory is always counted, per binding that created the matrices.
+ * Bytes are the pixels each Matrix references, as reported to V8, so a view
+ * counts the region it covers again.
+ */
+class Stats {
+public:
+  struct Binding;
+
+  static void Init(Local<Object> target);
+
+  // Drop-in replacements for Nan::SetMethod and Nan::SetPrototypeMethod.
+  static void SetMethod(Local<Object> recv, const char *name, Nan::FunctionCallback callback);
+  static void SetMethod(Local<FunctionTemplate> recv, const char *name, Nan::FunctionCallback callback);
+  static void SetPrototypeMethod(Local<FunctionTemplate> recv, const char *name, Nan::FunctionCallback callback);
+
+  static bool Enabled();
+
+  // Main thread. The method being called, or while a worker completes, the
+  // method that queued it. NULL otherwise.
+  static Binding *Current();
+
+  // Main thread. Makes `binding` current and returns the one it replaces.
+  static Binding *SetCurrent(Binding *binding);
+
+  // Main thread. Pixel accounting for Matrix wrappers, always on: `site` is
+  // the Current() binding when the Matrix was created.
+  static void TrackMatrix(Binding *site, int liveChange, int64_t bytesChange);
+
+  // Main thread. Records a job queued by `binding`; times come from uv_hrtime.
+  static void RecordJob(Binding *binding, uint64_t queued, uint64_t started, uint64_t finished);
+
+  static NAN_METHOD(EnableStats);
+  static NAN_METHOD(GetStats);
+  static NAN_METHOD(ResetStats);
+  static NAN_METHOD(MatrixMemory);
+};
+
+#endif
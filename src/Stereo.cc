@@ -1,5 +1,6 @@
 
 #include "Stereo.h"
+#include "Stats.h"
 
 #if CV_MAJOR_VERSION >= 3
 #ifdef __GNUC__
@@ -25,7 +26,7 @@ void StereoBM::Init(Local<Object> target) {
   ctor->InstanceTemplate()->SetInternalFieldCount(1);
   ctor->SetClassName(Nan::New("StereoBM").ToLocalChecked());
 
-  Nan::SetPrototypeMethod(ctor, "compute", Compute);
+  Stats::SetPrototypeMethod(ctor, "compute", Compute);
 
   ctor->Set(Nan::New<String>("BASIC_PRESET").ToLocalChecked(), Nan::New<Integer>((int)cv::StereoBM::BASIC_PRESET));
   ctor->Set(Nan::New<String>("FISH_EYE_PRESET").ToLocalChecked(), Nan::New<Integer>((int)cv::StereoBM::FISH_EYE_PRESET));
@@ -92,10 +93,7 @@ NAN_METHOD(StereoBM::Compute) {
     self->stereo(left, right, disparity, type);
 
     // Wrap the returned disparity map
-    Local < Object > disparityWrap =
-        Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-    Matrix *disp = Nan::ObjectWrap::Unwrap<Matrix>(disparityWrap);
-    disp->mat = disparity;
+    Local < Object > disparityWrap = Matrix::NewInstance(disparity);
 
     info.GetReturnValue().Set(disparityWrap);
 
@@ -117,7 +115,7 @@ void StereoSGBM::Init(Local<Object> target) {
   ctor->InstanceTemplate()->SetInternalFieldCount(1);
   ctor->SetClassName(Nan::New("StereoSGBM").ToLocalChecked());
 
-  Nan::SetPrototypeMethod(ctor, "compute", Compute);
+  Stats::SetPrototypeMethod(ctor, "compute", Compute);
 
   target->Set(Nan::New("StereoSGBM").ToLocalChecked(), ctor->GetFunction());
 }
@@ -227,10 +225,7 @@ NAN_METHOD(StereoSGBM::Compute) {
     self->stereo(left, right, disparity);
 
     // Wrap the returned disparity map
-    Local < Object > disparityWrap =
-        Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-    Matrix *disp = Nan::ObjectWrap::Unwrap<Matrix>(disparityWrap);
-    disp->mat = disparity;
+    Local < Object > disparityWrap = Matrix::NewInstance(disparity);
 
     info.GetReturnValue().Set(disparityWrap);
   } catch (cv::Exception &e) {
@@ -252,7 +247,7 @@ void StereoGC::Init(Local<Object> target) {
   ctor->InstanceTemplate()->SetInternalFieldCount(1);
   ctor->SetClassName(Nan::New("StereoGC").ToLocalChecked());
 
-  Nan::SetPrototypeMethod(ctor, "compute", Compute);
+  Stats::SetPrototypeMethod(ctor, "compute", Compute);
 
   target->Set(Nan::New("StereoGC").ToLocalChecked(), ctor->GetFunction());
 }
@@ -311,10 +306,7 @@ NAN_METHOD(StereoGC::Compute) {
     disp16.convertTo(disparity, CV_8U, -16);
 
     // Wrap the returned disparity map
-    Local < Object > disparityWrap =
-        Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-    Matrix *disp = Nan::ObjectWrap::Unwrap<Matrix>(disparityWrap);
-    disp->mat = disparity;
+    Local < Object > disparityWrap = Matrix::NewInstance(disparity);
 
     info.GetReturnValue().Set(disparityWrap);
   } catch (cv::Exception &e) {
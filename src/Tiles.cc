@@ -0,0 +1,270 @@
+#include "Tiles.h"
+#include "Stats.h"
+#include "Matrix.h"
+#include "Pipeline.h"
+#include "AsyncResultWorker.h"
+#include "WorkerPool.h"
+#include <memory>
+#include <mutex>
+
+static const int kDefaultTileSize = 512;
+
+void Tiles::Init(Local<FunctionTemplate> ctor) {
+  Stats::SetPrototypeMethod(ctor, "tiles", GetTiles);
+  Stats::SetPrototypeMethod(ctor, "processTiles", ProcessTiles);
+}
+
+std::vector<cv::Rect> Tiles::Split(const cv::Size &size, const cv::Size &tile) {
+  std::vector<cv::Rect> tiles;
+  for (int y = 0; y < size.height; y += tile.height) {
+    for (int x = 0; x < size.width; x += tile.width) {
+      tiles.push_back(cv::Rect(x, y, std::min(tile.width, size.width - x),
+          std::min(tile.height, size.height - y)));
+    }
+  }
+  return tiles;
+}
+
+cv::Rect Tiles::WithHalo(const cv::Rect &rect, int halo, const cv::Size &size) {
+  cv::Rect grown(rect.x - halo, rect.y - halo, rect.width + 2 * halo, rect.height + 2 * halo);
+  return grown & cv::Rect(cv::Point(0, 0), size);
+}
+
+// { tile: [w, h] or n, overlap: n }. Throws a const char* on bad input.
+static void ParseOptions(Local<Value> arg, cv::Size &tile, int &overlap) {
+  tile = cv::Size(kDefaultTileSize, kDefaultTileSize);
+  overlap = 0;
+
+  if (arg->IsUndefined()) {
+    return;
+  }
+  if (!arg->IsObject() || arg->IsFunction()) {
+    throw "Options must be an object";
+  }
+
+  Local<Object> options = arg->ToObject();
+  Local<Value> tileValue = options->Get(Nan::New<String>("tile").ToLocalChecked());
+  Local<Value> overlapValue = options->Get(Nan::New<String>("overlap").ToLocalChecked());
+
+  if (tileValue->IsNumber()) {
+    tile = cv::Size(tileValue->Int32Value(), tileValue->Int32Value());
+  } else if (tileValue->IsArray()) {
+    Local<Object> size = tileValue->ToObject();
+    tile = cv::Size(size->Get(0)->Int32Value(), size->Get(1)->Int32Value());
+  } else if (!tileValue->IsUndefined()) {
+    throw "tile must be a number or a [width, height] array";
+  }
+
+  if (tile.width <= 0 || tile.height <= 0) {
+    throw "tile must be > 0";
+  }
+
+  if (!overlapValue->IsUndefined()) {
+    overlap = overlapValue->Int32Value();
+    if (overlap < 0) {
+      throw "overlap must be >= 0";
+    }
+  }
+}
+
+static Local<Object> RectObject(const cv::Rect &rect) {
+  Local<Object> obj = Nan::New<Object>();
+  obj->Set(Nan::New<String>("x").ToLocalChecked(), Nan::New<Number>(rect.x));
+  obj->Set(Nan::New<String>("y").ToLocalChecked(), Nan::New<Number>(rect.y));
+  obj->Set(Nan::New<String>("width").ToLocalChecked(), Nan::New<Number>(rect.width));
+  obj->Set(Nan::New<String>("height").ToLocalChecked(), Nan::New<Number>(rect.height));
+  return obj;
+}
+
+// img.tiles({ tile: [512, 512], overlap: 8 })
+NAN_METHOD(Tiles::GetTiles) {
+  SETUP_FUNCTION(Matrix)
+
+  cv::Size tile;
+  int overlap;
+  try {
+    ParseOptions(info[0], tile, overlap);
+  } catch (const char *msg) {
+    return Nan::ThrowTypeError(msg);
+  }
+
+  std::vector<cv::Rect> rects = Split(self->mat.size(), tile);
+  Local<Array> tiles = Nan::New<Array>(rects.size());
+
+  for (size_t i = 0; i < rects.size(); i++) {
+    cv::Rect halo = WithHalo(rects[i], overlap, self->mat.size());
+
+    Local<Object> view = Matrix::NewInstance(self->mat(halo));
+    Nan::ObjectWrap::Unwrap<Matrix>(view)->ShareBacking(self);
+
+    Local<Object> item = Nan::New<Object>();
+    item->Set(Nan::New<String>("rect").ToLocalChecked(), RectObject(rects[i]));
+    item->Set(Nan::New<String>("halo").ToLocalChecked(), RectObject(halo));
+    item->Set(Nan::New<String>("matrix").ToLocalChecked(), view);
+    tiles->Set(i, item);
+  }
+
+  info.GetReturnValue().Set(tiles);
+}
+
+class StitchWorker;
+
+// State shared by the jobs of one processTiles call.
+struct TileJob {
+  explicit TileJob(const cv::Mat &src): src(src), remaining(0), done(NULL) {}
+
+  cv::Mat src;
+
+  // Guarded by mutex. The result is allocated by the first tile to finish,
+  // since only then its type is known.
+  std::mutex mutex;
+  cv::Mat dst;
+  std::string error;
+
+  // Main thread only. `done` is queued once every tile has finished.
+  int remaining;
+  StitchWorker *done;
+};
+
+class TileWorker : public Nan::AsyncWorker {
+public:
+  TileWorker(const std::shared_ptr<TileJob> &job, const MatrixOpList &ops,
+      const cv::Rect &rect, const cv::Rect &halo):
+    Nan::AsyncWorker(nullptr), job(job), rect(rect), halo(halo) {
+    for (size_t i = 0; i < ops.size(); i++) {
+      this->ops.push_back(std::unique_ptr<MatrixOp>(ops[i]->Clone()));
+    }
+  }
+
+  void Execute() override {
+    try {
+      cv::Mat result = Pipeline::Execute(ops, job->src(halo));
+      if (result.size() != halo.size()) {
+        return Fail("A step changed the tile size");
+      }
+
+      // Drop the halo and write the tile into its place in the result.
+      cv::Mat inner = result(rect - halo.tl());
+      cv::Mat target;
+      {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        if (job->dst.empty()) {
+          job->dst.create(job->src.size(), inner.type());
+        }
+        if (job->dst.type() != inner.type()) {
+          job->error = "Tiles came out with different types";
+          return;
+        }
+        target = job->dst(rect);
+      }
+      inner.copyTo(target);
+    } catch (cv::Exception &e) {
+      Fail(e.what());
+    }
+  }
+
+protected:
+  void HandleOKCallback() override;
+
+private:
+  void Fail(const std::string &error) {
+    std::lock_guard<std::mutex> lock(job->mutex);
+    if (job->error.empty()) {
+      job->error = error;
+    }
+  }
+
+  std::shared_ptr<TileJob> job;
+  MatrixOpList ops;
+  cv::Rect rect;
+  cv::Rect halo;
+};
+
+// Settles the processTiles call once every tile is in place.
+class StitchWorker : public AsyncResultWorker {
+public:
+  explicit StitchWorker(const std::shared_ptr<TileJob> &job): job(job) {}
+
+  void Execute() override {
+    std::lock_guard<std::mutex> lock(job->mutex);
+    if (!job->error.empty()) {
+      SetErrorMessage(job->error.c_str());
+    }
+  }
+
+protected:
+  Local<Value> Result() override {
+    return Matrix::NewInstance(job->dst);
+  }
+
+private:
+  std::shared_ptr<TileJob> job;
+};
+
+void TileWorker::HandleOKCallback() {
+  if (--job->remaining == 0) {
+    WorkerPool::Queue(job->done);
+  }
+}
+
+// img.processTiles(steps[, { tile: [w, h], overlap: n }][, callback])
+// `steps` is a cv.Pipeline or the array a Pipeline takes.
+NAN_METHOD(Tiles::ProcessTiles) {
+  SETUP_FUNCTION(Matrix)
+
+  int argc = info.Length();
+  int callbackIndex = -1;
+  if (argc > 0 && info[argc - 1]->IsFunction()) {
+    callbackIndex = --argc;
+  }
+
+  if (self->mat.empty()) {
+    return Nan::ThrowError("Matrix is empty");
+  }
+
+  MatrixOpList compiled;
+  const MatrixOpList *ops = &compiled;
+  // What keeps the Matrix arguments of the ops alive: the Pipeline, or what
+  // Compile() collected.
+  Local<Value> keep;
+  cv::Size tile;
+  int overlap;
+  try {
+    if (argc > 0 && Pipeline::HasInstance(info[0])) {
+      ops = &Nan::ObjectWrap::Unwrap<Pipeline>(info[0]->ToObject())->Ops();
+      keep = info[0];
+    } else {
+      Local<Array> backings = Nan::New<Array>();
+      Pipeline::Compile(argc > 0 ? info[0] : Local<Value>(Nan::Undefined()), compiled, backings);
+      keep = backings;
+    }
+    ParseOptions(argc > 1 ? info[1] : Local<Value>(Nan::Undefined()), tile, overlap);
+  } catch (const char *msg) {
+    return Nan::ThrowTypeError(msg);
+  }
+
+  // Each step needs its halo on top of what the steps after it need.
+  int halo = 0;
+  for (size_t i = 0; i < ops->size(); i++) {
+    int needed = (*ops)[i]->Halo();
+    if (needed < 0) {
+      return Nan::ThrowTypeError("Steps that change the image size or depend "
+          "on the whole image can't run tile by tile");
+    }
+    halo += needed;
+  }
+  halo = std::max(halo, overlap);
+
+  std::shared_ptr<TileJob> job(new TileJob(self->mat));
+  std::vector<cv::Rect> rects = Split(self->mat.size(), tile);
+
+  job->done = NewAsyncResultWorker<StitchWorker>(info, callbackIndex, job);
+  job->done->SaveToPersistent("source", info.This());
+  job->done->SaveToPersistent("pipeline", keep);
+  job->remaining = rects.size();
+
+  for (size_t i = 0; i < rects.size(); i++) {
+    WorkerPool::Queue(new TileWorker(job, *ops, rects[i],
+        WithHalo(rects[i], halo, self->mat.size())));
+  }
+}
@@ -0,0 +1,38 @@
+#ifndef __NODE_TILES_H
+#define __NODE_TILES_H
+
+#include "OpenCV.h"
+
+#include <vector>
+
+/**
+ * Processing of large images tile by tile.
+ *
+ *   img.tiles({ tile: [512, 512], overlap: 8 });
+ *   // [{ rect, halo, matrix }, ...]: matrix is a roi() view of the halo rect
+ *
+ *   img.processTiles([['gaussianBlur', [9, 9]], ['dilate', 2]], { tile: [1024, 1024] })
+ *     .then(function(result) { ... });
+ *
+ * processTiles runs the steps on every tile plus a halo of surrounding pixels,
+ * each tile as a separate job on the WorkerPool, and writes the inner part of
+ * every result into one new Matrix. The halo is at least what the steps need
+ * (MatrixOp::Halo), so the result is the same as running the steps on the
+ * whole image. Steps that can't be computed per tile are rejected.
+ */
+class Tiles {
+public:
+  // Registers tiles and processTiles on Matrix.prototype.
+  static void Init(Local<FunctionTemplate> ctor);
+
+  // Tiles of at most `tile` covering `size`, row by row.
+  static std::vector<cv::Rect> Split(const cv::Size &size, const cv::Size &tile);
+
+  // `rect` grown by `halo` on each side, clipped to `size`.
+  static cv::Rect WithHalo(const cv::Rect &rect, int halo, const cv::Size &size);
+
+  static NAN_METHOD(GetTiles);
+  static NAN_METHOD(ProcessTiles);
+};
+
+#endif
@@ -1,8 +1,16 @@
 #include "VideoCaptureWrap.h"
+#include "Stats.h"
 #include "Matrix.h"
 #include "OpenCV.h"
+#include "WorkerPool.h"
+#include "AsyncResultWorker.h"
 
 #include  <iostream>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 Nan::Persistent<FunctionTemplate> VideoCaptureWrap::constructor;
 
@@ -27,16 +35,21 @@ void VideoCaptureWrap::Init(Local<Object> target) {
   // Prototype
   //Local<ObjectTemplate> proto = constructor->PrototypeTemplate();
 
-  Nan::SetPrototypeMethod(ctor, "read", Read);
-  Nan::SetPrototypeMethod(ctor, "setWidth", SetWidth);
-  Nan::SetPrototypeMethod(ctor, "setHeight", SetHeight);
-  Nan::SetPrototypeMethod(ctor, "setPosition", SetPosition);
-  Nan::SetPrototypeMethod(ctor, "getFrameAt", GetFrameAt);
-  Nan::SetPrototypeMethod(ctor, "getFrameCount", GetFrameCount);
-  Nan::SetPrototypeMethod(ctor, "release", Release);
-  Nan::SetPrototypeMethod(ctor, "ReadSync", ReadSync);
-  Nan::SetPrototypeMethod(ctor, "grab", Grab);
-  Nan::SetPrototypeMethod(ctor, "retrieve", Retrieve);
+  Stats::SetPrototypeMethod(ctor, "read", Read);
+  Stats::SetPrototypeMethod(ctor, "setWidth", SetWidth);
+  Stats::SetPrototypeMethod(ctor, "setHeight", SetHeight);
+  Stats::SetPrototypeMethod(ctor, "setPosition", SetPosition);
+  Stats::SetPrototypeMethod(ctor, "getFrameAt", GetFrameAt);
+  Stats::SetPrototypeMethod(ctor, "getFrameCount", GetFrameCount);
+  Stats::SetPrototypeMethod(ctor, "release", Release);
+  Stats::SetPrototypeMethod(ctor, "ReadSync", ReadSync);
+  Stats::SetPrototypeMethod(ctor, "grab", Grab);
+  Stats::SetPrototypeMethod(ctor, "retrieve", Retrieve);
+  Stats::SetPrototypeMethod(ctor, "startCapture", StartCapture);
+  Stats::SetPrototypeMethod(ctor, "stopCapture", StopCapture);
+  Stats::SetPrototypeMethod(ctor, "captureStats", CaptureStats);
+  Stats::SetPrototypeMethod(ctor, "setFramePool", SetFramePool);
+  Stats::SetPrototypeMethod(ctor, "framePoolStats", FramePoolStats);
 
   target->Set(Nan::New("VideoCapture").ToLocalChecked(), ctor->GetFunction());
 }
@@ -61,7 +74,83 @@ NAN_METHOD(VideoCaptureWrap::New) {
   info.GetReturnValue().Set(info.This());
 }
 
-VideoCaptureWrap::VideoCaptureWrap(int device) {
+// cap belongs to the capture thread while it runs.
+#define REQ_NOT_CAPTURING(V) \
+  if ((V)->ring) return Nan::ThrowError("Not while capturing, call stopCapture() first"); \
+  if ((V)->stopping) return Nan::ThrowError("Capture is stopping, wait for the stopCapture() callback");
+
+/**
+ * Keeps hold of up to `size` of the frames handed to JS, and reads into
+ * them again once JS is done with them, that is once nothing but the pool
+ * holds on to their pixels: the Matrix was collected, released with
+ * release(), or read into with read(frame, cb). Capture then runs in the
+ * same few buffers instead of allocating every frame:
+ *
+ *   cap.setFramePool({ size: 4 });
+ *   cap.framePoolStats(); // { size, lent, reused, allocated }
+ *
+ * Frames still in use when the pool is full are left to the GC.
+ */
+class FramePool {
+public:
+  FramePool(): size(0), reused(0), allocated(0) {}
+
+  void Configure(size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->size = size;
+    if (lent.size() > size) {
+      lent.resize(size);
+    }
+  }
+
+  // A frame JS is done with, or an empty Mat to read into.
+  cv::Mat Take() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (size == 0) {
+      return cv::Mat();
+    }
+    for (size_t i = 0; i < lent.size(); i++) {
+      if (!Matrix::IsShared(lent[i])) {
+        cv::Mat frame = lent[i];
+        lent.erase(lent.begin() + i);
+        reused++;
+        return frame;
+      }
+    }
+    allocated++;
+    return cv::Mat();
+  }
+
+  // Keeps track of a frame going to JS.
+  void Lend(const cv::Mat &frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!frame.empty() && lent.size() < size) {
+      lent.push_back(frame);
+    }
+  }
+
+  Local<Object> ToObject() {
+    Nan::EscapableHandleScope scope;
+
+    Local<Object> stats = Nan::New<Object>();
+    std::lock_guard<std::mutex> lock(mutex);
+    stats->Set(Nan::New("size").ToLocalChecked(), Nan::New<Number>(size));
+    stats->Set(Nan::New("lent").ToLocalChecked(), Nan::New<Number>(lent.size()));
+    stats->Set(Nan::New("reused").ToLocalChecked(), Nan::New<Number>(reused));
+    stats->Set(Nan::New("allocated").ToLocalChecked(), Nan::New<Number>(allocated));
+    return scope.Escape(stats);
+  }
+
+private:
+  std::mutex mutex;
+  size_t size;
+  std::vector<cv::Mat> lent;
+  uint64_t reused;
+  uint64_t allocated;
+};
+
+VideoCaptureWrap::VideoCaptureWrap(int device): ring(nullptr), stopping(nullptr), releasing(false), pending(0),
+    bufferSize(0), fourcc(0), frames(new FramePool()) {
   Nan::HandleScope scope;
   cap.open(device);
 
@@ -70,7 +159,8 @@ VideoCaptureWrap::VideoCaptureWrap(int device) {
   }
 }
 
-VideoCaptureWrap::VideoCaptureWrap(const std::string& filename) {
+VideoCaptureWrap::VideoCaptureWrap(const std::string& filename): ring(nullptr), stopping(nullptr), releasing(false), pending(0),
+    bufferSize(0), fourcc(0), frames(new FramePool()) {
   Nan::HandleScope scope;
   cap.open(filename);
   // TODO! At the moment this only takes a full path - do relative too.
@@ -79,9 +169,14 @@ VideoCaptureWrap::VideoCaptureWrap(const std::string& filename) {
   }
 }
 
+VideoCaptureWrap::~VideoCaptureWrap() {
+  delete frames;
+}
+
 NAN_METHOD(VideoCaptureWrap::SetWidth) {
   Nan::HandleScope scope;
   VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
+  REQ_NOT_CAPTURING(v)
 
   if(info.Length() != 1)
   return;
@@ -97,6 +192,7 @@ NAN_METHOD(VideoCaptureWrap::SetWidth) {
 NAN_METHOD(VideoCaptureWrap::GetFrameCount) {
   Nan::HandleScope scope;
   VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
+  REQ_NOT_CAPTURING(v)
 
   int cnt = int(v->cap.get(CV_CAP_PROP_FRAME_COUNT));
 
@@ -106,6 +202,7 @@ NAN_METHOD(VideoCaptureWrap::GetFrameCount) {
 NAN_METHOD(VideoCaptureWrap::SetHeight) {
   Nan::HandleScope scope;
   VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
+  REQ_NOT_CAPTURING(v)
 
   if(info.Length() != 1)
   return;
@@ -120,6 +217,7 @@ NAN_METHOD(VideoCaptureWrap::SetHeight) {
 NAN_METHOD(VideoCaptureWrap::SetPosition) {
   Nan::HandleScope scope;
   VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
+  REQ_NOT_CAPTURING(v)
 
   if(info.Length() != 1)
   return;
@@ -134,6 +232,7 @@ NAN_METHOD(VideoCaptureWrap::SetPosition) {
 NAN_METHOD(VideoCaptureWrap::GetFrameAt) {
   Nan::HandleScope scope;
   VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
+  REQ_NOT_CAPTURING(v)
 
   if(info.Length() != 1)
   return;
@@ -145,11 +244,324 @@ NAN_METHOD(VideoCaptureWrap::GetFrameAt) {
   return;
 }
 
+// Settles one read() made while capturing, with a frame or an error.
+class FrameReadWorker : public AsyncResultWorker {
+public:
+  FrameReadWorker(Matrix *into): into(into) {}
+
+  void Execute() override {
+    if (!error.empty()) {
+      SetErrorMessage(error.c_str());
+    }
+  }
+
+  cv::Mat frame;
+  std::string error;
+
+protected:
+  Local<Value> Result() override {
+    Local<Value> image;
+    if (into == nullptr) {
+      image = Matrix::NewInstance(frame);
+    } else {
+      into->mat = frame;
+      into->UpdateExternalMemory();
+      image = GetFromPersistent("into");
+    }
+    // Only the Matrix holds the frame now, for the FramePool
+    frame.release();
+    return image;
+  }
+
+private:
+  // The Matrix passed to read(frame), if any.
+  Matrix *into;
+};
+
+/**
+ * A thread that reads frames from a VideoCapture as fast as they come, into
+ * a ring of `size` frames, so that the driver's own queue never fills up:
+ *
+ *   cap.startCapture({ policy: 'latest', size: 2, bufferSize: 1, fourcc: 'MJPG' });
+ *   cap.read(function(err, frame) { ... });
+ *   cap.captureStats(); // { captured, delivered, dropped, ... }
+ *
+ * With the 'latest' policy, read() gets the newest frame and the ones
+ * before it are dropped, as is the oldest frame when the ring is full: what
+ * JS sees is never older than one frame. With 'fifo' every frame is read
+ * in order, and the thread waits while the ring is full.
+ *
+ * Dropped frames go back to the thread to be read into again, so a camera
+ * JS can't keep up with doesn't allocate. Once the capture ends, e.g. at the
+ * end of a file, reads get an empty Matrix, like read() does, or the error
+ * the backend threw.
+ */
+class FrameRing {
+public:
+  enum Policy { LATEST, FIFO };
+
+  FrameRing(VideoCaptureWrap *vc, Policy policy, size_t size):
+    vc(vc), policy(policy), size(size), running(true), ended(false), exited(false),
+    captured(0), delivered(0), dropped(0), stopping(false) {
+    async.data = this;
+    uv_async_init(Nan::GetCurrentEventLoop(), &async, OnFrame);
+    uv_unref((uv_handle_t *) &async);
+    thread = std::thread(&FrameRing::Run, this);
+  }
+
+  // Main thread. Fails the waiting reads and returns; the frame being read
+  // may take a while, so the thread is joined once it signals it's done,
+  // and the ring deleted once libuv is done with it.
+  void Stop() {
+    bool done;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      running = false;
+      done = exited;
+    }
+    space.notify_all();
+
+    for (size_t i = 0; i < waiting.size(); i++) {
+      waiting[i]->error = "Capture stopped";
+      WorkerPool::Queue(waiting[i]);
+    }
+    waiting.clear();
+
+    stopping = true;
+    uv_unref((uv_handle_t *) &async);
+    if (done) {
+      Close();
+    }
+  }
+
+  // Main thread. Queues the worker once the thread has stopped; until then
+  // it keeps the process alive, as waiting reads do.
+  void OnStopped(AsyncResultWorker *worker) {
+    stopped.push_back(worker);
+    uv_ref((uv_handle_t *) &async);
+  }
+
+  // Main thread.
+  void Read(FrameReadWorker *worker) {
+    waiting.push_back(worker);
+    Pump();
+  }
+
+  // Main thread. Hands the frames read so far to the waiting reads.
+  void Pump() {
+    if (stopping) {
+      bool done;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = exited;
+      }
+      if (done) {
+        Close();
+      }
+      return;
+    }
+
+    std::vector<FrameReadWorker *> settled;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      while (!waiting.empty() && (!ready.empty() || ended)) {
+        FrameReadWorker *worker = waiting.front();
+        waiting.pop_front();
+
+        if (policy == LATEST) {
+          while (ready.size() > 1) {
+            Drop();
+          }
+        }
+        if (!ready.empty()) {
+          worker->frame = ready.front();
+          ready.pop_front();
+          delivered++;
+          vc->frames->Lend(worker->frame);
+        } else {
+          worker->error = failure;
+        }
+        settled.push_back(worker);
+      }
+    }
+    space.notify_one();
+
+    for (size_t i = 0; i < settled.size(); i++) {
+      WorkerPool::Queue(settled[i]);
+    }
+
+    // Only waiting reads keep the process alive
+    if (waiting.empty()) {
+      uv_unref((uv_handle_t *) &async);
+    } else {
+      uv_ref((uv_handle_t *) &async);
+    }
+  }
+
+  Local<Object> ToObject() {
+    Nan::EscapableHandleScope scope;
+
+    Local<Object> stats = Nan::New<Object>();
+    std::lock_guard<std::mutex> lock(mutex);
+    stats->Set(Nan::New("policy").ToLocalChecked(),
+        Nan::New(policy == LATEST ? "latest" : "fifo").ToLocalChecked());
+    stats->Set(Nan::New("size").ToLocalChecked(), Nan::New<Number>(size));
+    stats->Set(Nan::New("captured").ToLocalChecked(), Nan::New<Number>(captured));
+    stats->Set(Nan::New("delivered").ToLocalChecked(), Nan::New<Number>(delivered));
+    stats->Set(Nan::New("dropped").ToLocalChecked(), Nan::New<Number>(dropped));
+    stats->Set(Nan::New("ready").ToLocalChecked(), Nan::New<Number>(ready.size()));
+    stats->Set(Nan::New("waiting").ToLocalChecked(), Nan::New<Number>(waiting.size()));
+    stats->Set(Nan::New("ended").ToLocalChecked(), Nan::New<Boolean>(ended));
+    return scope.Escape(stats);
+  }
+
+private:
+  // Capture thread.
+  void Run() {
+    Capture();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      exited = true;
+    }
+    uv_async_send(&async);
+  }
+
+  // Capture thread. Reads until stopped or the capture ends.
+  void Capture() {
+    cv::Mat frame;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        space.wait(lock, [this] { return !running || policy == LATEST || ready.size() < size; });
+        if (!running) {
+          return;
+        }
+        if (frame.empty() && !spare.empty()) {
+          frame = spare.back();
+          spare.pop_back();
+        }
+      }
+      if (frame.empty()) {
+        frame = vc->frames->Take();
+      }
+
+      bool ok = false;
+      try {
+        ok = vc->cap.read(frame) && !frame.empty();
+      } catch (cv::Exception &e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        failure = e.what();
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ok) {
+          ended = true;
+        } else {
+          captured++;
+          ready.push_back(frame);
+          frame = cv::Mat();
+          while (ready.size() > size) {
+            Drop();
+          }
+        }
+      }
+      uv_async_send(&async);
+
+      if (!ok) {
+        return;
+      }
+    }
+  }
+
+  // Drops the oldest frame, keeping its buffer to read into. Called with
+  // the mutex held.
+  void Drop() {
+    if (spare.size() < size) {
+      spare.push_back(ready.front());
+    }
+    ready.pop_front();
+    dropped++;
+  }
+
+  static NAUV_WORK_CB(OnFrame) {
+    Nan::HandleScope scope;
+
+    static_cast<FrameRing *>(async->data)->Pump();
+  }
+
+  // Main thread, once the thread has exited.
+  void Close() {
+    thread.join();
+    uv_close((uv_handle_t *) &async, OnClose);
+  }
+
+  // Hands cap back to the VideoCapture.
+  static void OnClose(uv_handle_t *handle) {
+    Nan::HandleScope scope;
+
+    FrameRing *ring = static_cast<FrameRing *>(handle->data);
+    VideoCaptureWrap *vc = ring->vc;
+    std::vector<AsyncResultWorker *> stopped;
+    stopped.swap(ring->stopped);
+    delete ring;
+
+    vc->stopping = nullptr;
+    if (vc->releasing) {
+      vc->releasing = false;
+      vc->cap.release();
+    }
+    vc->Unref();
+
+    for (size_t i = 0; i < stopped.size(); i++) {
+      WorkerPool::Queue(stopped[i]);
+    }
+  }
+
+  VideoCaptureWrap *vc;
+  const Policy policy;
+  const size_t size;
+
+  std::thread thread;
+  uv_async_t async;
+
+  std::mutex mutex;
+  // Signalled when there is room in the ring, or the capture stops.
+  std::condition_variable space;
+  bool running;
+  bool ended;
+  // Run() is past its last use of cap.
+  bool exited;
+  // Why the capture ended, when the backend threw.
+  std::string failure;
+  std::deque<cv::Mat> ready;
+  std::vector<cv::Mat> spare;
+  uint64_t captured;
+  uint64_t delivered;
+  uint64_t dropped;
+
+  // Main thread only.
+  std::deque<FrameReadWorker *> waiting;
+  // Whether Stop() was called, and the stopCapture() calls to settle after.
+  bool stopping;
+  std::vector<AsyncResultWorker *> stopped;
+};
+
 NAN_METHOD(VideoCaptureWrap::Release) {
   Nan::HandleScope scope;
   VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
 
-  v->cap.release();
+  if (v->ring) {
+    v->ring->Stop();
+    v->stopping = v->ring;
+    v->ring = nullptr;
+  }
+  if (v->stopping) {
+    // The thread may still be reading from it
+    v->releasing = true;
+  } else {
+    v->cap.release();
+  }
 
   return;
 }
@@ -157,28 +569,48 @@ NAN_METHOD(VideoCaptureWrap::Release) {
 class AsyncVCWorker: public Nan::AsyncWorker {
 public:
   AsyncVCWorker(Nan::Callback *callback, VideoCaptureWrap* vc,
-  bool retrieve = false, int channel = 0) :
+  bool retrieve = false, int channel = 0, Matrix *into = nullptr) :
       Nan::AsyncWorker(callback),
       vc(vc),
       retrieve(retrieve),
-      channel(channel) {
+      channel(channel),
+      into(into) {
+    vc->pending++;
+    if (into != nullptr) {
+      // Same size and type frames are read into its pixels in place, unless
+      // they're shared and it gets new ones
+      into->MakeOverwritable();
+      mat = into->mat;
+    }
+    pooled = mat.empty();
   }
 
   ~AsyncVCWorker() {
   }
 
+  void WorkComplete() override {
+    vc->pending--;
+    Nan::AsyncWorker::WorkComplete();
+  }
+
   // Executed inside the worker-thread.
   // It is not safe to access V8, or V8 data structures
   // here, so everything we need for input and output
   // should go on `this`.
   void Execute() {
+    if (pooled) {
+      mat = vc->frames->Take();
+    }
     if (retrieve) {
       if (!this->vc->cap.retrieve(mat, channel)) {
         SetErrorMessage("retrieve failed");
       }
-      return;
+    } else {
+      this->vc->cap.read(mat);
+    }
+    if (pooled) {
+      vc->frames->Lend(mat);
     }
-    this->vc->cap.read(mat);
   }
 
   // Executed when the async work is complete
@@ -187,9 +619,17 @@ public:
   void HandleOKCallback() {
     Nan::HandleScope scope;
 
-    Local<Object> im_to_return= Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
-    Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(im_to_return);
-    img->mat = mat;
+    Local<Object> im_to_return;
+    if (into == nullptr) {
+      im_to_return = Matrix::NewInstance(mat);
+    } else {
+      into->mat = mat;
+      into->UpdateExternalMemory();
+      im_to_return = GetFromPersistent("into")->ToObject();
+    }
+    // Only the Matrix holds the frame now, so that the FramePool can tell
+    // once JS is done with it
+    mat.release();
 
     Local<Value> argv[] = {
       Nan::Null()
@@ -208,16 +648,49 @@ private:
   cv::Mat mat;
   bool retrieve;
   int channel;
+  Matrix *into;
+  bool pooled;
 };
 
 NAN_METHOD(VideoCaptureWrap::Read) {
   Nan::HandleScope scope;
   VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
 
-  REQ_FUN_ARG(0, cb);
+  // read([frame, ]callback): a Matrix from an earlier read is read into
+  Matrix *into = nullptr;
+  int index = 0;
+  if (info.Length() > 0 && Matrix::HasInstance(info[0])) {
+    into = UNWRAP_ARG(Matrix, 0);
+    index = 1;
+  }
 
-  Nan::Callback *callback = new Nan::Callback(cb.As<Function>());
-  Nan::AsyncQueueWorker(new AsyncVCWorker(callback, v));
+  if (v->ring) {
+    // From the ring; a Promise without a callback
+    int callbackIndex = info.Length() > index && info[index]->IsFunction() ? index : -1;
+    FrameReadWorker *worker = NewAsyncResultWorker<FrameReadWorker>(info, callbackIndex, into);
+    if (into != nullptr) {
+      // Its pixels can go back to the ring while it waits for the next frame
+      into->MakeOverwritable();
+      into->mat.release();
+      into->UpdateExternalMemory();
+      worker->SaveToPersistent("into", info[0]);
+    }
+    v->ring->Read(worker);
+    return;
+  }
+
+  REQ_NOT_CAPTURING(v)
+  if (info.Length() <= index || !info[index]->IsFunction()) {
+    return Nan::ThrowTypeError(into ? "Argument 1 must be a function" : "Argument 0 must be a function");
+  }
+
+  Nan::Callback *callback = new Nan::Callback(info[index].As<Function>());
+  AsyncVCWorker *worker = new AsyncVCWorker(callback, v, false, 0, into);
+  worker->SaveToPersistent("capture", info.This());
+  if (into != nullptr) {
+    worker->SaveToPersistent("into", info[0]);
+  }
+  WorkerPool::Queue(worker);
 
   return;
 }
@@ -225,11 +698,31 @@ NAN_METHOD(VideoCaptureWrap::Read) {
 NAN_METHOD(VideoCaptureWrap::ReadSync) {
   Nan::HandleScope scope;
   VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
+  REQ_NOT_CAPTURING(v)
+
+  // ReadSync([frame]): a Matrix from an earlier read is read into
+  if (info.Length() > 0 && Matrix::HasInstance(info[0])) {
+    Matrix *img = UNWRAP_ARG(Matrix, 0);
+    img->MakeOverwritable();
+    bool pooled = img->mat.empty();
+    if (pooled) {
+      img->mat = v->frames->Take();
+    }
+    v->cap.read(img->mat);
+    if (pooled) {
+      v->frames->Lend(img->mat);
+    }
+    img->UpdateExternalMemory();
+    return info.GetReturnValue().Set(info[0]);
+  }
 
   Local<Object> im_to_return= Nan::NewInstance(Nan::GetFunction(Nan::New(Matrix::constructor)).ToLocalChecked()).ToLocalChecked();
   Matrix *img = Nan::ObjectWrap::Unwrap<Matrix>(im_to_return);
 
+  img->mat = v->frames->Take();
   v->cap.read(img->mat);
+  v->frames->Lend(img->mat);
+  img->UpdateExternalMemory();
 
   info.GetReturnValue().Set(im_to_return);
 }
@@ -239,11 +732,17 @@ public:
   AsyncGrabWorker(Nan::Callback *callback, VideoCaptureWrap* vc) :
       Nan::AsyncWorker(callback),
       vc(vc) {
+    vc->pending++;
   }
 
   ~AsyncGrabWorker() {
   }
 
+  void WorkComplete() override {
+    vc->pending--;
+    Nan::AsyncWorker::WorkComplete();
+  }
+
   void Execute() {
     if (!this->vc->cap.grab()) {
       SetErrorMessage("grab failed");
@@ -257,11 +756,14 @@ private:
 NAN_METHOD(VideoCaptureWrap::Grab) {
   Nan::HandleScope scope;
   VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
+  REQ_NOT_CAPTURING(v)
 
   REQ_FUN_ARG(0, cb);
 
   Nan::Callback *callback = new Nan::Callback(cb.As<Function>());
-  Nan::AsyncQueueWorker(new AsyncGrabWorker(callback, v));
+  AsyncGrabWorker *worker = new AsyncGrabWorker(callback, v);
+  worker->SaveToPersistent("capture", info.This());
+  WorkerPool::Queue(worker);
 
   return;
 }
@@ -269,13 +771,175 @@ NAN_METHOD(VideoCaptureWrap::Grab) {
 NAN_METHOD(VideoCaptureWrap::Retrieve) {
   Nan::HandleScope scope;
   VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
+  REQ_NOT_CAPTURING(v)
 
   int channel = 0;
   REQ_FUN_ARG(0, cb);
   INT_FROM_ARGS(channel, 1);
 
   Nan::Callback *callback = new Nan::Callback(cb.As<Function>());
-  Nan::AsyncQueueWorker(new AsyncVCWorker(callback, v, true, channel));
+  AsyncVCWorker *worker = new AsyncVCWorker(callback, v, true, channel);
+  worker->SaveToPersistent("capture", info.This());
+  WorkerPool::Queue(worker);
 
   return;
 }
+
+// cap.startCapture([{ policy: 'latest' | 'fifo', size: 2, bufferSize, fourcc }])
+// bufferSize and fourcc are the CAP_PROP_BUFFERSIZE and CAP_PROP_FOURCC
+// settings, which not every backend takes; captureStats() tells what they
+// ended up as.
+NAN_METHOD(VideoCaptureWrap::StartCapture) {
+  Nan::HandleScope scope;
+  VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
+  REQ_NOT_CAPTURING(v)
+  // Their workers would read from cap alongside the thread
+  if (v->pending > 0) {
+    return Nan::ThrowError("Not while read(), grab() or retrieve() are pending");
+  }
+
+  FrameRing::Policy policy = FrameRing::LATEST;
+  size_t size = 2;
+  if (info.Length() > 0 && !info[0]->IsUndefined()) {
+    if (!info[0]->IsObject()) {
+      return Nan::ThrowTypeError("Options must be an object");
+    }
+    Local<Object> options = info[0]->ToObject();
+    Local<Value> policyValue = options->Get(Nan::New("policy").ToLocalChecked());
+    Local<Value> sizeValue = options->Get(Nan::New("size").ToLocalChecked());
+    Local<Value> bufferSize = options->Get(Nan::New("bufferSize").ToLocalChecked());
+    Local<Value> fourcc = options->Get(Nan::New("fourcc").ToLocalChecked());
+
+    if (!policyValue->IsUndefined()) {
+      std::string name = *Nan::Utf8String(policyValue);
+      if (name == "latest") {
+        policy = FrameRing::LATEST;
+      } else if (name == "fifo") {
+        policy = FrameRing::FIFO;
+      } else {
+        return Nan::ThrowTypeError("policy must be 'latest' or 'fifo'");
+      }
+    }
+    if (!sizeValue->IsUndefined()) {
+      if (!sizeValue->IsNumber() || sizeValue->Int32Value() < 1) {
+        return Nan::ThrowTypeError("size must be a number >= 1");
+      }
+      size = sizeValue->Int32Value();
+    }
+    if (!fourcc->IsUndefined()) {
+      std::string code = *Nan::Utf8String(fourcc);
+      if (code.size() != 4) {
+        return Nan::ThrowTypeError("fourcc must be 4 characters");
+      }
+      v->cap.set(CV_CAP_PROP_FOURCC, CV_FOURCC(code[0], code[1], code[2], code[3]));
+    }
+    if (!bufferSize->IsUndefined()) {
+      if (!bufferSize->IsNumber() || bufferSize->Int32Value() < 1) {
+        return Nan::ThrowTypeError("bufferSize must be a number >= 1");
+      }
+#if CV_MAJOR_VERSION >= 3
+      v->cap.set(cv::CAP_PROP_BUFFERSIZE, bufferSize->Int32Value());
+#endif
+    }
+  }
+
+  if (!v->cap.isOpened()) {
+    return Nan::ThrowError("Capture is not open");
+  }
+
+  v->bufferSize = 0;
+#if CV_MAJOR_VERSION >= 3
+  v->bufferSize = v->cap.get(cv::CAP_PROP_BUFFERSIZE);
+#endif
+  v->fourcc = v->cap.get(CV_CAP_PROP_FOURCC);
+
+  // Alive for as long as the thread reads from it
+  v->Ref();
+  v->ring = new FrameRing(v, policy, size);
+}
+
+// Settles stopCapture() once the capture thread has stopped.
+class CaptureStoppedWorker : public AsyncResultWorker {
+public:
+  void Execute() override {}
+
+protected:
+  Local<Value> Result() override {
+    return Nan::Undefined();
+  }
+};
+
+// cap.stopCapture([callback]): reads still waiting fail, and frames already
+// read are dropped. The thread stops once the frame being read is in; the
+// other methods can be used again when the callback is called, or the
+// Promise returned without one resolves.
+NAN_METHOD(VideoCaptureWrap::StopCapture) {
+  Nan::HandleScope scope;
+  VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
+
+  int callbackIndex = -1;
+  if (info.Length() > 0 && !info[0]->IsUndefined()) {
+    if (!info[0]->IsFunction()) {
+      return Nan::ThrowTypeError("Argument 1 must be a function");
+    }
+    callbackIndex = 0;
+  }
+  CaptureStoppedWorker *worker = NewAsyncResultWorker<CaptureStoppedWorker>(info, callbackIndex);
+
+  if (v->ring) {
+    v->ring->Stop();
+    v->stopping = v->ring;
+    v->ring = nullptr;
+  }
+  if (v->stopping) {
+    v->stopping->OnStopped(worker);
+  } else {
+    WorkerPool::Queue(worker);
+  }
+}
+
+// cap.captureStats(): { policy, size, captured, delivered, dropped, ready,
+// waiting, ended, bufferSize, fourcc }, or null when not capturing.
+NAN_METHOD(VideoCaptureWrap::CaptureStats) {
+  Nan::HandleScope scope;
+  VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
+
+  if (!v->ring) {
+    return info.GetReturnValue().Set(Nan::Null());
+  }
+
+  Local<Object> stats = v->ring->ToObject();
+  // Backends that don't know the codec report 0 or -1
+  int code = v->fourcc > 0 ? (int) v->fourcc : 0;
+  char fourcc[5] = {(char) (code & 0xFF), (char) ((code >> 8) & 0xFF),
+      (char) ((code >> 16) & 0xFF), (char) ((code >> 24) & 0xFF), 0};
+  stats->Set(Nan::New("bufferSize").ToLocalChecked(), Nan::New<Number>(v->bufferSize));
+  stats->Set(Nan::New("fourcc").ToLocalChecked(), Nan::New(fourcc).ToLocalChecked());
+  info.GetReturnValue().Set(stats);
+}
+
+// cap.setFramePool({ size: 4 }): how many of the frames handed out to keep
+// reading into; 0 turns recycling off.
+NAN_METHOD(VideoCaptureWrap::SetFramePool) {
+  Nan::HandleScope scope;
+  VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
+
+  if (info.Length() < 1 || !info[0]->IsObject()) {
+    return Nan::ThrowTypeError("Argument 1 must be an object");
+  }
+  Local<Value> size = info[0]->ToObject()->Get(Nan::New("size").ToLocalChecked());
+  if (!size->IsNumber() || size->Int32Value() < 0) {
+    return Nan::ThrowTypeError("size must be a number >= 0");
+  }
+
+  v->frames->Configure(size->Int32Value());
+}
+
+// cap.framePoolStats(): { size, lent, reused, allocated }. `allocated`
+// counts the reads that found no frame to read into.
+NAN_METHOD(VideoCaptureWrap::FramePoolStats) {
+  Nan::HandleScope scope;
+  VideoCaptureWrap *v = Nan::ObjectWrap::Unwrap<VideoCaptureWrap>(info.This());
+
+  info.GetReturnValue().Set(v->frames->ToObject());
+}
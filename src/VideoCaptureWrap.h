@@ -1,15 +1,35 @@
 #include "OpenCV.h"
 
+class FrameRing;
+class FramePool;
+
 class VideoCaptureWrap: public Nan::ObjectWrap {
 public:
   cv::VideoCapture cap;
 
+  // Set between startCapture() and stopCapture(), while a thread of its own
+  // reads the frames; cap is the thread's then, and until the thread has
+  // stopped.
+  FrameRing *ring;
+  FrameRing *stopping;
+  // release() was called while stopping; cap is released once stopped.
+  bool releasing;
+  // read(), grab() and retrieve() workers queued or running. Main thread only.
+  int pending;
+  // CAP_PROP_BUFFERSIZE and CAP_PROP_FOURCC as the capture started.
+  double bufferSize;
+  double fourcc;
+
+  // Frames to read into again once JS is done with them. Worker safe.
+  FramePool *frames;
+
   static Nan::Persistent<FunctionTemplate> constructor;
   static void Init(Local<Object> target);
   static NAN_METHOD(New);
 
   VideoCaptureWrap(const std::string& filename);
   VideoCaptureWrap(int device);
+  ~VideoCaptureWrap();
 
   static NAN_METHOD(Read);
   static NAN_METHOD(ReadSync);
@@ -29,4 +49,13 @@ public:
 
   // release the stream
   static NAN_METHOD(Release);
+
+  // Continuous capture into a ring of frames, see FrameRing
+  static NAN_METHOD(StartCapture);
+  static NAN_METHOD(StopCapture);
+  static NAN_METHOD(CaptureStats);
+
+  // Recycling of the frames read, see FramePool
+  static NAN_METHOD(SetFramePool);
+  static NAN_METHOD(FramePoolStats);
 };
@@ -0,0 +1,356 @@
+#include "WorkerPool.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Same default as UV_THREADPOOL_SIZE.
+static const int kDefaultThreads = 4;
+
+// A waiting batch job gets a thread after this many interactive ones.
+static const int kBatchEvery = 8;
+
+static const char *kLaneNames[WorkerPool::LANE_COUNT] = { "interactive", "batch" };
+
+static int Cores() {
+  return std::max(1, (int) std::thread::hardware_concurrency());
+}
+
+// Binds the calling thread to the index-th CPU the process may run on.
+static void PinThread(int index) {
+#ifdef __linux__
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+    return;
+  }
+
+  int target = index % CPU_COUNT(&allowed);
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &allowed) && target-- == 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+      return;
+    }
+  }
+#endif
+}
+
+// A queued worker, with uv_hrtime timestamps for Stats.
+struct Job {
+  Nan::AsyncWorker *worker;
+  Stats::Binding *binding;  // method that queued it
+  bool timed;  // stats were on when it was queued
+  uint64_t queued;
+  uint64_t started;
+  uint64_t finished;
+};
+
+class Pool {
+public:
+  Pool(): threads(kDefaultThreads), pin(false), opencvThreads(0), lane(WorkerPool::INTERACTIVE),
+    pending(0), stopping(false), running(0), completed(0), interactiveStreak(0) {}
+
+  // Main thread.
+  void Queue(Nan::AsyncWorker *worker, WorkerPool::Lane lane) {
+    Job job = { worker, Stats::Current(), Stats::Enabled() && Stats::Current(), 0, 0, 0 };
+    if (job.timed) {
+      job.queued = uv_hrtime();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      lanes[lane].push_back(job);
+    }
+    if (workers.empty()) {
+      Start();
+    }
+    ready.notify_one();
+
+    // Keep the loop alive while anything is in flight.
+    if (pending++ == 0) {
+      uv_ref((uv_handle_t *) &async);
+    }
+  }
+
+  // Main thread. Waits for the running jobs; queued ones are kept and picked
+  // up by the new threads.
+  void Configure(int threads, bool pin, int opencvThreads) {
+    bool restart = !workers.empty();
+    if (restart) {
+      Stop();
+    }
+
+    this->threads = threads;
+    this->pin = pin;
+    this->opencvThreads = opencvThreads;
+
+    if (restart) {
+      Start();
+    }
+  }
+
+  // Main thread. Runs the callbacks of finished workers.
+  void Complete() {
+    std::vector<Job> finished;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      finished.swap(done);
+    }
+
+    for (size_t i = 0; i < finished.size(); i++) {
+      const Job &job = finished[i];
+      if (job.timed) {
+        Stats::RecordJob(job.binding, job.queued, job.started, job.finished);
+      }
+
+      // Matrices made by the callback count towards the queuing method.
+      Stats::Binding *outer = Stats::SetCurrent(job.binding);
+      job.worker->WorkComplete();
+      job.worker->Destroy();
+      Stats::SetCurrent(outer);
+    }
+
+    pending -= finished.size();
+    if (pending == 0 && !finished.empty()) {
+      uv_unref((uv_handle_t *) &async);
+    }
+  }
+
+  uv_async_t async;
+
+  // Settings, main thread only.
+  int threads;
+  bool pin;
+  int opencvThreads;  // 0 picks cores / threads, -1 leaves OpenCV alone
+  WorkerPool::Lane lane;
+
+  size_t pending;
+
+  // Guarded by mutex.
+  std::mutex mutex;
+  std::deque<Job> lanes[WorkerPool::LANE_COUNT];
+  int running;
+  uint64_t completed;
+
+private:
+  void Start() {
+    // Each thread can fan out into OpenCV's own parallel_for, so split the
+    // cores between them rather than running threads * cores.
+    if (opencvThreads == 0) {
+      cv::setNumThreads(std::max(1, Cores() / threads));
+    } else if (opencvThreads > 0) {
+      cv::setNumThreads(opencvThreads);
+    }
+
+    stopping = false;
+    for (int i = 0; i < threads; i++) {
+      workers.push_back(std::thread(&Pool::Run, this, i));
+    }
+  }
+
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    ready.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+      workers[i].join();
+    }
+    workers.clear();
+  }
+
+  void Run(int index) {
+    if (pin) {
+      PinThread(index);
+    }
+
+    for (;;) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] {
+          return stopping || !lanes[WorkerPool::INTERACTIVE].empty() || !lanes[WorkerPool::BATCH].empty();
+        });
+        if (stopping) {
+          return;
+        }
+        job = Next();
+        running++;
+      }
+
+      if (job.timed) {
+        job.started = uv_hrtime();
+      }
+      job.worker->Execute();
+      if (job.timed) {
+        job.finished = uv_hrtime();
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        running--;
+        completed++;
+        done.push_back(job);
+      }
+      uv_async_send(&async);
+    }
+  }
+
+  // Called with the mutex held and at least one lane non-empty.
+  Job Next() {
+    std::deque<Job> &interactive = lanes[WorkerPool::INTERACTIVE];
+    std::deque<Job> &batch = lanes[WorkerPool::BATCH];
+
+    std::deque<Job> *from = &interactive;
+    if (!batch.empty() && (interactive.empty() || interactiveStreak >= kBatchEvery)) {
+      from = &batch;
+      interactiveStreak = 0;
+    } else {
+      interactiveStreak++;
+    }
+
+    Job job = from->front();
+    from->pop_front();
+    return job;
+  }
+
+  std::vector<std::thread> workers;
+  std::condition_variable ready;
+  bool stopping;
+  std::vector<Job> done;
+  int interactiveStreak;
+};
+
+// Threads are never joined at exit, so neither is the pool destroyed.
+static Pool &pool = *new Pool();
+
+static NAUV_WORK_CB(OnComplete) {
+  Nan::HandleScope scope;
+
+  pool.Complete();
+}
+
+void WorkerPool::Init(Local<Object> target) {
+  Nan::HandleScope scope;
+
+  uv_async_init(Nan::GetCurrentEventLoop(), &pool.async, OnComplete);
+  uv_unref((uv_handle_t *) &pool.async);
+
+  Stats::SetMethod(target, "setWorkerPool", SetWorkerPool);
+  Stats::SetMethod(target, "workerPoolStats", WorkerPoolStats);
+  Stats::SetMethod(target, "withLane", WithLane);
+}
+
+void WorkerPool::Queue(Nan::AsyncWorker *worker) {
+  pool.Queue(worker, pool.lane);
+}
+
+void WorkerPool::Queue(Nan::AsyncWorker *worker, Lane lane) {
+  pool.Queue(worker, lane);
+}
+
+WorkerPool::Lane WorkerPool::CurrentLane() {
+  return pool.lane;
+}
+
+int WorkerPool::Threads() {
+  return pool.threads;
+}
+
+// cv.setWorkerPool({ threads: 4, pin: false, opencvThreads: 0 })
+NAN_METHOD(WorkerPool::SetWorkerPool) {
+  Nan::HandleScope scope;
+
+  if (info.Length() < 1 || !info[0]->IsObject()) {
+    return Nan::ThrowTypeError("Argument 1 must be an object");
+  }
+
+  Local<Object> options = info[0]->ToObject();
+  int threads = pool.threads;
+  bool pin = pool.pin;
+  int opencvThreads = pool.opencvThreads;
+
+  if (options->Has(Nan::New<String>("threads").ToLocalChecked())) {
+    threads = options->Get(Nan::New<String>("threads").ToLocalChecked())->IntegerValue();
+    if (threads < 1) {
+      return Nan::ThrowRangeError("threads must be >= 1");
+    }
+  }
+  if (options->Has(Nan::New<String>("pin").ToLocalChecked())) {
+    pin = options->Get(Nan::New<String>("pin").ToLocalChecked())->BooleanValue();
+  }
+  if (options->Has(Nan::New<String>("opencvThreads").ToLocalChecked())) {
+    opencvThreads = options->Get(Nan::New<String>("opencvThreads").ToLocalChecked())->IntegerValue();
+    if (opencvThreads < -1) {
+      return Nan::ThrowRangeError("opencvThreads must be >= -1");
+    }
+  }
+
+  pool.Configure(threads, pin, opencvThreads);
+}
+
+NAN_METHOD(WorkerPool::WorkerPoolStats) {
+  Nan::HandleScope scope;
+
+  Local<Object> stats = Nan::New<Object>();
+  stats->Set(Nan::New<String>("threads").ToLocalChecked(), Nan::New<Number>(pool.threads));
+  stats->Set(Nan::New<String>("pin").ToLocalChecked(), Nan::New<Boolean>(pool.pin));
+  stats->Set(Nan::New<String>("opencvThreads").ToLocalChecked(), Nan::New<Number>(cv::getNumThreads()));
+  stats->Set(Nan::New<String>("pending").ToLocalChecked(), Nan::New<Number>(pool.pending));
+
+  Local<Object> queued = Nan::New<Object>();
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    for (int i = 0; i < LANE_COUNT; i++) {
+      queued->Set(Nan::New<String>(kLaneNames[i]).ToLocalChecked(), Nan::New<Number>(pool.lanes[i].size()));
+    }
+    stats->Set(Nan::New<String>("running").ToLocalChecked(), Nan::New<Number>(pool.running));
+    stats->Set(Nan::New<String>("completed").ToLocalChecked(), Nan::New<Number>(pool.completed));
+  }
+  stats->Set(Nan::New<String>("queued").ToLocalChecked(), queued);
+
+  info.GetReturnValue().Set(stats);
+}
+
+// cv.withLane('batch', fn): async work queued while fn runs goes to that lane.
+NAN_METHOD(WorkerPool::WithLane) {
+  Nan::HandleScope scope;
+
+  if (info.Length() < 2 || !info[0]->IsString() || !info[1]->IsFunction()) {
+    return Nan::ThrowTypeError("withLane takes a lane name and a function");
+  }
+
+  std::string name = *Nan::Utf8String(info[0]);
+  int lane = 0;
+  while (lane < LANE_COUNT && name != kLaneNames[lane]) {
+    lane++;
+  }
+  if (lane == LANE_COUNT) {
+    return Nan::ThrowTypeError("Lane must be 'interactive' or 'batch'");
+  }
+
+  Lane previous = pool.lane;
+  pool.lane = (Lane) lane;
+
+  Nan::TryCatch try_catch;
+  Local<Value> result = Local<Function>::Cast(info[1])->Call(
+      Nan::GetCurrentContext()->Global(), 0, NULL);
+
+  pool.lane = previous;
+  if (try_catch.HasCaught()) {
+    try_catch.ReThrow();
+    return;
+  }
+
+  info.GetReturnValue().Set(result);
+}
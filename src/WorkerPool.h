@@ -0,0 +1,49 @@
+#ifndef __NODE_WORKERPOOL_H
+#define __NODE_WORKERPOOL_H
+
+#include "OpenCV.h"
+
+/**
+ * Threads that run the add-on's async work, so that long OpenCV calls don't
+ * queue up in front of fs and dns on libuv's pool. Workers are run on these
+ * threads and completed on the main thread through a uv_async handle, the same
+ * way Nan::AsyncQueueWorker completes them.
+ *
+ * Work is queued in one of two lanes. Threads take interactive work first;
+ * batch work runs when the interactive lane is empty, and every few picks
+ * while it isn't, so it can't starve completely.
+ *
+ *   cv.setWorkerPool({ threads: 4, pin: true, opencvThreads: 2 });
+ *   cv.withLane('batch', function() { im.gaussianBlurAsync([5, 5]); });
+ *   cv.workerPoolStats(); // { threads, queued: { interactive, batch }, ... }
+ */
+class WorkerPool {
+public:
+  enum Lane {
+    INTERACTIVE,
+    BATCH,
+    LANE_COUNT
+  };
+
+  static void Init(Local<Object> target);
+
+  // Main thread. Use instead of Nan::AsyncQueueWorker; the worker goes to the
+  // current lane and is destroyed after its callback ran.
+  static void Queue(Nan::AsyncWorker *worker);
+
+  // Main thread. Queues in `lane` instead, for work that follows up on
+  // earlier work and should stay in its lane.
+  static void Queue(Nan::AsyncWorker *worker, Lane lane);
+
+  // Main thread. The lane Queue() uses right now.
+  static Lane CurrentLane();
+
+  // Main thread. Configured number of threads.
+  static int Threads();
+
+  static NAN_METHOD(SetWorkerPool);
+  static NAN_METHOD(WorkerPoolStats);
+  static NAN_METHOD(WithLane);
+};
+
+#endif
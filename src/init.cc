@@ -18,9 +18,19 @@
 #include "Stereo.h"
 #include "BackgroundSubtractor.h"
 #include "LDAWrap.h"
+#include "MatPool.h"
+#include "Pipeline.h"
+#include "Encoder.h"
+#include "ImageHeader.h"
+#include "ImagePages.h"
+#include "ImageDecoder.h"
+#include "DecodeCache.h"
+#include "WorkerPool.h"
+#include "Stats.h"
 
 extern "C" void init(Local<Object> target) {
   Nan::HandleScope scope;
+  Stats::Init(target);
   OpenCV::Init(target);
 
   Point::Init(target);
@@ -36,6 +46,14 @@ extern "C" void init(Local<Object> target) {
   Constants::Init(target);
   Calib3D::Init(target);
   ImgProc::Init(target);
+  MatPool::Init(target);
+  Pipeline::Init(target);
+  Encoder::Init(target);
+  ImageHeader::Init(target);
+  ImagePages::Init(target);
+  ImageDecoder::Init(target);
+  DecodeCache::Init(target);
+  WorkerPool::Init(target);
 #if CV_MAJOR_VERSION < 3
   StereoBM::Init(target);
   StereoSGBM::Init(target);
@@ -36,6 +36,109 @@ test("readImage", function(t) {
   })
 });
 
+test("readImage options", function(t) {
+  t.throws(function() {cv.readImage(PATH_TO_MONA_PNG, {mode: 'sepia'})}, /mode must be/)
+  t.throws(function() {cv.readImage(PATH_TO_MONA_PNG, {maxSize: 0})}, /maxSize must be a number >= 1/)
+  t.throws(function() {cv.readImage(PATH_TO_MONA_PNG, {}, 'not-a-function')}, /Argument 3 must be a Function/)
+
+  Promise.all([
+    cv.readImage(PATH_TO_MONA_PNG, {mode: 'grayscale'}),
+    cv.readImage("./examples/files/car1.jpg", {maxSize: 256}),
+    cv.readImage(fs.readFileSync("./examples/files/car1.jpg"), {mode: 'grayscale', maxSize: 100})
+  ]).then(function(images) {
+    t.equal(images[0].channels(), 1)
+    t.equal(images[1].width(), 256, 'scaled to fit')
+    t.equal(images[1].height(), 170, 'keeps the aspect ratio')
+    t.equal(images[2].width(), 100)
+    t.equal(images[2].channels(), 1)
+    t.end()
+  }, function(err) {
+    t.error(err)
+    t.end()
+  })
+});
+
+test("probeImage", function(t) {
+  t.throws(function() {cv.probeImage(0)}, /Argument 1 must be a string or a Buffer/)
+
+  Promise.all([
+    cv.probeImage(PATH_TO_MONA_PNG),
+    cv.probeImage(fs.readFileSync("./examples/files/car1.jpg")),
+    cv.probeImage(new Buffer('not an image')).catch(function(err) { return err })
+  ]).then(function(headers) {
+    t.deepEqual(headers[0], {format: 'png', width: 500, height: 756, channels: 3, depth: 8, pages: 1})
+    t.deepEqual(headers[1], {format: 'jpeg', width: 1024, height: 680, channels: 3, depth: 8, pages: 1})
+    t.ok(headers[2] instanceof Error, 'unknown format')
+    t.end()
+  }, function(err) {
+    t.error(err)
+    t.end()
+  })
+});
+
+test("decode cache", function(t) {
+  t.throws(function() {cv.setDecodeCache()}, /Argument 1 must be an object/)
+
+  cv.setDecodeCache({enabled: true, maxBytes: 16 << 20})
+  var buf = fs.readFileSync(PATH_TO_MONA_PNG)
+  cv.readImage(PATH_TO_MONA_PNG).then(function(first) {
+    return Promise.all([first, cv.readImage(PATH_TO_MONA_PNG), cv.readImage(buf), cv.readImage(buf)])
+  }).then(function(images) {
+    var stats = cv.decodeCacheStats()
+    t.equal(stats.hits, 2, 'second reads of the path and the Buffer hit')
+    t.equal(stats.misses, 2)
+    t.ok(stats.bytes > 0)
+
+    // Copy-on-write: drawing on one doesn't change the cached pixels
+    var before = images[1].pixel(10, 10)
+    images[1].rectangle([0, 0], [20, 20], [1, 2, 3], -1)
+    t.deepEqual(images[1].pixel(10, 10), [1, 2, 3])
+    t.deepEqual(images[0].pixel(10, 10), before)
+    t.equal(cv.decodeCacheStats().copies, 1)
+
+    return cv.readImage(PATH_TO_MONA_PNG)
+  }).then(function(again) {
+    t.notDeepEqual(again.pixel(10, 10), [1, 2, 3], 'cache unchanged')
+
+    cv.setDecodeCache({enabled: false})
+    t.equal(cv.decodeCacheStats().bytes, 0)
+    t.end()
+  }).catch(function(err) {
+    cv.setDecodeCache({enabled: false})
+    t.error(err)
+    t.end()
+  })
+});
+
+test("readImages", function(t) {
+  t.throws(function() {cv.readImages()}, /Argument 1 must be an array of strings and Buffers/)
+  t.throws(function() {cv.readImages([0])}, /Argument 1 must be an array of strings and Buffers/)
+  t.throws(function() {cv.readImages([], {concurrency: 0})}, /concurrency must be a number >= 1/)
+
+  var inputs = [PATH_TO_MONA_PNG, fs.readFileSync(PATH_TO_MONA_PNG), './no/such/image.png', PATH_TO_MONA_PNG]
+  var seen = []
+  cv.readImages(inputs, {
+    concurrency: 2,
+    onImage: function(err, im, index) { seen.push(index) }
+  }).then(function(results) {
+    t.equal(results.length, 4)
+    t.ok(results[0] instanceof cv.Matrix)
+    t.deepEqual(results[1].size(), results[0].size())
+    t.ok(results[2] instanceof Error, 'per-item error')
+    t.ok(results[3] instanceof cv.Matrix)
+    t.deepEqual(seen.sort(), [0, 1, 2, 3])
+
+    cv.readImages([], function(err, results) {
+      t.error(err)
+      t.deepEqual(results, [])
+      t.end()
+    })
+  }, function(err) {
+    t.error(err)
+    t.end()
+  })
+});
+
 test('Point', function(t){
   var x1 = 1,
       y1 = 2,
@@ -243,6 +346,36 @@ test('Matrix accessors', function(assert){
   assert.end()
 })
 
+test('Matrix element access for every type', function(assert) {
+  var types = ['CV_8U', 'CV_8S', 'CV_16U', 'CV_16S', 'CV_32S', 'CV_32F', 'CV_64F'];
+
+  types.forEach(function(depth) {
+    var mat = new cv.Matrix(2, 3, cv.Constants[depth + 'C1'], [0]);
+    mat.set(1, 2, 100);
+    assert.equal(mat.get(1, 2), 100, depth + 'C1 get');
+    assert.deepEqual(mat.row(1), [0, 0, 100], depth + 'C1 row');
+
+    var color = new cv.Matrix(2, 3, cv.Constants[depth + 'C3'], [0, 0, 0]);
+    color.set(0, 1, [10, 20, 30]);
+    color.set(0, 1, 40, 2);
+    assert.deepEqual(color.get(0, 1), [10, 20, 40], depth + 'C3 get');
+    assert.deepEqual(color.pixel(0, 1), [10, 20, 40], depth + 'C3 pixel');
+    assert.deepEqual(color.col(1), [10, 0], depth + 'C3 col');
+  });
+
+  var bytes = new cv.Matrix(1, 1, cv.Constants.CV_8UC1, [0]);
+  bytes.set(0, 0, 300);
+  assert.equal(bytes.get(0, 0), 255, 'writes saturate');
+
+  var quad = new cv.Matrix(1, 1, cv.Constants.CV_16SC4, [0, 0, 0, 0]);
+  quad.pixel(0, 0, [-1, 2, -3, 4]);
+  assert.deepEqual(quad.pixel(0, 0), [-1, 2, -3, 4]);
+
+  assert.throws(function() { bytes.get(1, 0); }, RangeError);
+  assert.throws(function() { bytes.set(0, 0, 1, 1); }, RangeError);
+  assert.end();
+})
+
 test('Matrix functions', function(assert) {
   // convertTo
   var mat = new cv.Matrix(75, 75, cv.Constants.CV_32F, [2.0]);
@@ -265,6 +398,399 @@ test('Matrix functions', function(assert) {
   assert.end();
 })
 
+test('Matrix typed array accessors', function(assert) {
+  var mat = new cv.Matrix(3, 4, cv.Constants.CV_8UC3, [1, 2, 3]);
+  mat.pixel(1, 2, [7, 8, 9]);
+
+  var row = mat.rowData(1);
+  assert.ok(row instanceof Uint8Array);
+  assert.equal(row.length, 12);
+  assert.deepEqual(Array.prototype.slice.call(row, 6, 9), [7, 8, 9]);
+  assert.deepEqual(mat.pixelRow(1).slice(6, 9), [7, 8, 9]);
+
+  var col = mat.colData(2);
+  assert.equal(col.length, 9);
+  assert.deepEqual(Array.prototype.slice.call(col, 3, 6), [7, 8, 9]);
+  assert.deepEqual(mat.pixelCol(2).slice(3, 6), [7, 8, 9]);
+
+  var region = mat.regionData({ x: 2, y: 1, width: 2, height: 2 });
+  assert.deepEqual(Array.prototype.slice.call(region, 0, 3), [7, 8, 9]);
+  assert.equal(region.length, 12);
+
+  var red = mat.channelData(2);
+  assert.equal(red.length, 12);
+  assert.equal(red[6], 9);
+
+  var floats = new cv.Matrix(2, 2, cv.Constants.CV_32FC1, [0.5]);
+  assert.ok(floats.rowData(0) instanceof Float32Array);
+  assert.equal(floats.rowData(0)[1], 0.5);
+  assert.deepEqual(floats.pixelRow(1), [0.5, 0.5]);
+
+  assert.throws(function() { mat.rowData(3); }, RangeError);
+  assert.throws(function() { mat.channelData(3); }, RangeError);
+  assert.throws(function() { mat.regionData({ x: 3, y: 0, width: 2, height: 1 }); }, RangeError);
+  assert.end();
+})
+
+test('Tone curves', function(assert) {
+  var gray = new cv.Matrix(2, 2, cv.Constants.CV_8UC1, [100]);
+  gray.brightness(2, 10);
+  assert.equal(gray.get(0, 0), 210);
+  gray.brightness(100);
+  assert.equal(gray.get(1, 1), 255, 'brightness saturates');
+
+  var color = new cv.Matrix(2, 2, cv.Constants.CV_8UC3, [10, 20, 30]);
+  color.brightness(5);
+  assert.deepEqual(color.pixel(0, 0), [15, 25, 35], 'brightness applies to every channel');
+
+  var floats = new cv.Matrix(1, 1, cv.Constants.CV_32FC1, [0.5]);
+  floats.brightness(2, 0);
+  assert.equal(floats.get(0, 0), 1);
+
+  var table = [];
+  for (var i = 0; i < 256; i++) table.push(255 - i);
+  var inverted = new cv.Matrix();
+  color.lut(table, inverted);
+  assert.deepEqual(inverted.pixel(1, 1), [240, 230, 220]);
+  assert.deepEqual(color.pixel(1, 1), [15, 25, 35], 'source is left alone');
+
+  var mid = new cv.Matrix(1, 1, cv.Constants.CV_8UC1, [64]);
+  mid.gamma(1);
+  assert.equal(mid.get(0, 0), 64);
+  mid.gamma(2);
+  assert.equal(mid.get(0, 0), 128);
+
+  mid.levels(0, 128);
+  assert.equal(mid.get(0, 0), 255);
+
+  assert.throws(function() { mid.gamma(0); }, TypeError);
+  assert.throws(function() { mid.lut([1, 2, 3]); }, TypeError);
+  assert.throws(function() { mid.levels(10, 10); }, TypeError);
+  assert.throws(function() { floats.gamma(2); }, Error);
+  assert.end();
+})
+
+test('Matrix bulk writes', function(assert) {
+  var mat = new cv.Matrix(2, 3, cv.Constants.CV_8UC1, [0]);
+  mat.setData(new Buffer([1, 2, 3, 4, 5, 6]));
+  assert.deepEqual(mat.row(1), [4, 5, 6]);
+
+  mat.setData(new Float32Array([1.4, 300, -5, 4, 5, 6]));
+  assert.deepEqual(mat.row(0), [1, 255, 0], 'typed arrays are converted');
+
+  // Padded source rows
+  mat.setData(new Buffer([7, 8, 9, 0, 10, 11, 12, 0]), 4);
+  assert.deepEqual(mat.row(1), [10, 11, 12]);
+
+  var color = new cv.Matrix(3, 3, cv.Constants.CV_8UC3, [0, 0, 0]);
+  var view = color.roi({ x: 1, y: 1, width: 2, height: 2 });
+  view.setData(new Uint8Array(12).fill(9));
+  assert.deepEqual(color.pixel(0, 0), [0, 0, 0], 'writes stay inside the view');
+  assert.deepEqual(color.pixel(2, 2), [9, 9, 9]);
+
+  color.putRegion(new Uint16Array([50, 60]), { x: 0, y: 0, width: 2, height: 1 }, { channel: 1 });
+  assert.deepEqual(color.pixel(0, 1), [0, 60, 0]);
+
+  assert.throws(function() { mat.setData(new Buffer(3)); }, RangeError);
+  assert.throws(function() { mat.setData(new Buffer(6), -1); }, RangeError);
+  assert.throws(function() { mat.setData(new Buffer(6), Math.pow(2, 52)); }, RangeError);
+  assert.throws(function() {
+    color.putRegion(new Buffer(12), { x: 0, y: 0, width: 2, height: 2 }, { stride: -3 });
+  }, RangeError);
+  assert.throws(function() { mat.setData([1, 2, 3]); }, TypeError);
+  assert.throws(function() { mat.put(new Buffer(7)); }, RangeError);
+  assert.throws(function() {
+    color.putRegion(new Buffer(12), { x: 2, y: 2, width: 2, height: 2 });
+  }, RangeError);
+  assert.end();
+})
+
+test('Matrix raw files', function(assert) {
+  var path = require('path').join(require('os').tmpdir(), 'node-opencv-raw-test.cvmat');
+  var mat = new cv.Matrix(3, 4, cv.Constants.CV_32FC2, [0.25, -7]);
+  mat.set(2, 3, [1.5, 1e6]);
+
+  mat.roi({ x: 1, y: 1, width: 3, height: 2 }).saveRaw(path);
+
+  [false, true].forEach(function(mmap) {
+    var loaded = cv.Matrix.loadRaw(path, { mmap: mmap });
+    assert.equal(loaded.type(), cv.Constants.CV_32FC2);
+    assert.deepEqual(loaded.size(), [2, 3]);
+    assert.deepEqual(loaded.get(1, 2), [1.5, 1e6]);
+    assert.deepEqual(loaded.get(0, 0), [0.25, -7]);
+  });
+
+  var mapped = cv.Matrix.loadRaw(path, { mmap: true });
+  mapped.set(0, 0, [9, 9]);
+  assert.deepEqual(cv.Matrix.loadRaw(path).get(0, 0), [0.25, -7], 'writes do not reach the file');
+
+  assert.throws(function() { cv.Matrix.loadRaw(__filename); }, /not a raw matrix file/);
+
+  var view = mapped.roi({ x: 0, y: 0, width: 2, height: 1 }).data();
+  mapped = null;
+  if (global.gc) global.gc();
+  assert.equal(view.readFloatLE(0), 9, 'views keep the mapping');
+
+  // A separate file: truncating one that is still mapped would fault.
+  var outPath = path + '.out';
+  if (parseInt(cv.version, 10) >= 3) {
+    var created = cv.Matrix.createRaw(outPath, 4, 5, cv.Constants.CV_16UC1);
+    assert.equal(created.get(3, 4), 0);
+    created.roi({ x: 3, y: 2, width: 2, height: 2 }).setData(new Uint16Array([1, 2, 3, 60000]));
+    var shared = cv.Matrix.loadRaw(outPath, { mmap: true, shared: true });
+    assert.equal(shared.get(3, 4), 60000, 'createRaw writes go to the file');
+    shared.set(0, 0, 7);
+    assert.equal(cv.Matrix.loadRaw(outPath).get(0, 0), 7, 'shared writes go to the file');
+    require('fs').unlinkSync(outPath);
+  } else {
+    assert.throws(function() { cv.Matrix.createRaw(outPath, 4, 5, cv.Constants.CV_16UC1); });
+  }
+  assert.throws(function() { cv.Matrix.loadRaw(outPath, { shared: true }); }, TypeError);
+
+  mat.saveRaw(path, function(err) {
+    assert.error(err);
+    assert.deepEqual(cv.Matrix.loadRaw(path).size(), [3, 4]);
+    require('fs').unlinkSync(path);
+    assert.end();
+  });
+})
+
+test('Matrix data views', function(assert) {
+  var mat = new cv.Matrix(2, 3, cv.Constants.CV_8UC1, [7]);
+  var view = mat.data();
+  assert.equal(view.length, 6);
+  view[0] = 9;
+  assert.equal(mat.get(0, 0), 9, 'data() shares pixels with the matrix');
+  var detached = mat.roi({ x: 0, y: 0, width: 2, height: 2 }).data();
+  assert.equal(detached.length, 4);
+  detached[3] = 1;
+  assert.equal(mat.get(1, 1), 7, 'a non-contiguous view is copied');
+  assert.throws(function() { mat.ptr(-1); }, RangeError);
+  assert.throws(function() { mat.ptr(2); }, RangeError);
+
+  var buf = new Buffer([1, 2, 3, 4, 5, 6, 0, 0]);
+  var wrapped = cv.Matrix.fromBuffer(buf, 2, 3, cv.Constants.CV_8UC1, 4);
+  assert.deepEqual(wrapped.size(), [2, 3]);
+  assert.equal(wrapped.get(1, 0), 5);
+  wrapped.set(0, 1, 42);
+  assert.equal(buf[1], 42, 'fromBuffer() does not copy');
+  assert.deepEqual(Array.prototype.slice.call(wrapped.getData()), [1, 42, 3, 5, 6, 0]);
+
+  assert.throws(function() {
+    cv.Matrix.fromBuffer(new Buffer(5), 2, 3, cv.Constants.CV_8UC1);
+  }, RangeError);
+  assert.throws(function() {
+    cv.Matrix.fromBuffer(new Buffer(8), 2, 3, cv.Constants.CV_8UC1, -1);
+  }, RangeError);
+  assert.throws(function() {
+    cv.Matrix.fromBuffer(new Buffer(8), 3, 3, cv.Constants.CV_8UC1, Math.pow(2, 52));
+  }, RangeError);
+
+  assert.end();
+})
+
+test('Matrix buffer pool', function(assert) {
+  if (parseInt(cv.version, 10) < 3) {
+    assert.throws(function() { cv.setMatPool({ enabled: true }); });
+    return assert.end();
+  }
+
+  cv.setMatPool({ enabled: true, maxBytes: 16 * 1024 * 1024 });
+  for (var i = 0; i < 4; i++) {
+    new cv.Matrix(480, 640, cv.Constants.CV_8UC3).release();
+  }
+  var stats = cv.matPoolStats();
+  assert.ok(stats.enabled);
+  assert.ok(stats.hits >= 3, 'released frames are reused');
+
+  cv.setMatPool({ enabled: false });
+  assert.equal(cv.matPoolStats().retainedBytes, 0);
+  assert.end();
+})
+
+test('Destination Matrix argument', function(assert) {
+  var mat = new cv.Matrix(20, 30, cv.Constants.CV_8UC3, [10, 20, 30]);
+  var dst = new cv.Matrix();
+
+  assert.equal(mat.resize({ width: 15, height: 10 }, dst), dst);
+  assert.deepEqual(dst.size(), [10, 15]);
+  assert.deepEqual(mat.size(), [20, 30], 'source is left alone');
+
+  assert.equal(mat.cvtColor('CV_BGR2GRAY', dst), dst);
+  assert.equal(dst.channels(), 1);
+  assert.equal(mat.channels(), 3);
+
+  var gray = dst;
+  dst = new cv.Matrix();
+  assert.equal(gray.threshold(100, 255, dst), dst);
+  assert.equal(gray.canny(50, 150, dst), dst);
+  assert.equal(gray.pyrDown(dst), dst);
+  assert.deepEqual(dst.size(), [10, 15]);
+
+  assert.end();
+})
+
+test('Matrix async methods', function(assert) {
+  var mat = new cv.Matrix(20, 30, cv.Constants.CV_8UC3, [10, 20, 30]);
+
+  mat.resizeAsync({ width: 15, height: 10 }).then(function(small) {
+    assert.deepEqual(small.size(), [10, 15]);
+    assert.deepEqual(mat.size(), [20, 30]);
+
+    return mat.cvtColorAsync('CV_BGR2GRAY');
+  }).then(function(gray) {
+    assert.equal(gray, mat, 'in-place ops resolve with the matrix itself');
+    assert.equal(mat.channels(), 1);
+
+    mat.findContoursAsync(function(err, contours) {
+      assert.error(err);
+      assert.ok(contours.size() >= 0);
+      assert.throws(function() { mat.cannyAsync(); }, TypeError);
+      assert.end();
+    });
+  }).catch(function(err) {
+    assert.error(err);
+    assert.end();
+  });
+})
+
+test('Pipeline', function(assert) {
+  var mat = new cv.Matrix(40, 40, cv.Constants.CV_8UC3, [0, 0, 0]);
+  mat.rectangle([10, 10], [20, 20], [255, 255, 255], -1);
+
+  assert.throws(function() { new cv.Pipeline([['noSuchMethod']]); }, TypeError);
+  assert.throws(function() { new cv.Pipeline(['findContours', 'pyrDown']); }, TypeError);
+
+  var pipeline = new cv.Pipeline([
+    ['cvtColor', 'CV_BGR2GRAY'],
+    ['threshold', 100, 255],
+    'pyrDown'
+  ]);
+  assert.equal(pipeline.length(), 3);
+
+  var small = pipeline.run(mat);
+  assert.deepEqual(small.size(), [20, 20]);
+  assert.equal(small.channels(), 1);
+  assert.equal(mat.channels(), 3, 'input is left alone');
+
+  var mask = new cv.Matrix(40, 40, cv.Constants.CV_8UC1, [0]);
+  mask.rectangle([10, 10], [20, 20], [255], -1);
+  var before = mask.countNonZero();
+  assert.ok(new cv.Pipeline(['findContours']).run(mask).size() > 0);
+  assert.equal(mask.countNonZero(), before, 'findContours alone leaves its input alone');
+
+  mat.pipeline([['cvtColor', 'CV_BGR2GRAY'], ['canny', 50, 150], 'findContours'], function(err, contours) {
+    assert.error(err);
+    assert.ok(contours.size() > 0);
+    assert.end();
+  });
+})
+
+test('Matrix tiles', function(assert) {
+  var mat = new cv.Matrix(50, 70, cv.Constants.CV_8UC1, [0]);
+  mat.rectangle([15, 12], [30, 25], [255], -1);
+  mat.line([0, 0], [69, 49], [128], 2);
+
+  var tiles = mat.tiles({ tile: [32, 32], overlap: 4 });
+  assert.equal(tiles.length, 6);
+  assert.deepEqual(tiles[1].rect, { x: 32, y: 0, width: 32, height: 32 });
+  assert.deepEqual(tiles[1].halo, { x: 28, y: 0, width: 40, height: 36 });
+  assert.deepEqual(tiles[1].matrix.size(), [36, 40]);
+  assert.equal(tiles[5].rect.width, 6);
+
+  assert.throws(function() { mat.tiles({ tile: 0 }); }, TypeError);
+  assert.throws(function() { mat.processTiles(['pyrDown']); }, TypeError);
+  assert.throws(function() { mat.processTiles([['threshold', 0, 255, 'Binary', 'Otsu']]); }, TypeError);
+  assert.throws(function() { mat.processTiles([['threshold', 0, 255, 'Binary', 'Triangle']]); }, TypeError);
+
+  // ksize and sigma each setting the kernel on one axis
+  var steps = [['gaussianBlur', [7, 7]], ['gaussianBlur', [0, 9], 2], ['dilate', 2]];
+  var whole = new cv.Pipeline(steps).run(mat);
+
+  mat.processTiles(steps, { tile: [16, 16] }).then(function(result) {
+    assert.deepEqual(result.size(), whole.size());
+    var diff = new cv.Matrix(whole.height(), whole.width());
+    diff.absDiff(result, whole);
+    assert.equal(diff.countNonZero(), 0, 'same as the whole image');
+    assert.end();
+  }).catch(function(err) {
+    assert.error(err);
+    assert.end();
+  });
+})
+
+test('Worker pool', function(assert) {
+  assert.throws(function() { cv.setWorkerPool({ threads: 0 }); }, RangeError);
+  assert.throws(function() { cv.withLane('urgent', function() {}); }, TypeError);
+
+  cv.setWorkerPool({ threads: 2, opencvThreads: -1 });
+  assert.equal(cv.workerPoolStats().threads, 2);
+
+  var mat = new cv.Matrix(20, 20, cv.Constants.CV_8UC1, [0]);
+  var promise = cv.withLane('batch', function() {
+    return mat.pyrDownAsync();
+  });
+  assert.throws(function() {
+    cv.withLane('batch', function() { throw new Error('boom'); });
+  }, /boom/);
+
+  promise.then(function() {
+    var stats = cv.workerPoolStats();
+    assert.equal(stats.queued.batch, 0);
+    assert.ok(stats.completed > 0);
+    assert.end();
+  }, function(err) {
+    assert.error(err);
+    assert.end();
+  });
+})
+
+test('Stats', function(assert) {
+  cv.enableStats(true);
+  cv.resetStats();
+
+  var mat = new cv.Matrix(10, 10, cv.Constants.CV_8UC1, [0]);
+  mat.width();
+  mat.width();
+  mat.pyrDownAsync().then(function() {
+    var stats = cv.stats({ buckets: true });
+    assert.equal(stats['Matrix#width'].calls, 2);
+    assert.equal(stats['Matrix#width'].sync.count, 2);
+    assert.ok(Array.isArray(stats['Matrix#width'].sync.buckets));
+    assert.equal(stats['Matrix#pyrDownAsync'].async.execute.count, 1);
+
+    cv.resetStats();
+    cv.enableStats(false);
+    mat.width();
+    assert.deepEqual(cv.stats(), {});
+    assert.end();
+  }).catch(function(err) {
+    assert.error(err);
+    assert.end();
+  });
+})
+
+test('Matrix memory', function(assert) {
+  // Matrices of earlier tests may be collected meanwhile, hence the >=
+  var mat = new cv.Matrix(100, 100, cv.Constants.CV_8UC1, [0]);
+  var small = mat.resize({ width: 10, height: 10 });
+
+  var memory = cv.matrixMemory({ resetPeak: true });
+  assert.ok(memory.live >= 2);
+  assert.ok(memory.bytes >= 100 * 100 + 10 * 10);
+  assert.ok(memory.peakBytes >= memory.bytes);
+  assert.ok(memory.sites['Matrix#resize'].live >= 1);
+  assert.ok(memory.sites['Matrix#resize'].bytes >= 100);
+  assert.equal(cv.matrixMemory().peakBytes, memory.bytes, 'peak was reset');
+
+  var stop = cv.sampleMatrixMemory(1, function(sampled) {
+    stop();
+    assert.equal(typeof sampled.live, 'number');
+    assert.ok(small);
+    assert.end();
+  });
+})
+
 test(".norm", function(assert){
   cv.readImage("./examples/files/coin1.jpg", function(err, im) {
     cv.readImage("./examples/files/coin2.jpg", function(err, im2){
@@ -305,6 +831,26 @@ test("Matrix toBuffer Async", function(assert){
 })
 
 
+test("Encoder", function(assert){
+  assert.throws(function() { new cv.Encoder('.png'); }, TypeError);
+
+  var mat = new cv.Matrix(20, 30, cv.Constants.CV_8UC3, [0, 128, 255]);
+  var png = new cv.Encoder({ ext: '.png', pngCompression: 9 });
+  var buf = png.encode(mat);
+  assert.equal(buf.slice(1, 4).toString(), 'PNG');
+
+  png.encodeAsync(mat).then(function(buf2) {
+    assert.ok(buf.equals(buf2));
+    return cv.readImage(buf2);
+  }).then(function(im) {
+    assert.deepEqual(im.size(), [20, 30]);
+    assert.end();
+  }).catch(function(err) {
+    assert.error(err);
+    assert.end();
+  });
+})
+
 test("detectObject", function(assert){
   cv.readImage("./examples/files/mona.png", function(err, im){
     im.detectObject(cv.FACE_CASCADE, {}, function(err, faces){
@@ -372,7 +918,13 @@ test("Multi-page image read from file", function(assert){
         assert.equal(imgs[i].channels(), 3);
         assert.equal(imgs[i].empty(), false);
       }
-      assert.end();
+
+      assert.throws(function() { cv.readImageMulti("./examples/files/multipage.tif"); }, /Argument 2 must be a function/);
+      cv.readImageMulti("./examples/files/missing.tif", function(err, imgs){
+        assert.ok(err);
+        assert.deepEqual(imgs, [], 'empty array on failure');
+        assert.end();
+      })
     })
   } else {
     assert.equal(cv.readImageMulti("./examples/files/multipage.tif"), false);
@@ -380,6 +932,41 @@ test("Multi-page image read from file", function(assert){
   }
 })
 
+test("readImagePages", function(assert){
+  assert.throws(function() {cv.readImagePages()}, /Argument 1 must be a path/)
+  assert.throws(function() {cv.readImagePages(PATH_TO_MONA_PNG, {prefetch: 0})}, /prefetch must be a number >= 1/)
+
+  var pages = cv.readImagePages("./examples/files/multipage.tif", {prefetch: 1})
+  var count = 0
+  function next() {
+    return pages.next().then(function(result) {
+      if (result.done) return
+      count++
+      assert.equal(result.value.width(), 800)
+      assert.equal(result.value.height(), 600)
+      return next()
+    })
+  }
+  next().then(function() {
+    assert.equal(count, parseInt(cv.version) >= 3 ? 10 : 1)
+
+    // A single page image is one page, and closing ends the iteration
+    var single = cv.readImagePages(PATH_TO_MONA_PNG)
+    return single.next().then(function(result) {
+      assert.notOk(result.done)
+      assert.equal(result.value.width(), 500)
+      single.close()
+      return single.next()
+    })
+  }).then(function(result) {
+    assert.ok(result.done)
+    assert.end()
+  }, function(err) {
+    assert.error(err)
+    assert.end()
+  })
+})
+
 test("Distance transform", function(assert){
   cv.readImage("./examples/files/distanceTransform.png", function(err, img){
     assert.ok(img);
@@ -429,6 +1016,60 @@ test("ImageDataStream", function(assert){
 
 })
 
+test("ImageDecoder", function(assert){
+  var png = fs.readFileSync('./examples/files/mona.png')
+    , decoder = new cv.ImageDecoder({mode: 'grayscale'})
+
+  assert.throws(function() {decoder.push('abc')}, /Argument 1 must be a Buffer/)
+
+  assert.equal(decoder.header(), null)
+  decoder.push(png.slice(0, 10))
+  assert.equal(decoder.header(), null, 'header incomplete')
+  decoder.push(png.slice(10, 1000))
+  assert.deepEqual(decoder.header(), {format: 'png', width: 500, height: 756, channels: 3, depth: 8, pages: 1})
+  for (var i = 1000; i < png.length; i += 4096) {
+    decoder.push(png.slice(i, i + 4096))
+  }
+
+  decoder.decode().then(function(im) {
+    assert.deepEqual(im.size(), [756, 500])
+    assert.equal(im.channels(), 1)
+    assert.throws(function() {decoder.push(png)}, /push\(\) after decode\(\)/)
+    assert.throws(function() {decoder.decode()}, /decode\(\) was already called/)
+
+    var whole = new cv.ImageDecoder()
+    whole.push(png)
+    assert.equal(whole.header().width, 500)
+    return whole.decode()
+  }).then(function(im) {
+    assert.deepEqual(im.size(), [756, 500], 'one chunk decoded in place')
+    assert.equal(im.channels(), 3)
+
+    return new cv.ImageDecoder().decode()
+  }).then(function() {
+    assert.fail('empty decoder decoded')
+  }, function(err) {
+    assert.ok(/No image data/.test(err.message))
+    assert.end()
+  })
+})
+
+test("ImageDataStream header", function(assert){
+  var s = new cv.ImageDataStream({maxSize: 100})
+    , header
+
+  s.on('header', function(h){
+    header = h
+  })
+  s.on('load', function(im){
+    assert.equal(header.width, 500)
+    assert.deepEqual(im.size(), [100, 66])
+    assert.end()
+  })
+
+  fs.createReadStream('./examples/files/mona.png', {highWaterMark: 4096}).pipe(s);
+})
+
 test("ImageStream", function(assert){
   var s = new cv.ImageStream()
     , im = fs.readFileSync('./examples/files/mona.png')
@@ -441,6 +1082,108 @@ test("ImageStream", function(assert){
 })
 
 
+test("VideoCapture startCapture", function(assert){
+  var cap
+  try {
+    cap = new cv.VideoCapture(path.resolve(__dirname, '../examples/files/motion.mov'))
+  } catch (e) {
+    // OpenCV built without a video backend
+    assert.end()
+    return
+  }
+
+  assert.equal(cap.captureStats(), null)
+  assert.throws(function() {cap.startCapture({policy: 'newest'})}, /policy must be 'latest' or 'fifo'/)
+  cap.startCapture({policy: 'fifo', size: 3})
+  assert.throws(function() {cap.ReadSync()}, /Not while capturing/)
+
+  var frames = 0
+  function next() {
+    cap.read().then(function(frame) {
+      if (!frame.empty()) {
+        frames++
+        return next()
+      }
+
+      var stats = cap.captureStats()
+      assert.equal(stats.policy, 'fifo')
+      assert.equal(stats.ended, true)
+      assert.equal(stats.dropped, 0, 'fifo is lossless')
+      assert.equal(stats.delivered, frames)
+      assert.equal(stats.captured, frames)
+      cap.stopCapture(function(err) {
+        assert.error(err)
+        assert.doesNotThrow(function() {cap.ReadSync()}, 'cap is back once stopped')
+        assert.end()
+      })
+      assert.equal(cap.captureStats(), null)
+    }).catch(function(err) {
+      cap.stopCapture()
+      assert.error(err)
+      assert.end()
+    })
+  }
+  next()
+})
+
+test("VideoCapture startCapture with reads pending", function(assert){
+  var cap
+  try {
+    cap = new cv.VideoCapture(path.resolve(__dirname, '../examples/files/motion.mov'))
+  } catch (e) {
+    // OpenCV built without a video backend
+    assert.end()
+    return
+  }
+
+  cap.read(function(err, frame) {
+    assert.error(err)
+    cap.startCapture()
+    cap.stopCapture().then(function() {
+      cap.release()
+      assert.end()
+    })
+  })
+  assert.throws(function() {cap.startCapture()}, /Not while read\(\), grab\(\) or retrieve\(\) are pending/)
+})
+
+test("VideoCapture frame recycling", function(assert){
+  var cap
+  try {
+    cap = new cv.VideoCapture(path.resolve(__dirname, '../examples/files/motion.mov'))
+  } catch (e) {
+    // OpenCV built without a video backend
+    assert.end()
+    return
+  }
+
+  assert.throws(function() {cap.setFramePool({size: -1})}, /size must be a number >= 0/)
+  cap.setFramePool({size: 2})
+  cap.read(function(err, first) {
+    assert.error(err)
+    assert.equal(first.empty(), false)
+
+    // A view of its pixels keeps them from being read into
+    var pixels = first.data()
+    var copy = new Buffer(pixels)
+    cap.read(first, function(err, second) {
+      assert.error(err)
+      assert.equal(second, first, 'read into the Matrix passed in')
+      assert.ok(pixels.equals(copy), 'shared pixels left alone')
+      assert.equal(cap.framePoolStats().reused, 0)
+
+      second.release()
+      cap.read(function(err, third) {
+        assert.error(err)
+        assert.equal(third.empty(), false)
+        assert.equal(cap.framePoolStats().reused, 1, 'released frame read into again')
+        cap.release()
+        assert.end()
+      })
+    })
+  })
+})
+
 test("CamShift", function(assert){
   cv.readImage('./examples/files/coin1.jpg', function(e, im){
     cv.readImage('./examples/files/coin2.jpg', function(e, im2){